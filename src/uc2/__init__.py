@@ -40,5 +40,9 @@ def uc2_init():
 def uc2_run(cwd=None):
     """UniConvertor launch routine."""
 
+    from uc2 import client
+    if client.is_remote_call():
+        sys.exit(client.run(cwd or os.getcwd()))
+
     app = uc2_init()
     app.run(cwd or os.getcwd())
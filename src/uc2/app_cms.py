@@ -74,6 +74,11 @@ class AppColorManager(ColorManager):
         if self.gamutcheck:
             libcms.cms_set_alarm_codes(*val_255(self.alarm_codes))
         self.proof_for_spot = config.cms_proof_for_spot
+        self.bitmap_threads = config.cms_bitmap_threads
+        self.transform_cache_dir = ''
+        if config.cms_transform_cache:
+            self.transform_cache_dir = self.app.appdata.app_cms_cache_dir
+        self.transform_cache_size = config.cms_transform_cache_size
         if self.proofing:
             self.flags = self.flags | uc2const.cmsFLAGS_SOFTPROOFING
         if self.gamutcheck:
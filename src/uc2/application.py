@@ -24,7 +24,7 @@ from uc2 import app_cms, cmds
 from uc2 import events, msgconst
 from uc2.app_palettes import PaletteManager
 from uc2.uc2conf import UCData, UCConfig
-from uc2.utils import fsutils
+from uc2.utils import fsutils, ipc
 from uc2.utils.mixutils import echo, config_logging
 
 LOG = logging.getLogger(__name__)
@@ -67,6 +67,15 @@ class UCApplication(object):
         if args[0] == msgconst.STOP:
             echo('For details see logs: %s\n' % self.log_filepath)
 
+    def init_runtime(self, options):
+        events.connect(events.MESSAGES, self.verbose)
+        log_level = options.get('log', self.config.log_level)
+        self.log_filepath = os.path.join(self.appdata.app_config_dir, 'uc2.log')
+        config_logging(self.log_filepath, log_level)
+
+        self.default_cms = app_cms.AppColorManager(self)
+        self.palettes = PaletteManager(self)
+
     def run(self, current_dir=None):
         if len(sys.argv) == 1:
             dt = self.appdata
@@ -98,6 +107,16 @@ class UCApplication(object):
             cmds.change_config(options)
             self.config.save()
             sys.exit(0)
+        elif cmds.check_option(cmds.SERVER_CMDS):
+            self.do_verbose = cmds.check_args(cmds.VERBOSE_CMDS)
+            options = cmds.parse_cmd_args(current_dir)[1]
+            socket_path = options.get('server')
+            if not isinstance(socket_path, basestring):
+                socket_path = os.path.join(self.appdata.app_config_dir,
+                                           ipc.SOCKET_NAME)
+            self.init_runtime(options)
+            cmds.run_server(self.appdata, socket_path)
+            sys.exit(0)
         elif len(sys.argv) == 2:
             cmds.show_short_help('Not enough arguments!')
             sys.exit(1)
@@ -137,13 +156,7 @@ class UCApplication(object):
             cmds.show_short_help('Source file "%s" is not found!' % files[0])
             sys.exit(1)
 
-        events.connect(events.MESSAGES, self.verbose)
-        log_level = options.get('log', self.config.log_level)
-        self.log_filepath = os.path.join(self.appdata.app_config_dir, 'uc2.log')
-        config_logging(self.log_filepath, log_level)
-
-        self.default_cms = app_cms.AppColorManager(self)
-        self.palettes = PaletteManager(self)
+        self.init_runtime(options)
 
         # EXECUTION ----------------------------
         status = 0
@@ -0,0 +1,150 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2019 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+"""
+Thin client for UniConvertor conversion server.
+Module imports nothing from uc2 except protocol helpers,
+so client startup does not initialize application.
+
+Usage: uniconvertor --remote[=SOCKET] [OPTIONS] INPUT_FILE OUTPUT_FILE
+       uniconvertor --remote[=SOCKET] --stop-server
+Use '-' as INPUT_FILE/OUTPUT_FILE for stdin/stdout streaming
+(--input-format= and --format= define file types in this case).
+"""
+
+import os
+import socket
+import sys
+
+from uc2 import msgconst, uc2const
+from uc2.utils import ipc
+
+REMOTE_CMDS = ('--remote', '-remote')
+
+
+def is_remote_call(argv=None):
+    argv = sys.argv if argv is None else argv
+    return any(item.split('=', 1)[0] in REMOTE_CMDS for item in argv[1:])
+
+
+def request(socket_path, body, data=''):
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    try:
+        sock.connect(socket_path)
+        ipc.send_message(sock, body, data)
+        return ipc.recv_message(sock)
+    finally:
+        sock.close()
+
+
+def convert_files(socket_path, input_path, output_path, options=None):
+    body = {'cmd': 'convert',
+            'files': [os.path.abspath(input_path),
+                      os.path.abspath(output_path)],
+            'options': options or {}}
+    return request(socket_path, body)
+
+
+def convert_data(socket_path, data, input_ext, output_ext, options=None):
+    body = {'cmd': 'convert', 'input_ext': input_ext,
+            'output_ext': output_ext, 'options': options or {}}
+    return request(socket_path, body, data)
+
+
+def _parse_value(value):
+    value = value.replace('"', '').replace("'", '')
+    if value.isdigit():
+        return int(value)
+    elif value.replace('.', '').isdigit():
+        return float(value)
+    elif value.lower() in ('yes', 'no'):
+        return value.lower() == 'yes'
+    return value
+
+
+def _parse_args(argv):
+    files = []
+    options = {}
+    for item in argv[1:]:
+        if item in ('-v', '--verbose'):
+            options['verbose'] = True
+        elif item.startswith('--') or item in REMOTE_CMDS:
+            key, sep, value = item.lstrip('-').partition('=')
+            options[key] = _parse_value(value) if sep else True
+        else:
+            files.append(os.path.expanduser(item))
+    return files, options
+
+
+def _get_ext(path, fmt):
+    if isinstance(fmt, str) and fmt:
+        fmt = fmt.lower()
+        # format id (e.g. 'cdrz') is not always an extension
+        exts = uc2const.FORMAT_EXTENSION.get(fmt)
+        return exts[0] if exts else fmt
+    return os.path.splitext(path)[1][1:].lower()
+
+
+def run(cwd=None, argv=None):
+    argv = sys.argv if argv is None else argv
+    cwd = cwd or os.getcwd()
+    files, options = _parse_args(argv)
+    socket_path = options.pop('remote', True)
+    if not isinstance(socket_path, str):
+        socket_path = ipc.get_socket_path()
+
+    try:
+        if options.pop('stop-server', False):
+            return request(socket_path, {'cmd': 'shutdown'})[0]['status']
+        if len(files) != 2:
+            sys.stderr.write(__doc__)
+            return 1
+
+        input_path, output_path = files
+        if '-' in files:
+            input_ext = _get_ext(input_path, options.pop('input-format', ''))
+            output_ext = _get_ext(output_path, options.get('format', ''))
+            if input_path == '-':
+                data = sys.stdin.read()
+            else:
+                with open(os.path.join(cwd, input_path), 'rb') as fileptr:
+                    data = fileptr.read()
+            response, output = convert_data(socket_path, data, input_ext,
+                                            output_ext, options)
+            if not response['status']:
+                if output_path == '-':
+                    sys.stdout.write(output)
+                else:
+                    with open(os.path.join(cwd, output_path), 'wb') as fp:
+                        fp.write(output)
+        else:
+            response = convert_files(socket_path,
+                                     os.path.join(cwd, input_path),
+                                     os.path.join(cwd, output_path),
+                                     options)[0]
+    except (IOError, OSError, socket.error) as e:
+        sys.stderr.write('Cannot connect to server %s: %s\n' %
+                         (socket_path, e))
+        return 1
+
+    for msg_type, msg in response['messages']:
+        if options.get('verbose') or msg_type in (msgconst.ERROR,
+                                                  msgconst.STOP):
+            status = msgconst.MESSAGES[msg_type]
+            indent = ' ' * (msgconst.MAX_LEN - len(status))
+            sys.stderr.write('%s%s| %s\n' % (status, indent, msg))
+    return response['status']
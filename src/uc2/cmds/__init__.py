@@ -24,6 +24,7 @@ from .translate import convert, wildcard_convert, multiple_convert
 from .translate import normalize_options
 from .configure import show_config, change_config
 from .parts import show_parts
+from .server import run_server
 
 HELP_CMDS = ('--help', '-help', '--h', '-h')
 DIR_CMDS = ('--package-dir', '-package-dir', '--pkg-dir', '-pkg-dir')
@@ -34,12 +35,17 @@ CONFIG_CMDS = ('--configure', '-configure', '--config', '-config',
                '--preferences', '-preferences', '--prefs', '-prefs')
 CFG_SHOW_CMDS = ('--show-config', '-show-config', '--show-prefs', '-show-prefs')
 PARTS_CMDS = ('--parts', '-parts', '--components')
+SERVER_CMDS = ('--server', '-server')
 
 
 def check_args(cmds):
     return any([cmd in sys.argv for cmd in cmds])
 
 
+def check_option(cmds):
+    return any([item.split('=', 1)[0] in cmds for item in sys.argv[1:]])
+
+
 def parse_cmd_args(current_dir):
     files = []
     options_list = []
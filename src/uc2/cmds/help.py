@@ -47,6 +47,21 @@ Example: uniconvertor --recursive --format=PDF ~/clipart/*.svg ~/clipart_pdf/
  -vs, --verbose-short    Show minimized internal logs
  --dry-run               Execute command without translation
  --recursive             Recursive scanning
+ --jobs=N                Number of parallel translation processes
+                         (--jobs without value uses all CPU cores)
+ 
+---Conversion server:-------------------------------
+ 
+Usage: uniconvertor --server[=SOCKET]
+       uniconvertor --remote[=SOCKET] [OPTIONS] INPUT_FILE OUTPUT_FILE
+Example: uniconvertor --remote --input-format=SVG --format=PDF - - < a.svg > a.pdf
+
+ Available options:
+ --server[=SOCKET]       Run conversion server on local Unix socket
+                         (by default, ~/.config/uc2/uc2.sock)
+ --remote[=SOCKET]       Send translation request to running server
+ --input-format=         Type of input file for stdin streaming
+ --stop-server           Stop running server (with --remote)
  
 ---Configuring:-------------------------------------
 
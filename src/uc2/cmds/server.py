@@ -0,0 +1,158 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2019 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import logging
+import os
+import shutil
+import socket
+import tempfile
+
+from uc2 import events, msgconst, uc2const
+from uc2.formats import preload_formats
+from uc2.utils import ipc
+from .translate import convert
+
+LOG = logging.getLogger(__name__)
+
+# Requests are served one by one, so stalled client should not
+# block server forever (seconds, applies to socket I/O only)
+CONN_TIMEOUT = 60.0
+
+
+def _get_extensions(formats):
+    exts = set()
+    for fid in formats:
+        exts.update(uc2const.FORMAT_EXTENSION.get(fid, ()))
+    return exts
+
+
+# client provided extensions are used in temporary file names
+LOADER_EXTENSIONS = _get_extensions(uc2const.LOADER_FORMATS +
+                                    uc2const.EXPERIMENTAL_LOADERS)
+SAVER_EXTENSIONS = _get_extensions(uc2const.SAVER_FORMATS +
+                                   uc2const.EXPERIMENTAL_SAVERS)
+
+
+class MessageCollector(object):
+    def __init__(self):
+        self.messages = []
+        events.connect(events.MESSAGES, self)
+
+    def __call__(self, *args):
+        self.messages.append(list(args))
+
+    def close(self):
+        events.disconnect(events.MESSAGES, self)
+
+
+def _check_ext(ext, extensions):
+    if not isinstance(ext, basestring) or ext not in extensions:
+        msg = 'Unsupported file extension "%s"' % ext
+        events.emit(events.MESSAGES, msgconst.ERROR, msg)
+        raise ValueError(msg)
+    return ext
+
+
+def _convert_stream(appdata, request, data):
+    input_ext = _check_ext(request.get('input_ext'), LOADER_EXTENSIONS)
+    output_ext = _check_ext(request.get('output_ext'), SAVER_EXTENSIONS)
+    tmpdir = tempfile.mkdtemp(prefix='uc2-')
+    try:
+        in_path = os.path.join(tmpdir, 'input.%s' % input_ext)
+        out_path = os.path.join(tmpdir, 'output.%s' % output_ext)
+        with open(in_path, 'wb') as fileptr:
+            fileptr.write(data)
+        convert(appdata, (in_path, out_path), request.get('options', {}))
+        with open(out_path, 'rb') as fileptr:
+            return fileptr.read()
+    finally:
+        shutil.rmtree(tmpdir, True)
+
+
+def handle_request(appdata, conn):
+    """Processes single client request.
+    Returns False if server should be stopped.
+    """
+    request, data = ipc.recv_message(conn)
+    cmd = request.get('cmd')
+    if cmd == 'ping':
+        ipc.send_message(conn, {'status': 0, 'messages': []})
+    elif cmd == 'shutdown':
+        ipc.send_message(conn, {'status': 0, 'messages': []})
+        return False
+    elif cmd == 'convert':
+        collector = MessageCollector()
+        status = 0
+        output = ''
+        # noinspection PyBroadException
+        try:
+            if 'files' in request:
+                files = [item.encode('utf-8') for item in request['files']]
+                convert(appdata, files, request.get('options', {}))
+            else:
+                output = _convert_stream(appdata, request, data)
+        except Exception:
+            status = 1
+        finally:
+            collector.close()
+        ipc.send_message(conn, {'status': status,
+                                'messages': collector.messages}, output)
+    else:
+        ipc.send_message(conn, {'status': 1, 'messages': [
+            [msgconst.ERROR, 'Unknown server command "%s"' % cmd]]})
+    return True
+
+
+def run_server(appdata, socket_path):
+    """Serves conversion requests on local Unix socket.
+    Loaders, savers and color management stay loaded between requests,
+    requests are processed sequentially.
+    """
+    preload_formats()
+    if os.path.exists(socket_path):
+        os.remove(socket_path)
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    # socket file is created owner-only, no window before chmod
+    umask = os.umask(0o077)
+    try:
+        sock.bind(socket_path)
+    finally:
+        os.umask(umask)
+    sock.listen(16)
+
+    msg = 'Conversion server is listening on %s' % socket_path
+    events.emit(events.MESSAGES, msgconst.INFO, msg)
+    try:
+        running = True
+        while running:
+            conn = sock.accept()[0]
+            conn.settimeout(CONN_TIMEOUT)
+            # noinspection PyBroadException
+            try:
+                running = handle_request(appdata, conn)
+            except Exception:
+                LOG.exception('Error processing server request')
+            finally:
+                conn.close()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+        if os.path.exists(socket_path):
+            os.remove(socket_path)
+    msg = 'Conversion server is stopped'
+    events.emit(events.MESSAGES, msgconst.INFO, msg)
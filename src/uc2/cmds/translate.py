@@ -15,10 +15,13 @@
 #  You should have received a copy of the GNU Affero General Public License
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import Queue
 import copy
 import glob
 import logging
+import multiprocessing
 import os
+import signal
 
 from uc2 import events, uc2const, msgconst
 from uc2.formats import get_loader, get_saver, get_saver_by_id
@@ -30,7 +33,7 @@ SAVER_IDS = uc2const.PALETTE_SAVERS + uc2const.MODEL_SAVERS \
 
 
 def normalize_options(options):
-    for key in ('verbose', 'format', 'recursive', 'dry-run'):
+    for key in ('verbose', 'format', 'recursive', 'dry-run', 'jobs'):
         if key in options:
             options.pop(key)
 
@@ -94,23 +97,7 @@ def convert(appdata, files, options):
         raise
 
     # File saving -----------------------------------------
-    if doc is not None:
-        try:
-            if loader_id in uc2const.PALETTE_LOADERS and \
-                    saver_id in uc2const.PALETTE_SAVERS:
-                saver(doc, files[1], translate=False, convert=True,
-                      **options)
-            else:
-                saver(doc, files[1], **options)
-        except Exception:
-            msg = 'Error while translation and saving "%s"' % files[0]
-            events.emit(events.MESSAGES, msgconst.ERROR, msg)
-
-            LOG.exception(msg)
-            msg2 = 'Translation is interrupted'
-            events.emit(events.MESSAGES, msgconst.STOP, msg2)
-            raise
-    else:
+    if doc is None:
         msg = 'Error creating model for "%s"' % files[0]
         events.emit(events.MESSAGES, msgconst.ERROR, msg)
 
@@ -118,7 +105,26 @@ def convert(appdata, files, options):
         events.emit(events.MESSAGES, msgconst.STOP, msg2)
         raise Exception(msg)
 
-    doc.close()
+    # document model is released on failure too, server and
+    # translation workers process many files in one process
+    try:
+        if loader_id in uc2const.PALETTE_LOADERS and \
+                saver_id in uc2const.PALETTE_SAVERS:
+            saver(doc, files[1], translate=False, convert=True,
+                  **options)
+        else:
+            saver(doc, files[1], **options)
+    except Exception:
+        msg = 'Error while translation and saving "%s"' % files[0]
+        events.emit(events.MESSAGES, msgconst.ERROR, msg)
+
+        LOG.exception(msg)
+        msg2 = 'Translation is interrupted'
+        events.emit(events.MESSAGES, msgconst.STOP, msg2)
+        raise
+    finally:
+        doc.close()
+
     msg = 'Translation is successful'
     events.emit(events.MESSAGES, msgconst.OK, msg)
 
@@ -158,13 +164,152 @@ def _get_filelist(path, subpath, wildcard, recursive=False):
     return filelist
 
 
+def _get_jobs_num(options):
+    jobs = options.get('jobs', 1)
+    if jobs is True or jobs == 0:
+        return multiprocessing.cpu_count()
+    if not isinstance(jobs, int) or jobs < 1 or os.name == 'nt':
+        return 1
+    return jobs
+
+
+def _report(filepath, out_filepath, success, options):
+    if options.get('verbose'):
+        echo()
+    elif options.get('verbose-short'):
+        status = '[  OK  ]' if success else '[ FAIL ]'
+        echo('Translation of "%s"' % filepath)
+        echo('into "%s" ...%s\n' % (out_filepath, status))
+
+
+# --- Parallel translation
+# Each file is translated by own worker process forked with already
+# loaded appdata and color management, so crash of native code on some
+# file (segfault etc.) fails this file only. Worker messages are collected
+# and replayed by parent process per file, so output is not interleaved.
+
+_WORKER_APPDATA = None
+_WORKER_MESSAGES = []
+# seconds between checks of worker processes state
+WORKER_POLL_TIMEOUT = 0.5
+
+
+def _collect_message(*args):
+    _WORKER_MESSAGES.append(args)
+
+
+def _init_worker():
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    events.clean_channel(events.MESSAGES)
+    events.connect(events.MESSAGES, _collect_message)
+
+
+def _convert_job(job):
+    filepath, out_filepath, options = job
+    _WORKER_MESSAGES[:] = []
+    success = True
+    # noinspection PyBroadException
+    try:
+        convert(_WORKER_APPDATA, (filepath, out_filepath), options)
+    except Exception:
+        success = False
+    return filepath, out_filepath, success, list(_WORKER_MESSAGES)
+
+
+def _run_worker(queue, index, job):
+    _init_worker()
+    # noinspection PyBroadException
+    try:
+        result = _convert_job(job)
+    except BaseException:
+        result = (job[0], job[1], False, list(_WORKER_MESSAGES))
+    queue.put((index, result))
+
+
+def _get_file_size(job):
+    try:
+        return os.path.getsize(job[0])
+    except OSError:
+        return 0
+
+
+def _emit_result(result, options):
+    filepath, out_filepath, success, messages = result
+    for args in messages:
+        events.emit(events.MESSAGES, *args)
+    _report(filepath, out_filepath, success, options)
+
+
+def _parallel_convert(appdata, jobs, options, jobs_num):
+    global _WORKER_APPDATA
+    _WORKER_APPDATA = appdata
+    # largest files first, next file is started when some worker exits
+    jobs = sorted(jobs, key=_get_file_size, reverse=True)
+    tasks = [(filepath, out_filepath, copy.deepcopy(options))
+             for filepath, out_filepath in jobs]
+    tasks.reverse()
+    queue = multiprocessing.Queue()
+    workers = {}
+    try:
+        while tasks or workers:
+            while tasks and len(workers) < jobs_num:
+                index = len(tasks) - 1
+                task = tasks.pop()
+                worker = multiprocessing.Process(target=_run_worker,
+                                                 args=(queue, index, task))
+                worker.daemon = True
+                worker.start()
+                workers[index] = (worker, task)
+            try:
+                index, result = queue.get(True, WORKER_POLL_TIMEOUT)
+            except Queue.Empty:
+                pass
+            else:
+                # result of crashed (already reported) worker is skipped
+                if index in workers:
+                    workers.pop(index)[0].join()
+                    _emit_result(result, options)
+            # worker which exited normally has already sent its result,
+            # it is read from queue on next iteration
+            for index, (worker, task) in workers.items():
+                if worker.exitcode not in (None, 0):
+                    workers.pop(index)
+                    msg = 'Translation of "%s" is crashed (exit code %d)' \
+                          % (task[0], worker.exitcode)
+                    _emit_result((task[0], task[1], False,
+                                  [(msgconst.ERROR, msg)]), options)
+    except BaseException:
+        for worker, task in workers.values():
+            worker.terminate()
+        raise
+    finally:
+        for worker, task in workers.values():
+            worker.join()
+        _WORKER_APPDATA = None
+
+
+def _convert_jobs(appdata, jobs, options):
+    jobs_num = _get_jobs_num(options)
+    if jobs_num > 1 and len(jobs) > 1:
+        _parallel_convert(appdata, jobs, options, jobs_num)
+        return
+
+    for filepath, out_filepath in jobs:
+        kw = copy.deepcopy(options)
+        success = True
+        try:
+            convert(appdata, (filepath, out_filepath), kw)
+        except Exception:
+            success = False
+        _report(filepath, out_filepath, success, options)
+
+
 def multiple_convert(appdata, files, options):
     saver_ext = _get_saver_extension(options)
-    verbose = bool(options.get('verbose'))
-    verbose_short = bool(options.get('verbose-short'))
 
     filelist = files[:-1]
     dir_path = files[-1]
+    jobs = []
     for filepath in filelist:
         if not os.path.exists(filepath):
             msg = 'File "%s" is not found' % filepath
@@ -172,24 +317,12 @@ def multiple_convert(appdata, files, options):
             continue
         filename = os.path.basename(filepath).split('.', 1)[0]
         out_filepath = os.path.join(dir_path, '%s.%s' % (filename, saver_ext))
-        kw = copy.deepcopy(options)
-        try:
-            convert(appdata, (filepath, out_filepath), kw)
-            if verbose:
-                echo()
-            elif verbose_short:
-                echo('Translation of "%s"' % filepath)
-                echo('into "%s" ...[  OK  ]\n' % out_filepath)
-        except Exception:
-            if verbose_short:
-                echo('Translation of "%s"' % filepath)
-                echo('into "%s" ...[ FAIL ]\n' % out_filepath)
+        jobs.append((filepath, out_filepath))
+    _convert_jobs(appdata, jobs, options)
 
 
 def wildcard_convert(appdata, files, options):
     saver_ext = _get_saver_extension(options)
-    verbose = bool(options.get('verbose'))
-    verbose_short = bool(options.get('verbose-short'))
 
     path = os.path.dirname(files[0])
     wildcard = os.path.basename(files[0])
@@ -200,20 +333,11 @@ def wildcard_convert(appdata, files, options):
         events.emit(events.MESSAGES, msgconst.STOP, msg)
         return
 
+    jobs = []
     for filepath, subpath, filename in filelist:
         dir_path = os.path.join(files[1], subpath)
         if not os.path.exists(dir_path):
             os.makedirs(dir_path)
         out_filepath = os.path.join(dir_path, '%s.%s' % (filename, saver_ext))
-        kw = copy.deepcopy(options)
-        try:
-            convert(appdata, (filepath, out_filepath), kw)
-            if verbose:
-                echo()
-            elif verbose_short:
-                echo('Translation of "%s"' % filepath)
-                echo('into "%s" ...[  OK  ]\n' % out_filepath)
-        except Exception:
-            if verbose_short:
-                echo('Translation of "%s"' % filepath)
-                echo('into "%s" ...[ FAIL ]\n' % out_filepath)
+        jobs.append((filepath, out_filepath))
+    _convert_jobs(appdata, jobs, options)
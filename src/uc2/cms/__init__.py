@@ -16,6 +16,10 @@
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import copy
+import hashlib
+import logging
+import os
+import threading
 from copy import deepcopy
 
 import libcms
@@ -26,6 +30,9 @@ from uc2.uc2const import COLOR_RGB, COLOR_CMYK, COLOR_LAB, COLOR_GRAY, \
 from uc2.uc2const import IMAGE_MONO, IMAGE_GRAY, IMAGE_RGB, IMAGE_CMYK, \
     IMAGE_LAB, IMAGE_TO_COLOR
 from uc2.utils import fsutils
+from uc2.utils.lrucache import LRUCache
+
+LOG = logging.getLogger(__name__)
 
 CS = [COLOR_RGB, COLOR_CMYK, COLOR_LAB, COLOR_GRAY]
 
@@ -447,6 +454,19 @@ def get_profile_descr(filepath):
     return ret
 
 
+class ColorCache(LRUCache):
+    """LRU cache of color transform results. Values are stored
+    as tuples and returned as new lists.
+    """
+
+    def get(self, key):
+        value = LRUCache.get(self, key)
+        return None if value is None else list(value)
+
+    def put(self, key, value):
+        LRUCache.put(self, key, tuple(value))
+
+
 class ColorManager(object):
     """The class provides abstract color manager.
     On CM object instantiation default built-in profiles
@@ -454,8 +474,15 @@ class ColorManager(object):
     """
 
     handles = None
+    handle_hashes = None
     transforms = None
     proof_transforms = None
+    transform_cache_dir = ''
+    transform_cache_size = 16  # MiB, 0 - unlimited
+    transform_cache_stats = None
+    transform_lock = None
+    color_cache = None
+    color_cache_size = 4096
 
     use_cms = True
     use_display_profile = False
@@ -467,6 +494,7 @@ class ColorManager(object):
     rgb_intent = uc2const.INTENT_RELATIVE_COLORIMETRIC
     cmyk_intent = uc2const.INTENT_PERCEPTUAL
     flags = uc2const.cmsFLAGS_NOTPRECALC
+    bitmap_threads = 1
 
     def __init__(self):
         self.update()
@@ -481,8 +509,128 @@ class ColorManager(object):
             self.handles[item] = libcms.cms_create_default_profile(item)
 
     def clear_transforms(self):
+        if self.transform_lock is None:
+            # renderer threads may create transforms concurrently
+            self.transform_lock = threading.RLock()
         self.transforms = {}
         self.proof_transforms = {}
+        self.handle_hashes = {}
+        self.transform_cache_stats = {'hits': 0, 'misses': 0}
+        if self.color_cache is None:
+            self.color_cache = ColorCache(self.color_cache_size)
+        self.color_cache.clear()
+
+    def get_color_cache_stats(self):
+        """
+        Returns dict of color cache counters (size, hits, misses, evictions).
+        """
+        return self.color_cache.get_stats()
+
+    def get_intent(self, cs_out):
+        """
+        Returns rendering intent used for transforms into cs_out.
+        """
+        return self.cmyk_intent if cs_out == COLOR_CMYK else self.rgb_intent
+
+    def get_profile_hash(self, cs):
+        """
+        Returns md5 hash of profile content used for colorspace.
+        """
+        if cs not in self.handle_hashes:
+            data = libcms.cms_get_profile_bytes(self.handles[cs])
+            self.handle_hashes[cs] = hashlib.md5(data).hexdigest()
+        return self.handle_hashes[cs]
+
+    def get_cached_transform(self, key_items, in_mode, out_mode, intent,
+                             builder):
+        """
+        Returns transform stored as device-link profile in
+        self.transform_cache_dir. If there is no such transform,
+        builds it using builder callable and stores into cache.
+        Transform is always re-created from device-link data, so
+        results do not depend on cache state.
+        """
+        if not self.transform_cache_dir or \
+                self.flags & uc2const.cmsFLAGS_GAMUTCHECK:
+            return builder()
+        try:
+            key_items = [self.get_profile_hash(cs) for cs in key_items[0]] + \
+                        [str(item) for item in key_items[1:]] + \
+                        [libcms.get_version()]
+        except Exception:
+            LOG.warning('Cannot calculate transform cache key')
+            return builder()
+        key = hashlib.md5('|'.join(key_items)).hexdigest()
+        path = os.path.join(self.transform_cache_dir, key + '.icc')
+        path = fsutils.get_sys_path(path)
+
+        def load_devicelink(data):
+            devicelink = libcms.cms_open_profile_from_string(data)
+            return libcms.cms_create_devicelink_transform(
+                devicelink, in_mode, out_mode, intent, self.flags)
+
+        if os.path.isfile(path):
+            try:
+                with open(path, 'rb') as fileptr:
+                    tr = load_devicelink(fileptr.read())
+                # mtime marks recently used transforms for cache pruning
+                os.utime(path, None)
+                self.transform_cache_stats['hits'] += 1
+                return tr
+            except Exception:
+                LOG.warning('Cannot load cached transform %s', path)
+        self.transform_cache_stats['misses'] += 1
+        tr = builder()
+        try:
+            data = libcms.cms_transform_to_devicelink(tr)
+        except Exception:
+            LOG.warning('Cannot convert transform into device-link')
+            return tr
+        try:
+            if not os.path.isdir(os.path.dirname(path)):
+                os.makedirs(os.path.dirname(path))
+            tmp_path = '%s.%d.tmp' % (path, os.getpid())
+            with open(tmp_path, 'wb') as fileptr:
+                fileptr.write(data)
+            os.rename(tmp_path, path)
+            self.prune_transform_cache()
+        except Exception:
+            LOG.warning('Cannot store transform into cache %s', path)
+        try:
+            return load_devicelink(data)
+        except Exception:
+            LOG.warning('Cannot load device-link transform')
+            return tr
+
+    def prune_transform_cache(self):
+        """
+        Removes least recently used transforms from
+        self.transform_cache_dir while its size exceeds
+        self.transform_cache_size (MiB).
+        """
+        if not self.transform_cache_size:
+            return
+        cache_dir = fsutils.get_sys_path(self.transform_cache_dir)
+        items = []
+        for name in os.listdir(cache_dir):
+            if not name.endswith('.icc'):
+                continue
+            path = os.path.join(cache_dir, name)
+            try:
+                stat = os.stat(path)
+            except OSError:
+                continue
+            items.append((stat.st_mtime, stat.st_size, path))
+        total = sum([item[1] for item in items])
+        limit = self.transform_cache_size * 1024 * 1024
+        for _mtime, size, path in sorted(items):
+            if total <= limit:
+                break
+            try:
+                os.remove(path)
+            except OSError:
+                continue
+            total -= size
 
     def get_transform(self, cs_in, cs_out):
         """
@@ -490,17 +638,28 @@ class ColorManager(object):
         If requested transform is not initialized yet, creates it.
         """
         tr_type = cs_in + cs_out
-        intent = self.rgb_intent
-        if cs_out == COLOR_CMYK:
-            intent = self.cmyk_intent
+        intent = self.get_intent(cs_out)
+        transform = self.transforms.get(tr_type)
+        if transform is not None:
+            return transform
+        with self.transform_lock:
+            return self._create_transform(tr_type, cs_in, cs_out, intent)
+
+    def _create_transform(self, tr_type, cs_in, cs_out, intent):
         if tr_type not in self.transforms:
             handle_in = self.handles[cs_in]
             handle_out = self.handles[cs_out]
+            key_items = [(cs_in, cs_out), tr_type, intent, self.flags]
             if cs_out == COLOR_DISPLAY:
                 cs_out = COLOR_RGB
-            tr = libcms.cms_create_transform(handle_in, cs_in,
-                                             handle_out, cs_out,
-                                             intent, self.flags)
+
+            def builder():
+                return libcms.cms_create_transform(handle_in, cs_in,
+                                                   handle_out, cs_out,
+                                                   intent, self.flags)
+
+            tr = self.get_cached_transform(key_items, cs_in, cs_out,
+                                           intent, builder)
             self.transforms[tr_type] = tr
         return self.transforms[tr_type]
 
@@ -510,19 +669,34 @@ class ColorManager(object):
         If requested transform is not initialized yet, creates it.
         """
         tr_type = cs_in
+        transform = self.proof_transforms.get(tr_type)
+        if transform is not None:
+            return transform
+        with self.transform_lock:
+            return self._create_proof_transform(tr_type, cs_in)
+
+    def _create_proof_transform(self, tr_type, cs_in):
         if tr_type not in self.proof_transforms:
             handle_in = self.handles[cs_in]
+            cs_out = COLOR_RGB
             if self.use_display_profile and COLOR_DISPLAY in self.handles:
-                handle_out = self.handles[COLOR_DISPLAY]
-            else:
-                handle_out = self.handles[COLOR_RGB]
+                cs_out = COLOR_DISPLAY
+            handle_out = self.handles[cs_out]
             handle_proof = self.handles[COLOR_CMYK]
-            tr = libcms.cms_create_proofing_transform(handle_in, cs_in,
-                                                      handle_out, COLOR_RGB,
-                                                      handle_proof,
-                                                      self.cmyk_intent,
-                                                      self.rgb_intent,
-                                                      self.flags)
+            key_items = [(cs_in, cs_out, COLOR_CMYK), 'proof', tr_type,
+                         self.cmyk_intent, self.rgb_intent, self.flags]
+
+            def builder():
+                return libcms.cms_create_proofing_transform(handle_in, cs_in,
+                                                            handle_out,
+                                                            COLOR_RGB,
+                                                            handle_proof,
+                                                            self.cmyk_intent,
+                                                            self.rgb_intent,
+                                                            self.flags)
+
+            tr = self.get_cached_transform(key_items, cs_in, COLOR_RGB,
+                                           self.cmyk_intent, builder)
             self.proof_transforms[tr_type] = tr
         return self.proof_transforms[tr_type]
 
@@ -534,14 +708,59 @@ class ColorManager(object):
         if not self.use_cms:
             return do_simple_transform(color[1], cs_in, cs_out)
         in_color = colorb(color)
-        out_color = colorb()
-        transform = self.get_transform(cs_in, cs_out)
-        libcms.cms_do_transform(transform, in_color, out_color)
+        key = (cs_in, cs_out, self.get_intent(cs_out), tuple(in_color))
+        out_color = self.color_cache.get(key)
+        if out_color is None:
+            out_color = colorb()
+            transform = self.get_transform(cs_in, cs_out)
+            libcms.cms_do_transform(transform, in_color, out_color)
+            self.color_cache.put(key, out_color)
         return decode_colorb(out_color, cs_out)
 
-    def do_bitmap_transform(self, img, mode, cs_out=None):
+    def do_transforms(self, colors, cs_in, cs_out):
+        """
+        Converts list of colors of the same colorspace in single pass.
+        Returns list of color values lists.
+        """
+        if not colors:
+            return []
+        if not self.use_cms:
+            return [do_simple_transform(color[1], cs_in, cs_out)
+                    for color in colors]
+        intent = self.get_intent(cs_out)
+        # grayscale transforms use single byte per color
+        in_size = 1 if cs_in == COLOR_GRAY else 4
+        out_size = 1 if cs_out == COLOR_GRAY else 4
+        result = []
+        missed = []
+        in_buff = bytearray()
+        for color in colors:
+            in_color = colorb(color)
+            key = (cs_in, cs_out, intent, tuple(in_color))
+            out_color = self.color_cache.get(key)
+            if out_color is None:
+                missed.append((len(result), key))
+                in_buff.extend([value & 0xff for value in in_color[:in_size]])
+            result.append(out_color)
+        if missed:
+            count = len(missed)
+            in_buff.extend(bytearray(4 * count - len(in_buff)))
+            out_buff = bytearray(4 * count)
+            transform = self.get_transform(cs_in, cs_out)
+            libcms.cms_do_transform_buffer(transform, in_buff, out_buff,
+                                           count)
+            for i, (index, key) in enumerate(missed):
+                out_color = list(out_buff[i * out_size:(i + 1) * out_size])
+                out_color += [0] * (4 - out_size)
+                self.color_cache.put(key, out_color)
+                result[index] = out_color
+        return [decode_colorb(out_color, cs_out) for out_color in result]
+
+    def do_bitmap_transform(self, img, mode, cs_out=None, threads=None):
         """
         Does image proof transform.
+        Threads number defaults to self.bitmap_threads
+        (0 - use all CPU cores).
         Returns new image instance.
         """
         if not self.use_cms and not img.mode == IMAGE_LAB:
@@ -549,8 +768,11 @@ class ColorManager(object):
         cs_in = IMAGE_TO_COLOR[img.mode]
         if not cs_out:
             cs_out = IMAGE_TO_COLOR[mode]
+        if threads is None:
+            threads = self.bitmap_threads
         transform = self.get_transform(cs_in, cs_out)
-        return libcms.cms_do_bitmap_transform(transform, img, img.mode, mode)
+        return libcms.cms_do_bitmap_transform(transform, img, img.mode, mode,
+                                              threads)
 
     def do_proof_transform(self, color, cs_in):
         """
@@ -558,9 +780,14 @@ class ColorManager(object):
         Returns list of color values.
         """
         in_color = colorb(color)
-        out_color = colorb()
-        transform = self.get_proof_transform(cs_in)
-        libcms.cms_do_transform(transform, in_color, out_color)
+        key = (cs_in, 'proof', self.cmyk_intent, self.rgb_intent,
+               tuple(in_color))
+        out_color = self.color_cache.get(key)
+        if out_color is None:
+            out_color = colorb()
+            transform = self.get_proof_transform(cs_in)
+            libcms.cms_do_transform(transform, in_color, out_color)
+            self.color_cache.put(key, out_color)
         return decode_colorb(out_color, COLOR_RGB)
 
     def do_proof_bitmap_transform(self, img):
@@ -571,7 +798,8 @@ class ColorManager(object):
         cs_in = IMAGE_TO_COLOR[img.mode]
         mode = IMAGE_RGB
         transform = self.get_proof_transform(cs_in)
-        return libcms.cms_do_bitmap_transform(transform, img, img.mode, mode)
+        return libcms.cms_do_bitmap_transform(transform, img, img.mode, mode,
+                                              self.bitmap_threads)
 
     # Color management API
     def get_rgb_color(self, color):
@@ -658,6 +886,41 @@ class ColorManager(object):
                        COLOR_GRAY: self.get_grayscale_color}
         return methods_map[cs](color)
 
+    def get_colors(self, colors, cs=COLOR_RGB):
+        """
+        Batch version of get_color(). Converts list of colors into
+        requested colorspace using single transform call per source
+        colorspace. Stores alpha channel and color name.
+        Returns list of colors in the same order.
+        """
+        result = [None] * len(colors)
+        groups = {}
+        for index, color in enumerate(colors):
+            if color[0] == cs:
+                result[index] = deepcopy(color)
+                continue
+            if color[0] == COLOR_SPOT:
+                rgb, cmyk = color[1][0], color[1][1]
+                if cs == COLOR_RGB and rgb:
+                    result[index] = [COLOR_RGB, [] + rgb, color[2], color[3]]
+                    continue
+                elif cs == COLOR_CMYK and cmyk:
+                    result[index] = [COLOR_CMYK, [] + cmyk, color[2], color[3]]
+                    continue
+                elif cs == COLOR_CMYK or rgb:
+                    color = [COLOR_RGB, [] + rgb, color[2], color[3]]
+                else:
+                    color = [COLOR_CMYK, [] + cmyk, color[2], color[3]]
+                if color[0] == cs:
+                    result[index] = color
+                    continue
+            groups.setdefault(color[0], []).append((index, color))
+        for cs_in, items in groups.items():
+            vals = self.do_transforms([item[1] for item in items], cs_in, cs)
+            for (index, color), res in zip(items, vals):
+                result[index] = [cs, res, color[2], color[3]]
+        return result
+
     def mix_colors(self, color0, color1, coef=.5):
         supported = [COLOR_RGB, COLOR_CMYK, COLOR_GRAY]
         if not color0[0] in supported:
@@ -732,12 +995,13 @@ class ColorManager(object):
             return ret.convert(IMAGE_MONO)
         return self.do_bitmap_transform(img, outmode, cs_out)
 
-    def adjust_image(self, img, profilestr):
+    def adjust_image(self, img, profilestr, inplace=False):
         """
         Adjust image with embedded profile to similar colorspace
         defined by current profile.
         profilestr - embedded profile as a python string.
-        Returns new image instance.
+        inplace - transform pixels of provided image without copying.
+        Returns new image instance or img for in-place mode.
         """
         custom_profile = libcms.cms_open_profile_from_string(profilestr)
         cs_in = cs_out = IMAGE_TO_COLOR[img.mode]
@@ -748,7 +1012,11 @@ class ColorManager(object):
         transform = libcms.cms_create_transform(custom_profile, cs_in,
                                                 out_profile, cs_out, intent,
                                                 self.flags)
-        return libcms.cms_do_bitmap_transform(transform, img, cs_in, cs_out)
+        if inplace:
+            return libcms.cms_do_bitmap_transform_inplace(transform, img,
+                                                          self.bitmap_threads)
+        return libcms.cms_do_bitmap_transform(transform, img, cs_in, cs_out,
+                                              self.bitmap_threads)
 
     def get_display_image(self, img):
         """
@@ -18,8 +18,15 @@
 
 #include <Python.h>
 #include <lcms2.h>
+#include <stdint.h>
 #include "Imaging.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
 /* redefine the ImagingObject struct defined in _imagingmodule.c */
 typedef struct {
     PyObject_HEAD
@@ -231,6 +238,102 @@ pycms_BuildProofingTransform (PyObject *self, PyObject *args) {
 	return Py_BuildValue("O", PyCObject_FromVoidPtr((void *)hTransform, (void *)cmsDeleteTransform));
 }
 
+static PyObject *
+pycms_BuildDeviceLinkTransform (PyObject *self, PyObject *args) {
+
+	char *inMode;
+	char *outMode;
+	int renderingIntent;
+	int inFlags;
+	cmsUInt32Number flags;
+	void *deviceLink;
+	cmsHPROFILE hDeviceLink;
+	cmsHTRANSFORM hTransform;
+
+	if (!PyArg_ParseTuple(args, "Ossii", &deviceLink, &inMode, &outMode, &renderingIntent, &inFlags)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	hDeviceLink = (cmsHPROFILE) PyCObject_AsVoidPtr(deviceLink);
+	flags = (cmsUInt32Number) inFlags;
+
+	hTransform = cmsCreateTransform(hDeviceLink, getLCMStype(inMode),
+			NULL, getLCMStype(outMode), renderingIntent, flags);
+
+	if(hTransform==NULL) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return Py_BuildValue("O", PyCObject_FromVoidPtr((void *)hTransform, (void *)cmsDeleteTransform));
+}
+
+static PyObject *
+profile_to_string (cmsHPROFILE hProfile) {
+
+	cmsUInt32Number size = 0;
+	char *buffer;
+	PyObject *ret;
+
+	if (!cmsSaveProfileToMem(hProfile, NULL, &size) || !size) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	buffer = malloc(size);
+	if (buffer == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	if (!cmsSaveProfileToMem(hProfile, buffer, &size)) {
+		free(buffer);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	ret = Py_BuildValue("s#", buffer, (int) size);
+	free(buffer);
+	return ret;
+}
+
+static PyObject *
+pycms_GetProfileBytes (PyObject *self, PyObject *args) {
+
+	void *profile;
+
+	if (!PyArg_ParseTuple(args, "O", &profile)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return profile_to_string((cmsHPROFILE) PyCObject_AsVoidPtr(profile));
+}
+
+static PyObject *
+pycms_TransformToDeviceLink (PyObject *self, PyObject *args) {
+
+	void *transform;
+	cmsHPROFILE hDeviceLink;
+	PyObject *ret;
+
+	if (!PyArg_ParseTuple(args, "O", &transform)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	hDeviceLink = cmsTransform2DeviceLink((cmsHTRANSFORM) PyCObject_AsVoidPtr(transform), 4.3, 0);
+
+	if(hDeviceLink==NULL) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	ret = profile_to_string(hDeviceLink);
+	cmsCloseProfile(hDeviceLink);
+	return ret;
+}
+
 static PyObject *
 pycms_SetAlarmCodes (PyObject *self, PyObject *args) {
 
@@ -313,6 +416,342 @@ pycms_TransformPixel2 (PyObject *self, PyObject *args) {
 	return result;
 }
 
+/* Transforms count 4-byte colors packed into contiguous buffer
+ * in one cmsDoTransform call. Input and output can be any objects
+ * supporting buffer protocol (bytearray, array('B'), str for input).
+ * Returns number of transformed colors or None on error.
+ */
+static PyObject *
+pycms_TransformPixelsBuffer (PyObject *self, PyObject *args) {
+
+	Py_buffer inbuf, outbuf;
+	int count;
+	void *transform;
+	cmsHTRANSFORM hTransform;
+
+	if (!PyArg_ParseTuple(args, "Os*w*i", &transform, &inbuf, &outbuf, &count)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	if (count < 0 || (size_t) count > SIZE_MAX / 4 ||
+			inbuf.len / 4 < count || outbuf.len / 4 < count) {
+		PyBuffer_Release(&inbuf);
+		PyBuffer_Release(&outbuf);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	hTransform = (cmsHTRANSFORM) PyCObject_AsVoidPtr(transform);
+
+	if (count) {
+		Py_BEGIN_ALLOW_THREADS
+		cmsDoTransform(hTransform, inbuf.buf, outbuf.buf, count);
+		Py_END_ALLOW_THREADS
+	}
+
+	PyBuffer_Release(&inbuf);
+	PyBuffer_Release(&outbuf);
+	return Py_BuildValue("i", count);
+}
+
+/* Float transform keeps lcms transform built for double formats
+ * together with scaling of 0.0-1.0 channel values into lcms
+ * floating point ranges (CMYK 0-100, Lab L 0-100 and a/b -128-127).
+ * Every color takes 4 doubles, unused channels are extra ones.
+ */
+#define TYPE_RGBX_DBL (FLOAT_SH(1)|COLORSPACE_SH(PT_RGB)|EXTRA_SH(1)|CHANNELS_SH(3)|BYTES_SH(0))
+#define TYPE_LabX_DBL (FLOAT_SH(1)|COLORSPACE_SH(PT_Lab)|EXTRA_SH(1)|CHANNELS_SH(3)|BYTES_SH(0))
+#define TYPE_GRAYX_DBL (FLOAT_SH(1)|COLORSPACE_SH(PT_GRAY)|EXTRA_SH(3)|CHANNELS_SH(1)|BYTES_SH(0))
+
+static char float_transform_desc[] = "float transform";
+
+typedef struct {
+	cmsHTRANSFORM hTransform;
+	double in_scale[4], in_shift[4];
+	double out_scale[4], out_shift[4];
+	int out_channels;
+} FloatTransform;
+
+static cmsUInt32Number
+getLCMSfloattype (char *mode, double *scale, double *shift, int *channels) {
+
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		scale[i] = 1.0;
+		shift[i] = 0.0;
+	}
+
+	if (strcmp(mode, "RGB") == 0 || strcmp(mode, "RGBA") == 0 ||
+			strcmp(mode, "RGBX") == 0) {
+		*channels = 3;
+		return TYPE_RGBX_DBL;
+	}
+	else if (strcmp(mode, "CMYK") == 0) {
+		for (i = 0; i < 4; i++) {
+			scale[i] = 100.0;
+		}
+		*channels = 4;
+		return TYPE_CMYK_DBL;
+	}
+	else if (strcmp(mode, "LAB") == 0) {
+		scale[0] = 100.0;
+		scale[1] = scale[2] = 255.0;
+		shift[1] = shift[2] = -128.0;
+		*channels = 3;
+		return TYPE_LabX_DBL;
+	}
+
+	*channels = 1;
+	return TYPE_GRAYX_DBL;
+}
+
+static void
+free_float_transform (void *ptr, void *desc) {
+
+	FloatTransform *transform = (FloatTransform *) ptr;
+
+	cmsDeleteTransform(transform->hTransform);
+	free(transform);
+}
+
+static PyObject *
+pycms_BuildFloatTransform (PyObject *self, PyObject *args) {
+
+	char *inMode;
+	char *outMode;
+	int renderingIntent;
+	int inFlags, in_channels;
+	cmsUInt32Number inType, outType;
+	void *inputProfile;
+	void *outputProfile;
+	FloatTransform *transform;
+
+	if (!PyArg_ParseTuple(args, "OsOsii", &inputProfile, &inMode, &outputProfile, &outMode, &renderingIntent, &inFlags)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	transform = (FloatTransform *) malloc(sizeof(FloatTransform));
+	if (transform == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	inType = getLCMSfloattype(inMode, transform->in_scale,
+			transform->in_shift, &in_channels);
+	outType = getLCMSfloattype(outMode, transform->out_scale,
+			transform->out_shift, &transform->out_channels);
+
+	transform->hTransform = cmsCreateTransform(
+			(cmsHPROFILE) PyCObject_AsVoidPtr(inputProfile), inType,
+			(cmsHPROFILE) PyCObject_AsVoidPtr(outputProfile), outType,
+			renderingIntent, (cmsUInt32Number) inFlags);
+
+	if(transform->hTransform==NULL) {
+		free(transform);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return PyCObject_FromVoidPtrAndDesc((void *)transform,
+			(void *)float_transform_desc, free_float_transform);
+}
+
+/* Float variant of transformPixelsBuffer for transforms created by
+ * buildFloatTransform. Buffers should contain 4 doubles per color
+ * in 0.0-1.0 range (array('d') for example), values are transformed
+ * without 8-bit quantization. Unused output channels are zeroed.
+ * Returns number of transformed colors or None on error.
+ */
+static PyObject *
+pycms_TransformPixelsBuffer2 (PyObject *self, PyObject *args) {
+
+	Py_buffer inbuf, outbuf;
+	int count, i, j;
+	double *indata, *outdata;
+	PyObject *transform;
+	FloatTransform *ft;
+
+	if (!PyArg_ParseTuple(args, "Os*w*i", &transform, &inbuf, &outbuf, &count)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	if (!PyCObject_Check(transform) ||
+			PyCObject_GetDesc(transform) != float_transform_desc ||
+			count < 0 || (size_t) count > SIZE_MAX / (4 * sizeof(double)) ||
+			inbuf.len / (4 * (Py_ssize_t) sizeof(double)) < count ||
+			outbuf.len / (4 * (Py_ssize_t) sizeof(double)) < count) {
+		PyBuffer_Release(&inbuf);
+		PyBuffer_Release(&outbuf);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	ft = (FloatTransform *) PyCObject_AsVoidPtr(transform);
+	indata = (double *) inbuf.buf;
+	outdata = (double *) outbuf.buf;
+
+	Py_BEGIN_ALLOW_THREADS
+	/* scaled copy is transformed in place, so input stays untouched */
+	for (i = 0; i < count * 4; i += 4) {
+		for (j = 0; j < 4; j++) {
+			outdata[i + j] = indata[i + j] * ft->in_scale[j] + ft->in_shift[j];
+		}
+	}
+	if (count) {
+		cmsDoTransform(ft->hTransform, outdata, outdata, count);
+	}
+	for (i = 0; i < count * 4; i += 4) {
+		for (j = 0; j < 4; j++) {
+			if (j < ft->out_channels) {
+				outdata[i + j] = (outdata[i + j] - ft->out_shift[j]) /
+						ft->out_scale[j];
+			} else {
+				outdata[i + j] = 0.0;
+			}
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	PyBuffer_Release(&inbuf);
+	PyBuffer_Release(&outbuf);
+	return Py_BuildValue("i", count);
+}
+
+/* Returns size of pixel in bytes for lcms pixel format */
+static int
+format_pixel_size(cmsUInt32Number format) {
+
+	int bytes = T_BYTES(format);
+
+	/* zero means double precision values */
+	if (!bytes) bytes = sizeof(double);
+
+	return bytes * (T_CHANNELS(format) + T_EXTRA(format));
+}
+
+/* Row band of the bitmap processed by single worker thread */
+typedef struct {
+	cmsHTRANSFORM hTransform;
+	Imaging inImg;
+	Imaging outImg;
+	int width;
+	int start;
+	int end;
+} TransformBand;
+
+static void
+transform_band(TransformBand *band) {
+
+	int i;
+
+	for (i = band->start; i < band->end; i++) {
+		cmsDoTransform(band->hTransform, band->inImg->image[i],
+				band->outImg->image[i], band->width);
+	}
+}
+
+#ifdef _WIN32
+static DWORD WINAPI
+transform_band_worker(LPVOID arg) {
+	transform_band((TransformBand *) arg);
+	return 0;
+}
+#else
+static void *
+transform_band_worker(void *arg) {
+	transform_band((TransformBand *) arg);
+	return NULL;
+}
+#endif
+
+/* Splits bitmap rows into bands and transforms them concurrently.
+ * lcms2 transforms are reentrant for cmsDoTransform calls (the color
+ * cache is copied per call) so all bands share the same transform.
+ * Must be called without GIL.
+ */
+static void
+transform_bitmap_threaded(cmsHTRANSFORM hTransform, Imaging inImg,
+		Imaging outImg, int width, int height, int threads) {
+
+	int i, band_height, started;
+	TransformBand *bands;
+#ifdef _WIN32
+	HANDLE *workers;
+#else
+	pthread_t *workers;
+	char *created;
+#endif
+
+	bands = malloc(threads * sizeof(TransformBand));
+	workers = malloc(threads * sizeof(*workers));
+#ifdef _WIN32
+	if (bands == NULL || workers == NULL) {
+#else
+	created = calloc(threads, 1);
+	if (bands == NULL || workers == NULL || created == NULL) {
+		free(created);
+#endif
+		free(bands);
+		free(workers);
+		/* fallback to single band */
+		for (i = 0; i < height; i++) {
+			cmsDoTransform(hTransform, inImg->image[i], outImg->image[i], width);
+		}
+		return;
+	}
+
+	band_height = (height + threads - 1) / threads;
+	started = 0;
+
+	for (i = 0; i < threads; i++) {
+		bands[i].hTransform = hTransform;
+		bands[i].inImg = inImg;
+		bands[i].outImg = outImg;
+		bands[i].width = width;
+		bands[i].start = i * band_height;
+		bands[i].end = (i + 1) * band_height;
+		if (bands[i].end > height) bands[i].end = height;
+		if (bands[i].start >= bands[i].end) break;
+		started++;
+	}
+
+	/* First band is processed by calling thread */
+	for (i = 1; i < started; i++) {
+#ifdef _WIN32
+		workers[i] = CreateThread(NULL, 0, transform_band_worker, &bands[i], 0, NULL);
+		if (workers[i] == NULL) transform_band(&bands[i]);
+#else
+		if (pthread_create(&workers[i], NULL, transform_band_worker, &bands[i]) == 0) {
+			created[i] = 1;
+		} else {
+			transform_band(&bands[i]);
+		}
+#endif
+	}
+
+	if (started) transform_band(&bands[0]);
+
+	for (i = 1; i < started; i++) {
+#ifdef _WIN32
+		if (workers[i] != NULL) {
+			WaitForSingleObject(workers[i], INFINITE);
+			CloseHandle(workers[i]);
+		}
+#else
+		if (created[i]) pthread_join(workers[i], NULL);
+#endif
+	}
+
+#ifndef _WIN32
+	free(created);
+#endif
+	free(workers);
+	free(bands);
+}
+
 static PyObject *
 pycms_TransformBitmap (PyObject *self, PyObject *args) {
 
@@ -322,8 +761,9 @@ pycms_TransformBitmap (PyObject *self, PyObject *args) {
 	void *transform;
 	cmsHTRANSFORM hTransform;
 	int width, height, i;
+	int threads = 1;
 
-	if (!PyArg_ParseTuple(args, "OOOii", &transform, &inImage, &outImage, &width, &height)) {
+	if (!PyArg_ParseTuple(args, "OOOii|i", &transform, &inImage, &outImage, &width, &height, &threads)) {
 		Py_INCREF(Py_None);
 		return Py_None;
 	}
@@ -333,14 +773,69 @@ pycms_TransformBitmap (PyObject *self, PyObject *args) {
 
 	hTransform = (cmsHTRANSFORM) PyCObject_AsVoidPtr(transform);
 
-	for (i = 0; i < height; i++) {
-		cmsDoTransform(hTransform, inImg->image[i],	outImg->image[i], width);
+	if (threads > height) threads = height;
+
+	Py_BEGIN_ALLOW_THREADS
+	if (threads > 1) {
+		transform_bitmap_threaded(hTransform, inImg, outImg, width, height, threads);
+	} else {
+		for (i = 0; i < height; i++) {
+			cmsDoTransform(hTransform, inImg->image[i],	outImg->image[i], width);
+		}
 	}
+	Py_END_ALLOW_THREADS
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
+/* Transforms bitmap pixels directly in Imaging rows without
+ * allocating destination image. Requires transform with equal
+ * input and output pixel sizes which fit into image pixel.
+ * Returns None on error.
+ */
+static PyObject *
+pycms_TransformBitmapInPlace (PyObject *self, PyObject *args) {
+
+	ImagingObject* image;
+	Imaging img;
+	void *transform;
+	cmsHTRANSFORM hTransform;
+	int width, height, i, in_size, out_size;
+	int threads = 1;
+
+	if (!PyArg_ParseTuple(args, "OOii|i", &transform, &image, &width, &height, &threads)) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	img = image->image;
+	hTransform = (cmsHTRANSFORM) PyCObject_AsVoidPtr(transform);
+
+	in_size = format_pixel_size(cmsGetTransformInputFormat(hTransform));
+	out_size = format_pixel_size(cmsGetTransformOutputFormat(hTransform));
+
+	if (in_size != out_size || in_size > img->pixelsize ||
+			width > img->xsize || height > img->ysize) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	if (threads > height) threads = height;
+
+	Py_BEGIN_ALLOW_THREADS
+	if (threads > 1) {
+		transform_bitmap_threaded(hTransform, img, img, width, height, threads);
+	} else {
+		for (i = 0; i < height; i++) {
+			cmsDoTransform(hTransform, img->image[i], img->image[i], width);
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	return Py_BuildValue("i", height);
+}
+
 #define BUFFER_SIZE 1000
 
 static PyObject *
@@ -486,7 +981,7 @@ pycms_TransformPixels (PyObject *self, PyObject *args) {
 
 	hTransform = (cmsHTRANSFORM) PyCObject_AsVoidPtr(transform);
 	pixbuf = (unsigned char *) PyCObject_AsVoidPtr(pixels);
-	result=malloc(width*4);
+	result=malloc(width * format_pixel_size(cmsGetTransformOutputFormat(hTransform)));
 
 	cmsDoTransform(hTransform, pixbuf, result, width);
 
@@ -507,11 +1002,18 @@ PyMethodDef pycms_methods[] = {
 	{"createLabProfile", pycms_CreateLabProfile, METH_VARARGS},
 	{"createGrayProfile", pycms_CreateGrayProfile, METH_VARARGS},
 	{"buildTransform", pycms_BuildTransform, METH_VARARGS},
+	{"buildFloatTransform", pycms_BuildFloatTransform, METH_VARARGS},
 	{"buildProofingTransform", pycms_BuildProofingTransform, METH_VARARGS},
+	{"buildDeviceLinkTransform", pycms_BuildDeviceLinkTransform, METH_VARARGS},
+	{"getProfileBytes", pycms_GetProfileBytes, METH_VARARGS},
+	{"transformToDeviceLink", pycms_TransformToDeviceLink, METH_VARARGS},
 	{"setAlarmCodes", pycms_SetAlarmCodes, METH_VARARGS},
 	{"transformPixel", pycms_TransformPixel, METH_VARARGS},
 	{"transformPixel2", pycms_TransformPixel2, METH_VARARGS},
+	{"transformPixelsBuffer", pycms_TransformPixelsBuffer, METH_VARARGS},
+	{"transformPixelsBuffer2", pycms_TransformPixelsBuffer2, METH_VARARGS},
 	{"transformBitmap", pycms_TransformBitmap, METH_VARARGS},
+	{"transformBitmapInPlace", pycms_TransformBitmapInPlace, METH_VARARGS},
 	{"getProfileName", pycms_GetProfileName, METH_VARARGS},
 	{"getProfileInfo", pycms_GetProfileInfo, METH_VARARGS},
 	{"getProfileInfoCopyright", pycms_GetProfileInfoCopyright, METH_VARARGS},
@@ -17,6 +17,7 @@
 #  You should have received a copy of the GNU Affero General Public License
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import multiprocessing
 import os
 from PIL import Image
 
@@ -356,6 +357,35 @@ def cms_create_transform(in_profile, in_mode, out_profile, out_mode,
     return result
 
 
+def cms_create_float_transform(in_profile, in_mode, out_profile, out_mode,
+                               intent=uc2const.INTENT_PERCEPTUAL,
+                               flags=uc2const.cmsFLAGS_NOTPRECALC):
+    """Returns a handle to lcms transformation for double precision
+    color values (see cms_do_transform_buffer2).
+
+    :param in_profile: valid lcms profile handle
+    :param in_mode: RGB, CMYK, LAB or L mode
+    :param out_profile: valid lcms profile handle
+    :param out_mode: RGB, CMYK, LAB or L mode
+    :param intent: integer constant (0-3) of transform rendering intent
+    :param flags: lcms flags
+
+    :return: handle to lcms transformation
+    """
+
+    if intent not in INTENTS:
+        raise CmsError('renderingIntent must be an integer between 0 and 3')
+
+    result = _cms.buildFloatTransform(in_profile, in_mode, out_profile,
+                                      out_mode, intent, flags)
+
+    if result is None:
+        msg = 'Cannot create requested transform'
+        raise CmsError("%s: %s %s" % (msg, in_mode, out_mode))
+
+    return result
+
+
 def cms_create_proofing_transform(in_profile, in_mode, out_profile, out_mode,
                                   proof_profile,
                                   intent=uc2const.INTENT_PERCEPTUAL,
@@ -393,6 +423,64 @@ def cms_create_proofing_transform(in_profile, in_mode, out_profile, out_mode,
     return result
 
 
+def cms_create_devicelink_transform(devicelink, in_mode, out_mode,
+                                    intent=uc2const.INTENT_PERCEPTUAL,
+                                    flags=uc2const.cmsFLAGS_NOTPRECALC):
+    """Returns a handle to lcms transformation built from device-link
+    profile wrapped as a Python object.
+
+    :param devicelink: valid lcms device-link profile handle
+    :param in_mode: valid lcms or PIL mode
+    :param out_mode: valid lcms or PIL mode
+    :param intent: integer constant (0-3) of transform rendering intent
+    :param flags: lcms flags
+
+    :return: handle to lcms transformation
+    """
+
+    if intent not in INTENTS:
+        raise CmsError('renderingIntent must be an integer between 0 and 3')
+
+    result = _cms.buildDeviceLinkTransform(devicelink, in_mode, out_mode,
+                                           intent, flags)
+
+    if result is None:
+        msg = 'Cannot create requested device-link transform'
+        raise CmsError("%s: %s %s" % (msg, in_mode, out_mode))
+
+    return result
+
+
+def cms_transform_to_devicelink(transform):
+    """Returns device-link profile which represents provided transform
+    as a python string. The string can be stored and loaded later
+    using cms_open_profile_from_string().
+
+    :param transform: valid lcms transformation handle
+    :return: device-link profile as a python string
+    """
+    result = _cms.transformToDeviceLink(transform)
+
+    if result is None:
+        raise CmsError('Cannot convert transform into device-link profile')
+
+    return result
+
+
+def cms_get_profile_bytes(profile):
+    """Returns serialized profile content
+
+    :param profile: valid lcms profile handle
+    :return: ICC profile as a python string
+    """
+    result = _cms.getProfileBytes(profile)
+
+    if result is None:
+        raise CmsError('Cannot serialize provided profile')
+
+    return result
+
+
 def cms_do_transform(transform, inbuff, outbuff):
     """Transform color values from inputBuffer to outputBuffer using provided
     lcms transform handle.
@@ -413,14 +501,60 @@ def cms_do_transform(transform, inbuff, outbuff):
         raise CmsError(msg)
 
 
-def cms_do_bitmap_transform(transform, image, in_mode, out_mode):
+def cms_do_transform_buffer(transform, inbuff, outbuff, count=None):
+    """Transforms packed 8-bit colors from inbuff to outbuff in single
+    lcms call. Each color occupies 4 bytes, unused channels are padded
+    by zeros (the same layout as for cms_do_transform lists).
+
+    :param transform: valid lcms transformation handle
+    :param inbuff: buffer object (bytearray, array('B'), str)
+    :param outbuff: writable buffer object (bytearray, array('B'))
+    :param count: number of colors, by default calculated from inbuff size
+
+    :return: number of transformed colors
+    """
+    if count is None:
+        count = len(inbuff) // 4
+    ret = _cms.transformPixelsBuffer(transform, inbuff, outbuff, count)
+    if ret is None:
+        msg = 'inbuff and outbuff must be buffers of %d bytes at least'
+        raise CmsError(msg % (count * 4))
+    return ret
+
+
+def cms_do_transform_buffer2(transform, inbuff, outbuff, count=None):
+    """Transforms packed float colors from inbuff to outbuff in single
+    lcms call without 8-bit quantization. Each color occupies 4 doubles
+    in range 0.0-1.0, unused channels are padded by zeros.
+
+    :param transform: handle created by cms_create_float_transform
+    :param inbuff: array('d') object
+    :param outbuff: array('d') object
+    :param count: number of colors, by default calculated from inbuff size
+
+    :return: number of transformed colors
+    """
+    if count is None:
+        count = len(inbuff) // 4
+    ret = _cms.transformPixelsBuffer2(transform, inbuff, outbuff, count)
+    if ret is None:
+        msg = 'float transform and double arrays of %d items ' \
+              'at least are expected'
+        raise CmsError(msg % (count * 4))
+    return ret
+
+
+def cms_do_bitmap_transform(transform, image, in_mode, out_mode, threads=1):
     """Provides PIL images support for color management.
     Currently supports L, RGB, CMYK and LAB modes only.
+    Transformation is executed without GIL. If threads is greater
+    than 1, image rows are split into bands transformed concurrently.
 
     :param transform: valid lcms transformation handle
     :param image: valid PIL image object
     :param in_mode: valid lcms or PIL mode
     :param out_mode: valid lcms or PIL mode
+    :param threads: number of worker threads, 0 - use all CPU cores
 
     :return: new PIL image object in out_mode colorspace
     """
@@ -438,11 +572,42 @@ def cms_do_bitmap_transform(transform, image, in_mode, out_mode):
     image.load()
     new_image = Image.new(out_mode, (w, h))
 
-    _cms.transformBitmap(transform, image.im, new_image.im, w, h)
+    if threads <= 0:
+        threads = multiprocessing.cpu_count()
+
+    _cms.transformBitmap(transform, image.im, new_image.im, w, h, threads)
 
     return new_image
 
 
+def cms_do_bitmap_transform_inplace(transform, image, threads=1):
+    """Transforms PIL image pixels in place without allocating
+    destination image. Image mode is not changed, so transform
+    should be built for the same input and output modes (for example,
+    to apply embedded profile).
+
+    :param transform: valid lcms transformation handle
+    :param image: valid PIL image object
+    :param threads: number of worker threads, 0 - use all CPU cores
+
+    :return: the same PIL image object
+    """
+
+    if image.mode not in uc2const.IMAGE_COLORSPACES:
+        raise CmsError('Unsupported image type: %s' % image.mode)
+
+    w, h = image.size
+    image.load()
+
+    if threads <= 0:
+        threads = multiprocessing.cpu_count()
+
+    if _cms.transformBitmapInPlace(transform, image.im, w, h, threads) is None:
+        raise CmsError('Transform is not suitable for in-place processing')
+
+    return image
+
+
 def cms_get_profile_name(profile):
     """Returns profile name
 
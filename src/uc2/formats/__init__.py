@@ -183,3 +183,14 @@ def get_saver(path, experimental=False, return_id=False):
     if return_id:
         return saver, ret_id
     return saver
+
+
+def preload_formats():
+    """Imports all loader, saver and checker modules in advance
+    (used by long-running server process).
+    """
+    for pid in uc2const.LOADER_FORMATS:
+        _get_checker(pid)
+        _get_loader(pid)
+    for pid in uc2const.SAVER_FORMATS:
+        _get_saver(pid)
@@ -23,6 +23,7 @@ from uc2.formats.cdr.cdr_const import CDR6, CDR7, CDR8, CDR9, CDR12, CDR13
 from uc2.formats.cdr.cdr_utils import parse_matrix, parse_size_value, \
     parse_cdr_color
 from uc2.formats.riff.model import RiffList, RiffObject
+from uc2.libgeom.packed import PackedPaths
 from uc2.sk2const import NODE_CUSP, NODE_SMOOTH, NODE_SYMMETRICAL, \
     CURVE_CLOSED, CURVE_OPENED
 from uc2.utils import dword2py_int, long2py_float, word2py_int
@@ -435,6 +436,13 @@ class CdrCurve(CdrGraphObj):
             path.append(deepcopy(points))
             path.append(CURVE_OPENED)
             self.paths.append(deepcopy(path))
+        # large drawings keep thousands of curves, so nested lists
+        # are replaced by compact packed paths; malformed curves
+        # (missing control points) are kept as is
+        try:
+            self.paths = PackedPaths.from_paths(self.paths)
+        except ValueError:
+            pass
 
     def translate(self, translator):
         translator.create_curve(self)
@@ -18,6 +18,7 @@
 from copy import deepcopy
 
 from uc2.formats.sk2 import sk2_model
+from uc2.libgeom.packed import PackedPaths
 from uc2.sk2const import FILL_EVENODD, FILL_SOLID, STROKE_MIDDLE
 
 
@@ -149,7 +150,12 @@ class CDR_to_SK2_Translator:
     def create_curve(self, obj):
         config = self.pdxf_doc.config
         parent = self.parent_stack[-1]
-        paths = deepcopy(obj.paths)
+        # sk2 curves are edited in place, so packed paths
+        # of CDR model are unpacked into regular lists
+        if isinstance(obj.paths, PackedPaths):
+            paths = obj.paths.to_paths()
+        else:
+            paths = deepcopy(obj.paths)
         trafo = deepcopy(obj.trafo)
         if not obj.style_id is None and obj.fill_id is None and obj.outl_id is None:
             style = [[], deepcopy(config.default_stroke), [], []]
@@ -48,6 +48,7 @@ class SK2_to_CMX_Translator(object):
     cmx_cfg = None
     coef = 1.0
     rifx = False
+    rgb_colors = None
 
     def translate(self, sk2_doc, cmx_doc):
         self.cmx_doc = cmx_doc
@@ -58,6 +59,7 @@ class SK2_to_CMX_Translator(object):
         self.sk2_mtds = sk2_doc.methods
 
         self.make_template()
+        self._prepare_colors()
         self.translate_doc()
         self.cmx_doc.update()
         self.add_info()
@@ -70,6 +72,7 @@ class SK2_to_CMX_Translator(object):
         self.sk2_doc = None
         self.sk2_model = None
         self.sk2_mtds = None
+        self.rgb_colors = None
 
     def _make_preview(self):
         return libimg.generate_preview(
@@ -86,6 +89,28 @@ class SK2_to_CMX_Translator(object):
     def _int2dword(self, val):
         return utils.py_int2signed_dword(int(val * self.coef), self.rifx)
 
+    def _collect_colors(self, objs, colors):
+        for obj in objs:
+            if obj.is_primitive:
+                fill, stroke = obj.style[0], obj.style[1]
+                if fill and fill[1] == sk2const.FILL_SOLID:
+                    colors[repr(fill[2])] = fill[2]
+                if stroke:
+                    colors[repr(stroke[2])] = stroke[2]
+            elif obj.childs:
+                self._collect_colors(obj.childs, colors)
+
+    def _prepare_colors(self):
+        # colors without CMX color model are converted into RGB
+        # by single transform call per colorspace
+        colors = {}
+        self._collect_colors(self.sk2_mtds.get_pages(), colors)
+        colors = [color for color in colors.values() if color[0] not in
+                  (uc2const.COLOR_RGB, uc2const.COLOR_CMYK)]
+        rgb_colors = self.sk2_doc.cms.get_colors(colors, uc2const.COLOR_RGB)
+        self.rgb_colors = dict([(repr(color), cms.val_255(rgb[1]))
+                                for color, rgb in zip(colors, rgb_colors)])
+
     def _add_color(self, color):
         doc_cms = self.sk2_doc.cms
         rclr = self.cmx_model.chunk_map['rclr']
@@ -103,7 +128,8 @@ class SK2_to_CMX_Translator(object):
         else:
             model = cmx_const.COLOR_MODELS.index(cmx_const.CMX_RGB)
             palette = cmx_const.COLOR_PALETTES.index('User')
-            vals = doc_cms.get_rgb_color255(color)
+            vals = (self.rgb_colors or {}).get(repr(color)) or \
+                doc_cms.get_rgb_color255(color)
             clr = (model, palette, vals)
         return rclr.add_color(clr)
 
@@ -16,6 +16,7 @@
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import math
+from cStringIO import StringIO
 from copy import deepcopy
 from reportlab.lib.colors import CMYKColorSep, Color, CMYKColor
 from reportlab.lib.utils import ImageReader
@@ -161,7 +162,8 @@ class PDFGenerator(object):
             for pair in curve_obj.cache_arrows:
                 for item in pair:
                     if item:
-                        arrow_paths += libcairo.get_path_from_cpath(item)
+                        arrow_paths += \
+                            libcairo.get_packed_path_from_cpath(item)
             arrow_paths = self.make_pdfpath(arrow_paths)[0]
         arrow_fill_style = None
         if arrow_paths and curve_obj.style[1]:
@@ -514,9 +516,23 @@ class PDFGenerator(object):
             for bundle in hnd.convert_duotone_to_image(self.cms, cs):
                 if bundle:
                     self.draw_image(*bundle)
+        elif self.can_embed_encoded(obj):
+            self.draw_encoded_image(hnd.get_encoded_bitmap()[1])
         else:
             self.draw_image(hnd.bitmap, hnd.alpha)
 
+    def can_embed_encoded(self, obj):
+        # JPEG stream is embedded as is (DCTDecode) if no
+        # colorspace conversion or alpha masking is required
+        fmt = obj.handler.get_encoded_bitmap()[0]
+        return fmt == 'JPEG' and not obj.has_alpha() and \
+               obj.colorspace == uc2const.IMAGE_RGB and \
+               self.colorspace in (None, uc2const.COLOR_RGB)
+
+    def draw_encoded_image(self, image_str):
+        img = ImageReader(StringIO(image_str))
+        self.canvas.drawImage(img, 0, 0, mask='auto')
+
     def draw_pixmap(self, obj):
         self.canvas.saveState()
         self.canvas.transform(*obj.trafo)
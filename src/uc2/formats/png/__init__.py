@@ -16,13 +16,18 @@
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import cairo
+import multiprocessing
+from multiprocessing.pool import ThreadPool
 
+from uc2 import libcairo
 from uc2.formats.fallback import im_loader
+from uc2.formats.png.png_writer import PNGStreamWriter
 from uc2.formats.sk2.crenderer import CairoRenderer
 from uc2.utils.fsutils import get_fileptr
 from uc2.utils.mixutils import merge_cnf
 
 PNG_ID = '\x89\x50\x4e\x47'
+STRIP_HEIGHT = 512
 
 
 def png_loader(appdata, filename=None, fileptr=None, translate=True, cnf=None,
@@ -30,6 +35,37 @@ def png_loader(appdata, filename=None, fileptr=None, translate=True, cnf=None,
     return im_loader(appdata, filename, fileptr, translate, cnf, **kw)
 
 
+def get_raster_threads(sk2_doc, cnf):
+    threads = cnf.get('threads')
+    if threads is None:
+        threads = getattr(sk2_doc.app.config, 'raster_threads', 1) \
+            if sk2_doc.app else 1
+    return int(threads) or multiprocessing.cpu_count()
+
+
+def render_strip(sk2_doc, layers, scale, size, y0, sh, antialias_flag):
+    """
+    Renders horizontal page strip starting from y0 pixel row and
+    returns it as PNG scanlines. Each call uses own surface, context
+    and renderer, so strips can be rendered concurrently.
+    """
+    w, h = size
+    trafo = (scale, 0, 0, -scale, w / 2.0, h / 2.0 - y0)
+    rend = CairoRenderer(sk2_doc.cms)
+    rend.render_bbox = [-w / 2.0 / scale, (h / 2.0 - y0 - sh) / scale,
+                        w / 2.0 / scale, (h / 2.0 - y0) / scale]
+
+    surface = cairo.ImageSurface(cairo.FORMAT_ARGB32, int(w), sh)
+    ctx = cairo.Context(surface)
+    ctx.set_matrix(cairo.Matrix(*trafo))
+
+    for item in layers:
+        rend.antialias_flag = not any([not item.properties[3],
+                                       not antialias_flag])
+        rend.render(ctx, item.childs)
+    return libcairo.get_png_scanlines(surface)
+
+
 def png_saver(sk2_doc, filename=None, fileptr=None, translate=True, cnf=None,
               **kw):
     cnf = merge_cnf(cnf, kw)
@@ -38,22 +74,42 @@ def png_saver(sk2_doc, filename=None, fileptr=None, translate=True, cnf=None,
     page = sk2_doc.methods.get_page()
     scale = abs(float(cnf.get('scale', 1.0))) or 1.0
     w, h = [scale * item for item in page.page_format[1]]
-    trafo = (scale, 0, 0, -scale, w / 2.0, h / 2.0)
+    width, height = int(w), int(h)
+    strip_height = int(cnf.get('strip_height', STRIP_HEIGHT)) or height
+    threads = get_raster_threads(sk2_doc, cnf)
 
-    canvas_matrix = cairo.Matrix(*trafo)
-    surface = cairo.ImageSurface(cairo.FORMAT_ARGB32, int(w), int(h))
-    ctx = cairo.Context(surface)
-    ctx.set_matrix(canvas_matrix)
-    
     antialias_flag = not cnf.get('antialiasing') in (False, 0)
     layers = sk2_doc.methods.get_visible_layers(page)
-    rend = CairoRenderer(sk2_doc.cms)
+    writer = PNGStreamWriter(fileptr, width, height)
 
-    for item in layers:
-        rend.antialias_flag = not any([not item.properties[3], not antialias_flag])
-        rend.render(ctx, item.childs)
+    # Page is rendered by horizontal strips, each strip is
+    # converted into PNG scanlines and compressed immediately
+    strips = [(y0, min(strip_height, height - y0))
+              for y0 in range(0, height, strip_height)]
+
+    def render(strip):
+        return render_strip(sk2_doc, layers, scale, (w, h),
+                            strip[0], strip[1], antialias_flag)
+
+    if threads < 2 or len(strips) < 2:
+        for strip in strips:
+            writer.write_scanlines(render(strip))
+    else:
+        # cairo releases GIL while drawing; strips are rendered by
+        # batches to keep memory bounded and written in page order
+        rend = CairoRenderer(sk2_doc.cms)
+        for item in layers:
+            rend.prepare(item.childs)
+        pool = ThreadPool(min(threads, len(strips)))
+        try:
+            for i in range(0, len(strips), threads):
+                for scanlines in pool.map(render, strips[i:i + threads], 1):
+                    writer.write_scanlines(scanlines)
+        finally:
+            pool.close()
+            pool.join()
 
-    surface.write_to_png(fileptr)
+    writer.close()
     fileptr.close()
 
 
@@ -0,0 +1,83 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2018 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import struct
+import zlib
+
+PNG_SIGNATURE = '\x89PNG\r\n\x1a\n'
+COLOR_RGBA = 6
+IDAT_SIZE = 1 << 20
+
+
+class PNGStreamWriter(object):
+    """
+    Writes 8-bit RGBA PNG image incrementally. Image rows are provided
+    as prepared scanlines (filter byte + pixels) by strips of any height,
+    compressed data is flushed to file by IDAT chunks, so whole image
+    is never kept in memory.
+    """
+    fileptr = None
+    width = 0
+    height = 0
+    rows = 0
+    compressor = None
+    buf = None
+    buf_size = 0
+
+    def __init__(self, fileptr, width, height, level=6):
+        self.fileptr = fileptr
+        self.width = width
+        self.height = height
+        self.rows = 0
+        self.buf = []
+        self.buf_size = 0
+        self.compressor = zlib.compressobj(level)
+        self.fileptr.write(PNG_SIGNATURE)
+        self.write_chunk('IHDR', struct.pack('>IIBBBBB', width, height, 8,
+                                             COLOR_RGBA, 0, 0, 0))
+
+    def write_chunk(self, tag, data):
+        self.fileptr.write(struct.pack('>I', len(data)))
+        self.fileptr.write(tag)
+        self.fileptr.write(data)
+        crc = zlib.crc32(data, zlib.crc32(tag)) & 0xffffffff
+        self.fileptr.write(struct.pack('>I', crc))
+
+    def _push(self, data, force=False):
+        if data:
+            self.buf.append(data)
+            self.buf_size += len(data)
+        if self.buf_size >= IDAT_SIZE or (force and self.buf_size):
+            self.write_chunk('IDAT', ''.join(self.buf))
+            self.buf = []
+            self.buf_size = 0
+
+    def write_scanlines(self, scanlines):
+        row_size = 1 + 4 * self.width
+        if len(scanlines) % row_size:
+            raise ValueError('Incomplete PNG scanline')
+        self.rows += len(scanlines) // row_size
+        if self.rows > self.height:
+            raise ValueError('Too many rows for PNG image')
+        self._push(self.compressor.compress(scanlines))
+
+    def close(self):
+        if self.rows != self.height:
+            raise ValueError('PNG image has %d of %d rows' %
+                             (self.rows, self.height))
+        self._push(self.compressor.flush(), True)
+        self.write_chunk('IEND', '')
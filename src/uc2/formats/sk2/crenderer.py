@@ -16,6 +16,7 @@
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import cairo
+import math
 from copy import deepcopy
 
 from uc2 import libcairo, libgeom, sk2const
@@ -51,6 +52,7 @@ class CairoRenderer:
     contour_flag = False
     stroke_style = []
     for_display = False
+    render_bbox = None
 
     def __init__(self, cms):
         self.cms = cms
@@ -103,6 +105,28 @@ class CairoRenderer:
 
     # -------DOCUMENT RENDERING
 
+    def prepare(self, objs=None):
+        """
+        Builds lazily created object caches (paths, fill transforms,
+        image and pattern surfaces) in advance, so the same objects
+        can be rendered by several threads into separate tiles.
+        """
+        ctx = cairo.Context(cairo.ImageSurface(cairo.FORMAT_ARGB32, 1, 1))
+        for obj in objs or []:
+            if obj.is_primitive:
+                if obj.cache_cpath is None:
+                    obj.update()
+                if obj.is_pixmap:
+                    self.get_surface(obj)
+                elif obj.style[0] and \
+                        obj.style[0][1] != sk2const.FILL_SOLID:
+                    self.process_fill(ctx, obj)
+            elif obj.is_container:
+                self.prepare([obj.cache_container])
+                self.prepare(obj.childs[1:])
+            elif obj.is_group:
+                self.prepare(obj.childs)
+
     def render(self, ctx, objs=None):
         objs = objs or []
         if self.antialias_flag:
@@ -114,8 +138,33 @@ class CairoRenderer:
             for obj in objs:
                 self.render_object(ctx, obj)
 
+    def is_visible(self, obj):
+        """
+        Checks object against render_bbox (visible area in document
+        coordinates) to skip objects outside of rendered strip or tile.
+        Bbox includes arrows and is enlarged by stroke extent: miter
+        joins reach miter_limit * width / 2, square caps reach
+        sqrt(2) * width / 2.
+        """
+        if not self.render_bbox or not obj.cache_bbox:
+            return True
+        bbox = obj.cache_bbox
+        stroke = obj.style[1]
+        if stroke:
+            arrows = [item for pair in obj.cache_arrows or []
+                      for item in pair if item]
+            arrows_bbox = libgeom.get_cpaths_bbox(arrows) if arrows else []
+            if arrows_bbox:
+                bbox = libgeom.sum_bbox(bbox, arrows_bbox)
+            margin = max(stroke[6], math.sqrt(2.0)) * \
+                (obj.cache_line_width or 0.0) / 2.0
+            bbox = libgeom.enlarge_bbox(bbox, margin, margin)
+        return libgeom.is_bbox_overlap(bbox, self.render_bbox)
+
     def render_object(self, ctx, obj):
         if obj.is_primitive:
+            if not self.is_visible(obj):
+                return
             self.render_primitives(ctx, obj)
         elif obj.is_container:
             self.render_container(ctx, obj)
@@ -955,6 +955,7 @@ class Text(PrimitiveObject):
     cache_layout_data = ()
     cache_layout_bbox = []
     cache_clusters = []
+    cache_glyphs_data = None
     is_text = True
 
     def __init__(self, config, parent=None,
@@ -988,10 +989,19 @@ class Text(PrimitiveObject):
     def is_textblock(self):
         return self.width == sk2const.TEXTBLOCK_WIDTH
 
-    def get_glyphs(self):
-        glyphs, points, data, bbox, cl = libgeom.get_text_glyphs(
+    def prepare_glyphs(self):
+        """Shapes text in advance (can be called from worker thread),
+        result is consumed by next get_glyphs() call.
+        """
+        self.cache_glyphs_data = libgeom.get_text_glyphs(
             self.get_text(),
             self.width, self.style[2], self.markup)
+
+    def get_glyphs(self):
+        if self.cache_glyphs_data is None:
+            self.prepare_glyphs()
+        glyphs, points, data, bbox, cl = self.cache_glyphs_data
+        self.cache_glyphs_data = None
         self.cache_line_points = points
         self.cache_layout_data = data
         self.cache_clusters = cl
@@ -1049,7 +1059,7 @@ class Text(PrimitiveObject):
         ret = []
         for item in self.cache_cpath:
             if item:
-                paths = libgeom.get_paths_from_glyph(item)
+                paths = libgeom.get_paths_from_glyph(item, True)
                 if paths:
                     ret += paths
         return ret
@@ -1073,29 +1083,19 @@ class Text(PrimitiveObject):
             bp = [0.0, 0.0]
             self.cache_bbox = 2 * libgeom.apply_trafo_to_point(bp, self.trafo)
         for item in self.cache_cpath:
-            bbox = []
-            if not item:
-                if not self.trafos:
-                    data = self.cache_layout_data[index]
-                    bp = [data[0], data[4]]
-                    bbox = 2 * libgeom.apply_trafo_to_point(bp, self.trafo)
-            else:
-                bbox = libgeom.get_cpath_bbox(item)
-            if bbox:
-                if not self.cache_bbox:
-                    self.cache_bbox = bbox
-                else:
-                    self.cache_bbox = libgeom.sum_bbox(self.cache_bbox, bbox)
+            if not item and not self.trafos:
+                data = self.cache_layout_data[index]
+                bp = [data[0], data[4]]
+                bbox = 2 * libgeom.apply_trafo_to_point(bp, self.trafo)
+                self.cache_bbox = libgeom.sum_bbox(self.cache_bbox, bbox)
             index += 1
+        bbox = libgeom.get_cpaths_bbox(self.cache_cpath)
+        self.cache_bbox = libgeom.sum_bbox(self.cache_bbox, bbox)
 
     def apply_trafo(self, trafo):
         for i in self.trafos.keys():
             self.trafos[i] = libgeom.multiply_trafo(self.trafos[i], trafo)
-        for i in range(len(self.cache_cpath)):
-            if self.cache_cpath[i] is None:
-                continue
-            self.cache_cpath[i] = libgeom.apply_trafo(self.cache_cpath[i],
-                                                      trafo)
+        libgeom.apply_trafo_to_cpaths(self.cache_cpath, trafo)
         self.trafo = libgeom.multiply_trafo(self.trafo, trafo)
         if self.fill_trafo:
             self.fill_trafo = libgeom.multiply_trafo(self.fill_trafo, trafo)
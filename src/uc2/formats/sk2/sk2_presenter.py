@@ -15,7 +15,10 @@
 #  You should have received a copy of the GNU Affero General Public License
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import logging
+import multiprocessing
 import os
+from multiprocessing.pool import ThreadPool
 
 from uc2 import uc2const
 from uc2.formats.generic import TextModelPresenter
@@ -23,6 +26,21 @@ from uc2.formats.sk2.sk2_config import SK2_Config
 from uc2.formats.sk2.sk2_methods import create_new_doc, SK2_Methods
 from uc2.formats.sk2.sk2_filters import SK2_Loader, SK2_Saver
 
+LOG = logging.getLogger(__name__)
+
+
+def _collect_texts(objs, texts):
+    for obj in objs:
+        if getattr(obj, 'is_text', False):
+            texts.append(obj)
+        elif obj.childs:
+            _collect_texts(obj.childs, texts)
+    return texts
+
+
+def _prepare_glyphs(obj):
+    obj.prepare_glyphs()
+
 
 class SK2_Presenter(TextModelPresenter):
     cid = uc2const.SK2
@@ -57,7 +75,34 @@ class SK2_Presenter(TextModelPresenter):
         self.model = create_new_doc(self.config)
         self.update()
 
+    def get_text_threads(self):
+        threads = getattr(self.app.config, 'text_shaping_threads', 1) \
+            if self.app else 1
+        return threads or multiprocessing.cpu_count()
+
+    def prepare_texts(self):
+        """Shapes text objects concurrently before model update.
+        libpango releases GIL while shaping and uses per-thread layouts.
+        """
+        threads = self.get_text_threads()
+        if threads < 2 or self.model is None:
+            return
+        texts = _collect_texts(self.model.childs, [])
+        if len(texts) < 2:
+            return
+        pool = ThreadPool(min(threads, len(texts)))
+        try:
+            pool.map(_prepare_glyphs, texts, 1)
+        except Exception:
+            LOG.exception('Error preparing text glyphs')
+            for obj in texts:
+                obj.cache_glyphs_data = None
+        finally:
+            pool.close()
+            pool.join()
+
     def update(self, action=False):
+        self.prepare_texts()
         TextModelPresenter.update(self, action)
         if self.model is not None:
             self.methods.update()
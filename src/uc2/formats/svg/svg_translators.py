@@ -1268,16 +1268,24 @@ class SK2_to_SVG_Translator(object):
             self.translate_primitive(dest_parent, arrows)
 
     def translate_pixmap(self, dest_parent, source_obj):
-        surface = source_obj.handler.get_surface(self.sk2_doc.cms)
-        image_stream = StringIO()
-        surface.write_to_png(image_stream)
-        content = b64encode(image_stream.getvalue())
+        fmt, image_str = source_obj.handler.get_encoded_bitmap()
+        if fmt in ('PNG', 'JPEG') and not source_obj.has_alpha() and \
+                source_obj.colorspace == uc2const.IMAGE_RGB:
+            # original PNG/JPEG stream is embedded without re-encoding
+            mime = 'image/png' if fmt == 'PNG' else 'image/jpeg'
+            content = b64encode(image_str)
+        else:
+            surface = source_obj.handler.get_surface(self.sk2_doc.cms)
+            image_stream = StringIO()
+            surface.write_to_png(image_stream)
+            mime = 'image/png'
+            content = b64encode(image_stream.getvalue())
         image = svg_utils.create_xmlobj('image')
         w, h = source_obj.get_size()
         trafo = [1.0, 0.0, 0.0, -1.0, 0.0, 0.0]
         trafo = libgeom.multiply_trafo(trafo, source_obj.trafo)
         trafo = libgeom.multiply_trafo(trafo, self.trafo)
-        image.attrs['xlink:href'] = 'data:image/png;base64,' + content
+        image.attrs['xlink:href'] = 'data:%s;base64,%s' % (mime, content)
         image.attrs['transform'] = 'matrix(%s)' % trafo.__str__()[1:-1]
         image.attrs['x'] = '0'
         image.attrs['y'] = str(-h)
@@ -60,6 +60,33 @@ def get_path_from_cpath(cairo_path):
     return _libcairo.get_path_from_cpath(cairo_path)
 
 
+def get_packed_path_from_cpath(cairo_path):
+    from uc2.libgeom.packed import PackedPaths
+    ops, coords = _libcairo.get_packed_path_from_cpath(cairo_path)
+    return PackedPaths.from_strings(ops, coords)
+
+
+def create_cpath_from_packed(ops, coords, cmatrix=None):
+    cairo_path = _libcairo.create_cpath_from_packed(ops, coords)
+    if cmatrix is not None:
+        cairo_path = apply_cmatrix(cairo_path, cmatrix)
+    return cairo_path
+
+
+def apply_trafo_to_packed(coords, trafo):
+    m11, m21, m12, m22, dx, dy = trafo
+    _libcairo.apply_trafo_to_packed(coords, m11, m21, m12, m22, dx, dy)
+    return coords
+
+
+def get_packed_bbox(ops, coords):
+    return _libcairo.get_packed_bbox(ops, coords)
+
+
+def reverse_packed(ops, coords):
+    return _libcairo.reverse_packed(ops, coords)
+
+
 def get_flattened_cpath(cairo_path, tolerance=0.1):
     CTX.set_matrix(DIRECT_MATRIX)
     tlr = CTX.get_tolerance()
@@ -91,6 +118,15 @@ def apply_trafo(cairo_path, trafo, copy=False):
     return cairo_path
 
 
+def apply_trafo_to_cpaths(cairo_paths, trafo, copy=False):
+    if copy:
+        cairo_paths = [None if item is None else copy_cpath(item)
+                       for item in cairo_paths]
+    m11, m21, m12, m22, dx, dy = trafo
+    _libcairo.apply_trafo_to_paths(cairo_paths, m11, m21, m12, m22, dx, dy)
+    return cairo_paths
+
+
 def multiply_trafo(trafo1, trafo2):
     matrix1 = get_matrix_from_trafo(trafo1)
     matrix2 = get_matrix_from_trafo(trafo2)
@@ -104,10 +140,11 @@ def normalize_bbox(bbox):
 
 
 def get_cpath_bbox(cpath):
-    CTX.set_matrix(DIRECT_MATRIX)
-    CTX.new_path()
-    CTX.append_path(cpath)
-    return normalize_bbox(CTX.path_extents())
+    return _libcairo.get_path_bbox(cpath)
+
+
+def get_cpaths_bbox(cpaths):
+    return _libcairo.get_paths_bbox(cpaths)
 
 
 def _get_trafo(cmatrix):
@@ -192,6 +229,43 @@ def check_surface_whiteness(surface):
     return _libcairo.get_pixel(surface) == [255, 255, 255]
 
 
+def get_png_scanlines(surface):
+    return _libcairo.get_png_scanlines(surface)
+
+
+def intersect_polylines(polylines1, polylines2, skip_same=False):
+    return _libcairo.intersect_polylines(polylines1, polylines2,
+                                         int(skip_same))
+
+
+def create_segment_grid(polylines, closed=None):
+    """Closing segments of polylines which closed flag is false
+    are used for inside test only, not for outline test.
+    """
+    return _libcairo.create_segment_grid(polylines, closed)
+
+
+def check_points_inside(grid, points, fill_rule=cairo.FILL_RULE_EVEN_ODD,
+                        tolerance=0.0):
+    rule = 2 if fill_rule == cairo.FILL_RULE_EVEN_ODD else 1
+    return _libcairo.check_points(grid, points, rule, tolerance)
+
+
+def check_points_on_outline(grid, points, tolerance):
+    return _libcairo.check_points(grid, points, 0, tolerance)
+
+
+def flat_paths(paths, tolerance=0.1, trafo=None):
+    m11, m21, m12, m22, dx, dy = trafo or [1.0, 0.0, 0.0, 1.0, 0.0, 0.0]
+    return _libcairo.flat_paths(paths, tolerance,
+                                m11, m21, m12, m22, dx, dy)
+
+
+def stroke_paths(paths, radius, linejoin, captype, miter_limit):
+    return _libcairo.stroke_paths(paths, radius, linejoin, captype,
+                                  miter_limit)
+
+
 def image_to_surface_n(image):
     png_stream = StringIO()
     image.save(png_stream, format='PNG')
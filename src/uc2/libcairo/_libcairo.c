@@ -17,10 +17,17 @@
  */
 
 #include <Python.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
 #include <pycairo.h>
 #include <cairo.h>
 #include "Imaging.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 static Pycairo_CAPI_t *Pycairo_CAPI;
 
 /* redefine the ImagingObject struct defined in _imagingmodule.c */
@@ -63,77 +70,122 @@ cairo_GetSurfaceFirstPixel (PyObject *self, PyObject *args) {
 	return Py_BuildValue("[iii]", src[0], src[1], src[2]);
 }
 
+/* Affine transform kernel for cairo path data.
+ * Path elements are self-describing: header.length-1 points follow
+ * each header (1 for move/line, 3 for curve, 0 for close), so points are
+ * transformed in tight inner loops without per-type dispatch.
+ * SSE2 variant handles (x,y) pair as single register.
+ */
+static void
+transform_path_data(cairo_path_t *path, double m11, double m21,
+		double m12, double m22, double dx, double dy) {
+
+	int i, j, length;
+	cairo_path_data_t *data = path->data;
+#ifdef __SSE2__
+	__m128d col1 = _mm_set_pd(m21, m11);
+	__m128d col2 = _mm_set_pd(m22, m12);
+	__m128d shift = _mm_set_pd(dy, dx);
+	__m128d point;
+#else
+	double x, y;
+#endif
+
+	for (i = 0; i < path->num_data; i += length) {
+		length = data[i].header.length;
+		for (j = i + 1; j < i + length; j++) {
+#ifdef __SSE2__
+			point = _mm_loadu_pd(&data[j].point.x);
+			point = _mm_add_pd(_mm_add_pd(
+					_mm_mul_pd(col1, _mm_unpacklo_pd(point, point)),
+					_mm_mul_pd(col2, _mm_unpackhi_pd(point, point))),
+					shift);
+			_mm_storeu_pd(&data[j].point.x, point);
+#else
+			x = data[j].point.x;
+			y = data[j].point.y;
+			data[j].point.x = m11 * x + m12 * y + dx;
+			data[j].point.y = m21 * x + m22 * y + dy;
+#endif
+		}
+	}
+}
+
 static PyObject *
 cairo_ApplyTrafoToPath (PyObject *self, PyObject *args) {
 
-	double m11, m12, m21, m22, dx, dy, x, y;
-    int i;
+	double m11, m12, m21, m22, dx, dy;
 	PycairoPath *pypath;
-    cairo_path_t *path;
-    cairo_path_data_t *data;
 
 	if (!PyArg_ParseTuple(args, "Odddddd",
 			&pypath, &m11, &m21, &m12, &m22, &dx, &dy)) {
 		return NULL;
 	}
 
-    path = pypath ->path;
+	transform_path_data(pypath->path, m11, m21, m12, m22, dx, dy);
 
-    for (i=0; i < path->num_data; i += path->data[i].header.length) {
-        data = &path->data[i];
-		switch (data->header.type) {
-			case CAIRO_PATH_MOVE_TO:
-				x = data[1].point.x;
-				y = data[1].point.y;
-				data[1].point.x = m11 * x + m12 * y + dx;
-				data[1].point.y = m21 * x + m22 * y + dy;
-				break;
-			case CAIRO_PATH_LINE_TO:
-				x = data[1].point.x;
-				y = data[1].point.y;
-				data[1].point.x = m11 * x + m12 * y + dx;
-				data[1].point.y = m21 * x + m22 * y + dy;
-				break;
-			case CAIRO_PATH_CURVE_TO:
-				x = data[1].point.x;
-				y = data[1].point.y;
-				data[1].point.x = m11 * x + m12 * y + dx;
-				data[1].point.y = m21 * x + m22 * y + dy;
-
-				x = data[2].point.x;
-				y = data[2].point.y;
-				data[2].point.x = m11 * x + m12 * y + dx;
-				data[2].point.y = m21 * x + m22 * y + dy;
-
-				x = data[3].point.x;
-				y = data[3].point.y;
-				data[3].point.x = m11 * x + m12 * y + dx;
-				data[3].point.y = m21 * x + m22 * y + dy;
-				break;
-			case CAIRO_PATH_CLOSE_PATH:
-				break;
-        }
-    }
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* Applies the same trafo to each cairo path of the sequence.
+ * None items are skipped.
+ */
+static PyObject *
+cairo_ApplyTrafoToPaths (PyObject *self, PyObject *args) {
+
+	double m11, m12, m21, m22, dx, dy;
+	int i, size;
+	PyObject *paths, *seq, *item;
+
+	if (!PyArg_ParseTuple(args, "Odddddd",
+			&paths, &m11, &m21, &m12, &m22, &dx, &dy)) {
+		return NULL;
+	}
+
+	seq = PySequence_Fast(paths, "sequence of cairo paths expected");
+	if (seq == NULL) {
+		return NULL;
+	}
+
+	size = PySequence_Fast_GET_SIZE(seq);
+	for (i = 0; i < size; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (item == Py_None) {
+			continue;
+		}
+		if (!PyObject_TypeCheck(item, &PycairoPath_Type)) {
+			Py_DECREF(seq);
+			PyErr_SetString(PyExc_TypeError, "cairo.Path expected");
+			return NULL;
+		}
+		transform_path_data(((PycairoPath *)item)->path,
+				m11, m21, m12, m22, dx, dy);
+	}
+	Py_DECREF(seq);
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
+/* Appends item to the list and releases local reference */
+static void
+list_append_new(PyObject *list, PyObject *item) {
+	PyList_Append(list, item);
+	Py_DECREF(item);
+}
 
 static PyObject *
 cairo_GetPDPathFromPath (PyObject *self, PyObject *args) {
 
-	double x0, y0, x1, y1, x2, y2;
-    int i, path_counter;
+	int i, path_counter;
 	PycairoPath *pypath;
-    cairo_path_t *path;
-    cairo_path_data_t *data;
+	cairo_path_t *path;
+	cairo_path_data_t *data;
 
-    PyObject *pd_paths;
-    PyObject *pd_path;
-    PyObject *pd_points;
-    PyObject *pd_point;
-    PyObject *pd_subpoint;
+	PyObject *pd_paths;
+	PyObject *pd_path;
+	PyObject *pd_points;
 
 	if (!PyArg_ParseTuple(args, "O",
 			&pypath)) {
@@ -141,80 +193,584 @@ cairo_GetPDPathFromPath (PyObject *self, PyObject *args) {
 	}
 
 	path_counter = 0;
-    path = pypath ->path;
+	path = pypath ->path;
 
-    pd_paths = PyList_New(0);
-    pd_path = PyList_New(3);
-    pd_points = PyList_New(0);
+	pd_paths = PyList_New(0);
+	pd_path = PyList_New(3);
+	pd_points = PyList_New(0);
+	PyList_SetItem(pd_path, 0, PyList_New(0));
+	PyList_SetItem(pd_path, 2, PyInt_FromLong(0L));
 
-    for (i=0; i < path->num_data; i += path->data[i].header.length) {
-        data = &path->data[i];
+	for (i=0; i < path->num_data; i += path->data[i].header.length) {
+		data = &path->data[i];
 		switch (data->header.type) {
 			case CAIRO_PATH_MOVE_TO:
 				if(path_counter>0){
 					PyList_SetItem(pd_path, 1, pd_points);
 					PyList_Append(pd_paths, pd_path);
+				} else {
+					Py_DECREF(pd_points);
 				}
+				Py_DECREF(pd_path);
 
 				pd_path = PyList_New(3);
 				pd_points = PyList_New(0);
 
-				pd_point = PyList_New(0);
-				x0 = data[1].point.x;
-				y0 = data[1].point.y;
-				PyList_Append(pd_point, PyFloat_FromDouble(x0));
-				PyList_Append(pd_point, PyFloat_FromDouble(y0));
-				PyList_SetItem(pd_path, 0, pd_point);
+				PyList_SetItem(pd_path, 0, Py_BuildValue("[dd]",
+						data[1].point.x, data[1].point.y));
 				PyList_SetItem(pd_path, 2, PyInt_FromLong(0L));
 				path_counter++;
 				break;
 
 			case CAIRO_PATH_LINE_TO:
-				pd_point = PyList_New(0);
-				x0 = data[1].point.x;
-				y0 = data[1].point.y;
-				PyList_Append(pd_point, PyFloat_FromDouble(x0));
-				PyList_Append(pd_point, PyFloat_FromDouble(y0));
-				PyList_Append(pd_points, pd_point);
+				list_append_new(pd_points, Py_BuildValue("[dd]",
+						data[1].point.x, data[1].point.y));
 				break;
 
 			case CAIRO_PATH_CURVE_TO:
-				pd_point = PyList_New(0);
-
-				pd_subpoint = PyList_New(0);
-				x0 = data[1].point.x;
-				y0 = data[1].point.y;
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(x0));
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(y0));
-				PyList_Append(pd_point, pd_subpoint);
-
-				pd_subpoint = PyList_New(0);
-				x1 = data[2].point.x;
-				y1 = data[2].point.y;
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(x1));
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(y1));
-				PyList_Append(pd_point, pd_subpoint);
-
-				pd_subpoint = PyList_New(0);
-				x2 = data[3].point.x;
-				y2 = data[3].point.y;
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(x2));
-				PyList_Append(pd_subpoint, PyFloat_FromDouble(y2));
-				PyList_Append(pd_point, pd_subpoint);
-
-				PyList_Append(pd_point, PyInt_FromLong(0L));
-				PyList_Append(pd_points, pd_point);
+				list_append_new(pd_points, Py_BuildValue("[[dd][dd][dd]i]",
+						data[1].point.x, data[1].point.y,
+						data[2].point.x, data[2].point.y,
+						data[3].point.x, data[3].point.y, 0));
 				break;
 
 			case CAIRO_PATH_CLOSE_PATH:
 				PyList_SetItem(pd_path, 2, PyInt_FromLong(1L));
 				break;
-        }
-    }
-    PyList_SetItem(pd_path, 1, pd_points);
-    PyList_Append(pd_paths, pd_path);
+		}
+	}
+	PyList_SetItem(pd_path, 1, pd_points);
+	list_append_new(pd_paths, pd_path);
+
+	return pd_paths;
+}
+
+/* Converts cairo path into packed form: (opcodes, coordinates).
+ * Opcodes are returned as a string of bytes (PATH_MOVE, PATH_LINE,
+ * PATH_CURVE, PATH_CLOSE), coordinates as a string of native doubles
+ * (x,y pairs; one pair for move/line, three pairs for curve).
+ * No Python objects are created per node.
+ */
+#define PATH_MOVE 0
+#define PATH_LINE 1
+#define PATH_CURVE 2
+#define PATH_CLOSE 3
+
+static PyObject *
+cairo_GetPackedPathFromPath (PyObject *self, PyObject *args) {
+
+	int i, j, ops_num, points_num;
+	PycairoPath *pypath;
+	cairo_path_t *path;
+	cairo_path_data_t *data;
+	PyObject *ops, *coords, *ret;
+	char *op_ptr;
+	double *coord_ptr;
+
+	if (!PyArg_ParseTuple(args, "O", &pypath)) {
+		return NULL;
+	}
+
+	path = pypath ->path;
+	ops_num = 0;
+	points_num = 0;
+
+	for (i=0; i < path->num_data; i += path->data[i].header.length) {
+		data = &path->data[i];
+		ops_num++;
+		switch (data->header.type) {
+			case CAIRO_PATH_MOVE_TO:
+			case CAIRO_PATH_LINE_TO:
+				points_num += 1;
+				break;
+			case CAIRO_PATH_CURVE_TO:
+				points_num += 3;
+				break;
+			case CAIRO_PATH_CLOSE_PATH:
+				break;
+		}
+	}
+
+	ops = PyString_FromStringAndSize(NULL, ops_num);
+	coords = PyString_FromStringAndSize(NULL, points_num * 2 * sizeof(double));
+	if (ops == NULL || coords == NULL) {
+		Py_XDECREF(ops);
+		Py_XDECREF(coords);
+		return NULL;
+	}
+
+	op_ptr = PyString_AS_STRING(ops);
+	coord_ptr = (double *) PyString_AS_STRING(coords);
+
+	for (i=0; i < path->num_data; i += path->data[i].header.length) {
+		data = &path->data[i];
+		switch (data->header.type) {
+			case CAIRO_PATH_MOVE_TO:
+				*op_ptr++ = PATH_MOVE;
+				break;
+			case CAIRO_PATH_LINE_TO:
+				*op_ptr++ = PATH_LINE;
+				break;
+			case CAIRO_PATH_CURVE_TO:
+				*op_ptr++ = PATH_CURVE;
+				break;
+			case CAIRO_PATH_CLOSE_PATH:
+				*op_ptr++ = PATH_CLOSE;
+				continue;
+		}
+		for (j = 1; j < data->header.length; j++) {
+			*coord_ptr++ = data[j].point.x;
+			*coord_ptr++ = data[j].point.y;
+		}
+	}
+
+	ret = Py_BuildValue("(OO)", ops, coords);
+	Py_DECREF(ops);
+	Py_DECREF(coords);
+	return ret;
+}
+
+static void
+bbox_add_value(double *min, double *max, double value) {
+	if (value < *min) *min = value;
+	if (value > *max) *max = value;
+}
+
+static void
+bbox_add_curve_axis(double *min, double *max,
+		double p0, double p1, double p2, double p3) {
+
+	double a, b, c, d, t, mt, roots[2];
+	int i, num = 0;
+
+	bbox_add_value(min, max, p3);
+	/* control points inside current range cannot produce extrema */
+	if (p1 >= *min && p1 <= *max && p2 >= *min && p2 <= *max) {
+		return;
+	}
+
+	a = -p0 + 3.0 * p1 - 3.0 * p2 + p3;
+	b = 2.0 * (p0 - 2.0 * p1 + p2);
+	c = p1 - p0;
+
+	if (fabs(a) < 1e-12) {
+		if (fabs(b) > 1e-12) {
+			roots[num++] = -c / b;
+		}
+	} else {
+		d = b * b - 4.0 * a * c;
+		if (d >= 0.0) {
+			d = sqrt(d);
+			roots[num++] = (-b + d) / (2.0 * a);
+			roots[num++] = (-b - d) / (2.0 * a);
+		}
+	}
+
+	for (i = 0; i < num; i++) {
+		t = roots[i];
+		if (t > 0.0 && t < 1.0) {
+			mt = 1.0 - t;
+			bbox_add_value(min, max, mt * mt * mt * p0 +
+					3.0 * mt * mt * t * p1 + 3.0 * mt * t * t * p2 +
+					t * t * t * p3);
+		}
+	}
+}
+
+/* Exact bounding box of cairo path.
+ * Curve extrema are found as roots of the bezier derivative, so the bbox
+ * is tight rather than control polygon hull.
+ * bbox is {x0, y0, x1, y1}; returns 0 if path has no points.
+ */
+static int
+get_path_bbox(cairo_path_t *path, double *bbox) {
+
+	int i, length, empty = 1;
+	double x = 0.0, y = 0.0;
+	cairo_path_data_t *data;
+
+	for (i = 0; i < path->num_data; i += length) {
+		data = &path->data[i];
+		length = data->header.length;
+		if (data->header.type == CAIRO_PATH_CLOSE_PATH) {
+			continue;
+		}
+		if (empty) {
+			bbox[0] = bbox[2] = data[1].point.x;
+			bbox[1] = bbox[3] = data[1].point.y;
+			empty = 0;
+		}
+		if (data->header.type == CAIRO_PATH_CURVE_TO) {
+			bbox_add_curve_axis(&bbox[0], &bbox[2], x, data[1].point.x,
+					data[2].point.x, data[3].point.x);
+			bbox_add_curve_axis(&bbox[1], &bbox[3], y, data[1].point.y,
+					data[2].point.y, data[3].point.y);
+			x = data[3].point.x;
+			y = data[3].point.y;
+		} else {
+			x = data[1].point.x;
+			y = data[1].point.y;
+			bbox_add_value(&bbox[0], &bbox[2], x);
+			bbox_add_value(&bbox[1], &bbox[3], y);
+		}
+	}
+	return !empty;
+}
+
+static PyObject *
+cairo_GetPathBbox (PyObject *self, PyObject *args) {
+
+	double bbox[4] = {0.0, 0.0, 0.0, 0.0};
+	PycairoPath *pypath;
+
+	if (!PyArg_ParseTuple(args, "O", &pypath)) {
+		return NULL;
+	}
+
+	get_path_bbox(pypath->path, bbox);
+	return Py_BuildValue("[dddd]", bbox[0], bbox[1], bbox[2], bbox[3]);
+}
+
+/* Union bbox of cairo paths sequence. None items and empty paths
+ * are skipped; returns empty list if there is nothing to measure.
+ */
+static PyObject *
+cairo_GetPathsBbox (PyObject *self, PyObject *args) {
+
+	double bbox[4], item_bbox[4];
+	int i, size, empty = 1;
+	PyObject *paths, *seq, *item;
+
+	if (!PyArg_ParseTuple(args, "O", &paths)) {
+		return NULL;
+	}
+
+	seq = PySequence_Fast(paths, "sequence of cairo paths expected");
+	if (seq == NULL) {
+		return NULL;
+	}
+
+	size = PySequence_Fast_GET_SIZE(seq);
+	for (i = 0; i < size; i++) {
+		item = PySequence_Fast_GET_ITEM(seq, i);
+		if (item == Py_None) {
+			continue;
+		}
+		if (!PyObject_TypeCheck(item, &PycairoPath_Type)) {
+			Py_DECREF(seq);
+			PyErr_SetString(PyExc_TypeError, "cairo.Path expected");
+			return NULL;
+		}
+		if (!get_path_bbox(((PycairoPath *)item)->path, item_bbox)) {
+			continue;
+		}
+		if (empty) {
+			memcpy(bbox, item_bbox, sizeof(bbox));
+			empty = 0;
+		} else {
+			bbox_add_value(&bbox[0], &bbox[2], item_bbox[0]);
+			bbox_add_value(&bbox[0], &bbox[2], item_bbox[2]);
+			bbox_add_value(&bbox[1], &bbox[3], item_bbox[1]);
+			bbox_add_value(&bbox[1], &bbox[3], item_bbox[3]);
+		}
+	}
+	Py_DECREF(seq);
+
+	if (empty) {
+		return PyList_New(0);
+	}
+	return Py_BuildValue("[dddd]", bbox[0], bbox[1], bbox[2], bbox[3]);
+}
+
+/* Packed paths support, see uc2.libgeom.packed module.
+ * Opcode buffer has one byte per command (node marker is stored in high
+ * nibble of curve opcode), coordinate buffer is contiguous native doubles.
+ */
+#define PATH_OP_MASK 0x0f
+
+static int
+packed_points_num(int op) {
+	switch (op & PATH_OP_MASK) {
+		case PATH_MOVE:
+		case PATH_LINE:
+			return 1;
+		case PATH_CURVE:
+			return 3;
+	}
+	return 0;
+}
+
+/* Gets read buffers of packed paths and checks that coordinates
+ * cover all opcodes. Returns 0 with exception set on error.
+ */
+static int
+get_packed_buffers(PyObject *ops_obj, PyObject *coords_obj,
+		const unsigned char **ops, int *ops_num, const double **coords) {
+
+	const void *buf;
+	Py_ssize_t len;
+	int i, points_num = 0;
 
-    return pd_paths;
+	if (PyObject_AsReadBuffer(ops_obj, &buf, &len) < 0) {
+		return 0;
+	}
+	*ops = (const unsigned char *) buf;
+	*ops_num = (int) len;
+
+	for (i = 0; i < *ops_num; i++) {
+		if (((*ops)[i] & PATH_OP_MASK) > PATH_CLOSE) {
+			PyErr_SetString(PyExc_ValueError, "unknown path opcode");
+			return 0;
+		}
+		points_num += packed_points_num((*ops)[i]);
+	}
+	if (*ops_num && ((*ops)[0] & PATH_OP_MASK) != PATH_MOVE) {
+		PyErr_SetString(PyExc_ValueError, "packed paths should start with move");
+		return 0;
+	}
+
+	if (PyObject_AsReadBuffer(coords_obj, &buf, &len) < 0) {
+		return 0;
+	}
+	*coords = (const double *) buf;
+	if ((Py_ssize_t) (2 * sizeof(double)) * points_num > len) {
+		PyErr_SetString(PyExc_ValueError, "packed coordinates are too short");
+		return 0;
+	}
+	return 1;
+}
+
+/* Builds cairo path from packed paths on the module context
+ * which is never transformed, so the result matches create_cpath()
+ * for the same regular paths.
+ */
+static cairo_t *packed_ctx = NULL;
+
+static PyObject *
+cairo_CreatePathFromPacked (PyObject *self, PyObject *args) {
+
+	PyObject *ops_obj, *coords_obj;
+	const unsigned char *ops;
+	const double *coords;
+	int i, ops_num;
+	cairo_surface_t *surface;
+	cairo_path_t *path;
+
+	if (!PyArg_ParseTuple(args, "OO", &ops_obj, &coords_obj)) {
+		return NULL;
+	}
+	if (!get_packed_buffers(ops_obj, coords_obj, &ops, &ops_num, &coords)) {
+		return NULL;
+	}
+
+	if (packed_ctx == NULL) {
+		surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, 1, 1);
+		packed_ctx = cairo_create(surface);
+		cairo_surface_destroy(surface);
+	}
+
+	cairo_new_path(packed_ctx);
+	for (i = 0; i < ops_num; i++) {
+		switch (ops[i] & PATH_OP_MASK) {
+			case PATH_MOVE:
+				cairo_move_to(packed_ctx, coords[0], coords[1]);
+				break;
+			case PATH_LINE:
+				cairo_line_to(packed_ctx, coords[0], coords[1]);
+				break;
+			case PATH_CURVE:
+				cairo_curve_to(packed_ctx, coords[0], coords[1],
+						coords[2], coords[3], coords[4], coords[5]);
+				break;
+			case PATH_CLOSE:
+				cairo_close_path(packed_ctx);
+				break;
+		}
+		coords += 2 * packed_points_num(ops[i]);
+	}
+	path = cairo_copy_path(packed_ctx);
+	cairo_new_path(packed_ctx);
+
+	return PycairoPath_FromPath(path);
+}
+
+/* Transforms packed coordinates in place. Coordinates should be
+ * a writable buffer, i.e. array('d').
+ */
+static PyObject *
+cairo_ApplyTrafoToPacked (PyObject *self, PyObject *args) {
+
+	double m11, m12, m21, m22, dx, dy, x, y, *pts;
+	void *buf;
+	Py_ssize_t i, len;
+	PyObject *coords_obj;
+
+	if (!PyArg_ParseTuple(args, "Odddddd",
+			&coords_obj, &m11, &m21, &m12, &m22, &dx, &dy)) {
+		return NULL;
+	}
+	if (PyObject_AsWriteBuffer(coords_obj, &buf, &len) < 0) {
+		return NULL;
+	}
+
+	pts = (double *) buf;
+	len /= 2 * sizeof(double);
+	for (i = 0; i < len; i++) {
+		x = pts[2 * i];
+		y = pts[2 * i + 1];
+		pts[2 * i] = m11 * x + m12 * y + dx;
+		pts[2 * i + 1] = m21 * x + m22 * y + dy;
+	}
+
+	Py_INCREF(Py_None);
+	return Py_None;
+}
+
+/* Exact bounding box of packed paths, same as get_path_bbox()
+ * for cairo path.
+ */
+static PyObject *
+cairo_GetPackedBbox (PyObject *self, PyObject *args) {
+
+	double bbox[4] = {0.0, 0.0, 0.0, 0.0};
+	double x = 0.0, y = 0.0;
+	PyObject *ops_obj, *coords_obj;
+	const unsigned char *ops;
+	const double *coords;
+	int i, op, ops_num, empty = 1;
+
+	if (!PyArg_ParseTuple(args, "OO", &ops_obj, &coords_obj)) {
+		return NULL;
+	}
+	if (!get_packed_buffers(ops_obj, coords_obj, &ops, &ops_num, &coords)) {
+		return NULL;
+	}
+
+	for (i = 0; i < ops_num; i++) {
+		op = ops[i] & PATH_OP_MASK;
+		if (op == PATH_CLOSE) {
+			continue;
+		}
+		if (empty) {
+			bbox[0] = bbox[2] = coords[0];
+			bbox[1] = bbox[3] = coords[1];
+			empty = 0;
+		}
+		if (op == PATH_CURVE) {
+			bbox_add_curve_axis(&bbox[0], &bbox[2], x, coords[0],
+					coords[2], coords[4]);
+			bbox_add_curve_axis(&bbox[1], &bbox[3], y, coords[1],
+					coords[3], coords[5]);
+			x = coords[4];
+			y = coords[5];
+			coords += 6;
+		} else {
+			x = coords[0];
+			y = coords[1];
+			bbox_add_value(&bbox[0], &bbox[2], x);
+			bbox_add_value(&bbox[1], &bbox[3], y);
+			coords += 2;
+		}
+	}
+	return Py_BuildValue("[dddd]", bbox[0], bbox[1], bbox[2], bbox[3]);
+}
+
+/* Reverses direction of each packed path.
+ * New segment ending at original node takes marker of that node
+ * (or of the reversed segment for line nodes), closed marker is kept.
+ * Returns (opcodes, coordinates) strings as get_packed_path_from_cpath().
+ */
+static PyObject *
+cairo_ReversePacked (PyObject *self, PyObject *args) {
+
+	PyObject *ops_obj, *coords_obj, *new_ops, *new_coords, *ret;
+	const unsigned char *ops;
+	const double *coords, *end;
+	unsigned char *op_ptr;
+	double *coord_ptr;
+	int *offsets;
+	int i, j, start, stop, closed, ops_num, coords_num = 0;
+
+	if (!PyArg_ParseTuple(args, "OO", &ops_obj, &coords_obj)) {
+		return NULL;
+	}
+	if (!get_packed_buffers(ops_obj, coords_obj, &ops, &ops_num, &coords)) {
+		return NULL;
+	}
+
+	offsets = (int *) malloc(sizeof(int) * (ops_num + 1));
+	if (offsets == NULL) {
+		return PyErr_NoMemory();
+	}
+	for (i = 0; i < ops_num; i++) {
+		offsets[i] = coords_num;
+		coords_num += 2 * packed_points_num(ops[i]);
+	}
+
+	new_ops = PyString_FromStringAndSize(NULL, ops_num);
+	new_coords = PyString_FromStringAndSize(NULL, coords_num * sizeof(double));
+	if (new_ops == NULL || new_coords == NULL) {
+		Py_XDECREF(new_ops);
+		Py_XDECREF(new_coords);
+		free(offsets);
+		return NULL;
+	}
+	op_ptr = (unsigned char *) PyString_AS_STRING(new_ops);
+	coord_ptr = (double *) PyString_AS_STRING(new_coords);
+
+	for (start = 0; start < ops_num; start = stop) {
+		closed = 0;
+		for (stop = start + 1; stop < ops_num; stop++) {
+			if ((ops[stop] & PATH_OP_MASK) == PATH_MOVE) {
+				break;
+			}
+			if ((ops[stop] & PATH_OP_MASK) == PATH_CLOSE) {
+				closed = 1;
+			}
+		}
+
+		/* last node becomes the start point */
+		for (j = stop - 1; (ops[j] & PATH_OP_MASK) == PATH_CLOSE; j--);
+		end = coords + offsets[j] + 2 * packed_points_num(ops[j]) - 2;
+		*op_ptr++ = PATH_MOVE;
+		*coord_ptr++ = end[0];
+		*coord_ptr++ = end[1];
+
+		while (j > start) {
+			for (i = j - 1; (ops[i] & PATH_OP_MASK) == PATH_CLOSE; i--);
+			end = coords + offsets[i] + 2 * packed_points_num(ops[i]) - 2;
+			if ((ops[j] & PATH_OP_MASK) == PATH_CURVE) {
+				if ((ops[i] & PATH_OP_MASK) == PATH_CURVE) {
+					*op_ptr++ = PATH_CURVE | (ops[i] & ~PATH_OP_MASK);
+				} else {
+					*op_ptr++ = ops[j];
+				}
+				memcpy(coord_ptr, coords + offsets[j] + 2, 2 * sizeof(double));
+				memcpy(coord_ptr + 2, coords + offsets[j], 2 * sizeof(double));
+				coord_ptr += 4;
+			} else {
+				*op_ptr++ = PATH_LINE;
+			}
+			*coord_ptr++ = end[0];
+			*coord_ptr++ = end[1];
+			j = i;
+		}
+		if (closed) {
+			*op_ptr++ = PATH_CLOSE;
+		}
+	}
+	free(offsets);
+
+	/* repeated close opcodes of the source are not copied */
+	if (_PyString_Resize(&new_ops,
+			(char *) op_ptr - PyString_AS_STRING(new_ops)) < 0) {
+		Py_DECREF(new_coords);
+		return NULL;
+	}
+	ret = Py_BuildValue("(OO)", new_ops, new_coords);
+	Py_DECREF(new_ops);
+	Py_DECREF(new_coords);
+	return ret;
 }
 
 static PyObject *
@@ -325,15 +881,2144 @@ cairo_DrawRGBAImage (PyObject *self, PyObject *args) {
 	return Py_None;
 }
 
+/* PNG row filtering. Filter type is chosen per row by minimum sum of
+ * absolute differences (the libpng heuristic). Up, Average and Paeth
+ * filters need previous row, so without it only None and Sub are tried.
+ */
+#define PNG_BPP 4
+
+static unsigned char
+png_paeth(int a, int b, int c) {
+	int p = a + b - c;
+	int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+	if (pa <= pb && pa <= pc) {
+		return a;
+	}
+	return pb <= pc ? b : c;
+}
+
+static unsigned char
+png_filter_byte(int type, unsigned char *row, unsigned char *prev, int i) {
+	int a = i >= PNG_BPP ? row[i - PNG_BPP] : 0;
+	int b = prev ? prev[i] : 0;
+	int c = prev && i >= PNG_BPP ? prev[i - PNG_BPP] : 0;
+	switch (type) {
+		case 1:
+			return row[i] - a;
+		case 2:
+			return row[i] - b;
+		case 3:
+			return row[i] - ((a + b) >> 1);
+		case 4:
+			return row[i] - png_paeth(a, b, c);
+	}
+	return row[i];
+}
+
+static void
+png_filter_row(unsigned char *row, unsigned char *prev, int size,
+		unsigned char *dest) {
+
+	int i, type, types = prev ? 5 : 2, best = 0;
+	unsigned long sum, best_sum = 0;
+	unsigned char value;
+
+	for (type = 0; type < types; type++) {
+		sum = 0;
+		for (i = 0; i < size && (!type || sum < best_sum); i++) {
+			value = png_filter_byte(type, row, prev, i);
+			sum += value < 128 ? value : 256 - value;
+		}
+		if (!type || sum < best_sum) {
+			best_sum = sum;
+			best = type;
+		}
+	}
+
+	*dest++ = best;
+	for (i = 0; i < size; i++) {
+		dest[i] = png_filter_byte(best, row, prev, i);
+	}
+}
+
+/* Converts ARGB32 surface into filtered PNG scanlines (non-premultiplied
+ * RGBA), ready for zlib compression. The surface may be a strip of
+ * a larger image, rows are emitted top to bottom. First row of the strip
+ * is filtered without previous row, so strips are independent.
+ */
+static PyObject *
+cairo_GetPNGScanlines (PyObject *self, PyObject *args) {
+
+	PycairoSurface *pysurface;
+	cairo_surface_t *surface;
+	int width, height, stride, x, y;
+	uint32_t pixel, alpha;
+	unsigned char *src, *dest, *row, *prev, *tmp, *rows;
+	PyObject *ret;
+
+	if (!PyArg_ParseTuple(args, "O", &pysurface)) {
+		return NULL;
+	}
+
+	surface = pysurface -> surface;
+	cairo_surface_flush(surface);
+	width = cairo_image_surface_get_width(surface);
+	height = cairo_image_surface_get_height(surface);
+	stride = cairo_image_surface_get_stride(surface);
+	src = cairo_image_surface_get_data(surface);
+
+	rows = (unsigned char *) PyMem_Malloc(8 * (size_t)width + 1);
+	if (rows == NULL) {
+		return PyErr_NoMemory();
+	}
+	ret = PyString_FromStringAndSize(NULL,
+			(Py_ssize_t)height * (1 + 4 * (Py_ssize_t)width));
+	if (ret == NULL) {
+		PyMem_Free(rows);
+		return NULL;
+	}
+	dest = (unsigned char *) PyString_AS_STRING(ret);
+
+	Py_BEGIN_ALLOW_THREADS
+	row = rows;
+	prev = NULL;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			pixel = ((uint32_t *)(src + y * stride))[x];
+			alpha = pixel >> 24;
+			tmp = row + 4 * x;
+			if (alpha == 0) {
+				tmp[0] = tmp[1] = tmp[2] = tmp[3] = 0;
+			} else if (alpha == 255) {
+				tmp[0] = (pixel >> 16) & 0xff;
+				tmp[1] = (pixel >> 8) & 0xff;
+				tmp[2] = pixel & 0xff;
+				tmp[3] = 255;
+			} else {
+				tmp[0] = (((pixel >> 16) & 0xff) * 255 + alpha / 2) / alpha;
+				tmp[1] = (((pixel >> 8) & 0xff) * 255 + alpha / 2) / alpha;
+				tmp[2] = ((pixel & 0xff) * 255 + alpha / 2) / alpha;
+				tmp[3] = alpha;
+			}
+		}
+		png_filter_row(row, prev, 4 * width, dest);
+		dest += 1 + 4 * width;
+		tmp = prev ? prev : rows + 4 * width;
+		prev = row;
+		row = tmp;
+	}
+	Py_END_ALLOW_THREADS
+
+	PyMem_Free(rows);
+	return ret;
+}
+
+/* Polyline intersection kernel for libgeom.shaping.
+ *
+ * Input polylines are approximated path partials: sequences of
+ * (point, t) items. Segments of every polyline pair from two lists
+ * are tested if polyline bboxes overlap. Candidate pairs are found by
+ * sort-and-sweep over bbox X ranges: polylines of both lists enter the
+ * sweep at their left edges and leave active sets after their right
+ * edges are passed. Crossing tests repeat Python implementation
+ * (coordinates are compared rounded to 8 digits).
+ */
+#define CP_PRECISION 1e8
+
+typedef struct {
+	double *pts;
+	int n;
+	double rect[4];
+} Polyline;
+
+typedef struct {
+	int a, b, p, q;
+	double x, y;
+} CrossPoint;
+
+typedef struct {
+	double x;
+	int index;
+	int list;
+} SweepItem;
+
+/* Active polylines of the sweep: binary min-heap of polyline indexes
+ * ordered by right bbox edge. */
+typedef struct {
+	int *items;
+	int size;
+	Polyline *lines;
+} SweepHeap;
+
+#define HEAP_RIGHT(heap, pos) ((heap)->lines[(heap)->items[pos]].rect[2])
+
+static double
+round_prec(double val) {
+	return round(val * CP_PRECISION) / CP_PRECISION;
+}
+
+static int
+equal_points(double *p0, double *p1) {
+	return round_prec(p0[0]) == round_prec(p1[0]) &&
+			round_prec(p0[1]) == round_prec(p1[1]);
+}
+
+static int
+in_range(double *p, double *a, double *b) {
+	double x = round_prec(p[0]), y = round_prec(p[1]);
+	return round_prec(fmin(a[0], b[0])) <= x &&
+			x <= round_prec(fmax(a[0], b[0])) &&
+			round_prec(fmin(a[1], b[1])) <= y &&
+			y <= round_prec(fmax(a[1], b[1]));
+}
+
+static int
+intersect_lines(double *p0, double *p1, double *p2, double *p3, double *cp) {
+
+	double a1, a2, b1, b2, c1, c2;
+
+	a1 = p1[0] - p0[0];
+	a2 = p3[0] - p2[0];
+	b1 = p0[1] - p1[1];
+	b2 = p2[1] - p3[1];
+	if (b1 * a2 - b2 * a1 == 0 || b2 * a1 - b1 * a2 == 0) {
+		return 0;
+	}
+	c1 = p0[0] * p1[1] - p1[0] * p0[1];
+	c2 = p2[0] * p3[1] - p3[0] * p2[1];
+	cp[0] = (a1 * c2 - a2 * c1) / (b1 * a2 - a1 * b2);
+	cp[1] = (b1 * c2 - b2 * c1) / (a1 * b2 - b1 * a2);
+	return in_range(cp, p0, p1) && in_range(cp, p2, p3);
+}
+
+static int
+rects_overlap(double *r1, double *r2) {
+	double w = fmax(r1[2], r2[2]) - fmin(r1[0], r2[0]);
+	double h = fmax(r1[3], r2[3]) - fmin(r1[1], r2[1]);
+	return w <= (r1[2] - r1[0]) + (r2[2] - r2[0]) &&
+			h <= (r1[3] - r1[1]) + (r2[3] - r2[1]);
+}
+
+static void
+free_polylines(Polyline *lines, int size) {
+	int i;
+	if (lines == NULL) {
+		return;
+	}
+	for (i = 0; i < size; i++) {
+		PyMem_Free(lines[i].pts);
+	}
+	PyMem_Free(lines);
+}
+
+/* Polyline items are either ([x, y], t) tuples (with_t is set)
+ * or plain [x, y] points. */
+static Polyline *
+parse_polylines(PyObject *seq, int *size, int with_t) {
+
+	Polyline *lines;
+	PyObject *fast, *points, *item, *point;
+	double x = 0.0, y = 0.0;
+	int i, j, valid;
+
+	fast = PySequence_Fast(seq, "polyline list expected");
+	if (fast == NULL) {
+		return NULL;
+	}
+	*size = (int) PySequence_Fast_GET_SIZE(fast);
+	lines = (Polyline *) PyMem_Malloc(sizeof(Polyline) * (*size + 1));
+	if (lines == NULL) {
+		Py_DECREF(fast);
+		PyErr_NoMemory();
+		return NULL;
+	}
+	memset(lines, 0, sizeof(Polyline) * (*size + 1));
+
+	for (i = 0; i < *size; i++) {
+		points = PySequence_Fast(PySequence_Fast_GET_ITEM(fast, i),
+				"polyline expected");
+		if (points == NULL) {
+			free_polylines(lines, *size);
+			Py_DECREF(fast);
+			return NULL;
+		}
+		lines[i].n = (int) PySequence_Fast_GET_SIZE(points);
+		lines[i].pts = (double *) PyMem_Malloc(
+				sizeof(double) * 2 * (lines[i].n + 1));
+		for (j = 0; j < lines[i].n && lines[i].pts != NULL; j++) {
+			item = PySequence_Fast_GET_ITEM(points, j);
+			if (with_t) {
+				point = PySequence_GetItem(item, 0);
+			} else {
+				point = item;
+				Py_INCREF(point);
+			}
+			valid = point != NULL && PySequence_Check(point) &&
+					PySequence_Size(point) >= 2;
+			if (valid) {
+				item = PySequence_GetItem(point, 0);
+				x = item ? PyFloat_AsDouble(item) : -1.0;
+				Py_XDECREF(item);
+				item = PySequence_GetItem(point, 1);
+				y = item ? PyFloat_AsDouble(item) : -1.0;
+				Py_XDECREF(item);
+				valid = !PyErr_Occurred();
+			}
+			Py_XDECREF(point);
+			if (!valid) {
+				PyErr_Clear();
+				PyErr_SetString(PyExc_TypeError, with_t ?
+						"polyline item should be ([x, y], t)" :
+						"polyline item should be [x, y]");
+				break;
+			}
+			lines[i].pts[2 * j] = x;
+			lines[i].pts[2 * j + 1] = y;
+			if (!j) {
+				lines[i].rect[0] = lines[i].rect[2] = x;
+				lines[i].rect[1] = lines[i].rect[3] = y;
+			} else {
+				lines[i].rect[0] = fmin(lines[i].rect[0], x);
+				lines[i].rect[1] = fmin(lines[i].rect[1], y);
+				lines[i].rect[2] = fmax(lines[i].rect[2], x);
+				lines[i].rect[3] = fmax(lines[i].rect[3], y);
+			}
+		}
+		Py_DECREF(points);
+		if (lines[i].pts == NULL || j < lines[i].n) {
+			if (lines[i].pts == NULL) {
+				PyErr_NoMemory();
+			}
+			free_polylines(lines, *size);
+			Py_DECREF(fast);
+			return NULL;
+		}
+	}
+	Py_DECREF(fast);
+	return lines;
+}
+
+static int
+compare_sweep_items(const void *i1, const void *i2) {
+	double x1 = ((const SweepItem *)i1)->x;
+	double x2 = ((const SweepItem *)i2)->x;
+	return (x1 > x2) - (x1 < x2);
+}
+
+static void
+sweep_heap_push(SweepHeap *heap, int index) {
+	int pos = heap->size++, parent;
+	double x = heap->lines[index].rect[2];
+	while (pos > 0) {
+		parent = (pos - 1) / 2;
+		if (HEAP_RIGHT(heap, parent) <= x) {
+			break;
+		}
+		heap->items[pos] = heap->items[parent];
+		pos = parent;
+	}
+	heap->items[pos] = index;
+}
+
+static void
+sweep_heap_pop(SweepHeap *heap) {
+	int pos = 0, child, last;
+	double x;
+	last = heap->items[--heap->size];
+	x = heap->lines[last].rect[2];
+	while ((child = 2 * pos + 1) < heap->size) {
+		if (child + 1 < heap->size &&
+				HEAP_RIGHT(heap, child + 1) < HEAP_RIGHT(heap, child)) {
+			child++;
+		}
+		if (x <= HEAP_RIGHT(heap, child)) {
+			break;
+		}
+		heap->items[pos] = heap->items[child];
+		pos = child;
+	}
+	heap->items[pos] = last;
+}
+
+/* drops polylines which right edge is passed (with rounding margin) */
+static void
+sweep_heap_drop(SweepHeap *heap, double x) {
+	double right;
+	while (heap->size) {
+		right = HEAP_RIGHT(heap, 0);
+		if (x <= right + 1e-9 * (1.0 + fabs(right))) {
+			break;
+		}
+		sweep_heap_pop(heap);
+	}
+}
+
+static int
+compare_cross_points(const void *c1, const void *c2) {
+	const CrossPoint *cp1 = (const CrossPoint *)c1;
+	const CrossPoint *cp2 = (const CrossPoint *)c2;
+	if (cp1->a != cp2->a) return cp1->a < cp2->a ? -1 : 1;
+	if (cp1->b != cp2->b) return cp1->b < cp2->b ? -1 : 1;
+	if (cp1->p != cp2->p) return cp1->p < cp2->p ? -1 : 1;
+	if (cp1->q != cp2->q) return cp1->q < cp2->q ? -1 : 1;
+	return 0;
+}
+
+static int
+add_cross_point(CrossPoint **cps, int *num, int *cap, CrossPoint *cp) {
+	CrossPoint *tmp;
+	if (*num == *cap) {
+		*cap = *cap ? *cap * 2 : 64;
+		tmp = (CrossPoint *) realloc(*cps, sizeof(CrossPoint) * *cap);
+		if (tmp == NULL) {
+			return 0;
+		}
+		*cps = tmp;
+	}
+	(*cps)[(*num)++] = *cp;
+	return 1;
+}
+
+static int
+intersect_pair(Polyline *l1, Polyline *l2, int a, int b,
+		CrossPoint **cps, int *num, int *cap) {
+
+	int p, q;
+	double *p0, *p1, *p2, *p3, xy[2];
+	CrossPoint cp;
+
+	for (p = 1; p < l1->n; p++) {
+		p0 = l1->pts + 2 * (p - 1);
+		p1 = l1->pts + 2 * p;
+		for (q = 1; q < l2->n; q++) {
+			p2 = l2->pts + 2 * (q - 1);
+			p3 = l2->pts + 2 * q;
+			if (equal_points(p0, p2)) {
+				xy[0] = p0[0];
+				xy[1] = p0[1];
+			} else if (equal_points(p0, p3) || equal_points(p1, p2) ||
+					equal_points(p1, p3)) {
+				continue;
+			} else if (!intersect_lines(p0, p1, p2, p3, xy)) {
+				continue;
+			}
+			cp.a = a; cp.b = b; cp.p = p; cp.q = q;
+			cp.x = xy[0]; cp.y = xy[1];
+			if (!add_cross_point(cps, num, cap, &cp)) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+static int
+sweep_pair(Polyline *lines1, Polyline *lines2, int i, int j, int skip_same,
+		CrossPoint **cps, int *num, int *cap) {
+
+	if (skip_same && i == j) {
+		return 1;
+	}
+	if (!rects_overlap(lines1[i].rect, lines2[j].rect)) {
+		return 1;
+	}
+	return intersect_pair(lines1 + i, lines2 + j, i, j, cps, num, cap);
+}
+
+/* intersect_polylines(polylines1, polylines2, skip_same=0)
+ * Returns list of (i, j, p, q, [x, y]) tuples, where i and j are
+ * polyline indexes in the first and second lists, p and q are indexes
+ * of segment end points. Result is ordered as nested loops over i, j,
+ * p and q would produce. If skip_same is set, pairs with i == j are
+ * ignored (both lists should be the same for self intersection).
+ */
+static PyObject *
+cairo_IntersectPolylines (PyObject *self, PyObject *args) {
+
+	PyObject *seq1, *seq2, *ret;
+	Polyline *lines1, *lines2;
+	int size1 = 0, size2 = 0, skip_same = 0;
+	SweepItem *order = NULL;
+	SweepHeap heap1, heap2;
+	int i, k, j, m, ok = 1;
+	CrossPoint *cps = NULL;
+	int num = 0, cap = 0;
+
+	if (!PyArg_ParseTuple(args, "OO|i", &seq1, &seq2, &skip_same)) {
+		return NULL;
+	}
+
+	lines1 = parse_polylines(seq1, &size1, 1);
+	if (lines1 == NULL) {
+		return NULL;
+	}
+	lines2 = parse_polylines(seq2, &size2, 1);
+	if (lines2 == NULL) {
+		free_polylines(lines1, size1);
+		return NULL;
+	}
+
+	heap1.lines = lines1;
+	heap1.size = 0;
+	heap2.lines = lines2;
+	heap2.size = 0;
+
+	Py_BEGIN_ALLOW_THREADS
+	order = (SweepItem *) malloc(sizeof(SweepItem) * (size1 + size2 + 1));
+	heap1.items = (int *) malloc(sizeof(int) * (size1 + 1));
+	heap2.items = (int *) malloc(sizeof(int) * (size2 + 1));
+	if (order == NULL || heap1.items == NULL || heap2.items == NULL) {
+		ok = 0;
+	} else {
+		for (k = 0; k < size1; k++) {
+			order[k].x = lines1[k].rect[0];
+			order[k].index = k;
+			order[k].list = 0;
+		}
+		for (k = 0; k < size2; k++) {
+			order[size1 + k].x = lines2[k].rect[0];
+			order[size1 + k].index = k;
+			order[size1 + k].list = 1;
+		}
+		qsort(order, size1 + size2, sizeof(SweepItem), compare_sweep_items);
+	}
+
+	/* each polyline is tested against active polylines of other list
+	 * only, so every pair is checked once */
+	for (k = 0; ok && k < size1 + size2; k++) {
+		sweep_heap_drop(&heap1, order[k].x);
+		sweep_heap_drop(&heap2, order[k].x);
+		if (order[k].list) {
+			j = order[k].index;
+			for (m = 0; ok && m < heap1.size; m++) {
+				ok = sweep_pair(lines1, lines2, heap1.items[m], j,
+						skip_same, &cps, &num, &cap);
+			}
+			sweep_heap_push(&heap2, j);
+		} else {
+			i = order[k].index;
+			for (m = 0; ok && m < heap2.size; m++) {
+				ok = sweep_pair(lines1, lines2, i, heap2.items[m],
+						skip_same, &cps, &num, &cap);
+			}
+			sweep_heap_push(&heap1, i);
+		}
+	}
+
+	if (ok && num) {
+		qsort(cps, num, sizeof(CrossPoint), compare_cross_points);
+	}
+	free(order);
+	free(heap1.items);
+	free(heap2.items);
+	Py_END_ALLOW_THREADS
+
+	free_polylines(lines1, size1);
+	free_polylines(lines2, size2);
+
+	if (!ok) {
+		free(cps);
+		return PyErr_NoMemory();
+	}
+
+	ret = PyList_New(num);
+	for (i = 0; i < num; i++) {
+		PyList_SET_ITEM(ret, i, Py_BuildValue("(iiii[dd])",
+				cps[i].a, cps[i].b, cps[i].p, cps[i].q, cps[i].x, cps[i].y));
+	}
+	free(cps);
+	return ret;
+}
+
+/* Segment grid for batch point tests over flattened paths.
+ * Polylines are treated as closed contours for winding, but closing
+ * segment of open polyline is not a part of outline. Each grid cell
+ * keeps indexes of segments which bounding boxes overlap the cell. */
+
+#define GRID_MAX_SIDE 256
+
+typedef struct {
+	double x0, y0, x1, y1;
+	int outline;
+} Segment;
+
+typedef struct {
+	Segment *segs;
+	int nsegs;
+	int cols, rows;
+	double rect[4];
+	double cw, ch;
+	int *offsets;
+	int *cells;
+} SegmentGrid;
+
+static void
+free_segment_grid(void *ptr) {
+	SegmentGrid *grid = (SegmentGrid *)ptr;
+	if (grid == NULL) {
+		return;
+	}
+	free(grid->segs);
+	free(grid->offsets);
+	free(grid->cells);
+	free(grid);
+}
+
+static int
+grid_index(double val, double start, double step, int size) {
+	double i = floor((val - start) / step);
+	if (i < 0) {
+		return 0;
+	}
+	return i >= size ? size - 1 : (int) i;
+}
+
+static void
+grid_cell_range(SegmentGrid *grid, Segment *s, int *range) {
+	range[0] = grid_index(fmin(s->x0, s->x1), grid->rect[0], grid->cw,
+			grid->cols);
+	range[1] = grid_index(fmax(s->x0, s->x1), grid->rect[0], grid->cw,
+			grid->cols);
+	range[2] = grid_index(fmin(s->y0, s->y1), grid->rect[1], grid->ch,
+			grid->rows);
+	range[3] = grid_index(fmax(s->y0, s->y1), grid->rect[1], grid->ch,
+			grid->rows);
+}
+
+static SegmentGrid *
+build_segment_grid(Polyline *lines, int size, char *closed) {
+
+	SegmentGrid *grid;
+	Segment *s;
+	double *pts;
+	int i, j, n, k, c, r, side, ncells, range[4];
+	int *cursor;
+
+	grid = (SegmentGrid *) calloc(1, sizeof(SegmentGrid));
+	if (grid == NULL) {
+		return NULL;
+	}
+
+	for (i = 0; i < size; i++) {
+		if (lines[i].n > 1) {
+			grid->nsegs += lines[i].n;
+		}
+	}
+	grid->segs = (Segment *) malloc(sizeof(Segment) * (grid->nsegs + 1));
+	if (grid->segs == NULL) {
+		free_segment_grid(grid);
+		return NULL;
+	}
+
+	k = 0;
+	for (i = 0; i < size; i++) {
+		n = lines[i].n;
+		pts = lines[i].pts;
+		if (n < 2) {
+			continue;
+		}
+		for (j = 0; j < n; j++) {
+			/* last segment closes the contour */
+			s = grid->segs + k;
+			s->x0 = pts[2 * j];
+			s->y0 = pts[2 * j + 1];
+			s->x1 = pts[2 * ((j + 1) % n)];
+			s->y1 = pts[2 * ((j + 1) % n) + 1];
+			s->outline = j < n - 1 || closed[i];
+			if (s->x0 == s->x1 && s->y0 == s->y1) {
+				continue;
+			}
+			if (!k) {
+				grid->rect[0] = grid->rect[2] = s->x0;
+				grid->rect[1] = grid->rect[3] = s->y0;
+			}
+			grid->rect[0] = fmin(grid->rect[0], fmin(s->x0, s->x1));
+			grid->rect[1] = fmin(grid->rect[1], fmin(s->y0, s->y1));
+			grid->rect[2] = fmax(grid->rect[2], fmax(s->x0, s->x1));
+			grid->rect[3] = fmax(grid->rect[3], fmax(s->y0, s->y1));
+			k++;
+		}
+	}
+	grid->nsegs = k;
+
+	side = (int) ceil(sqrt((double) grid->nsegs));
+	side = side < 1 ? 1 : (side > GRID_MAX_SIDE ? GRID_MAX_SIDE : side);
+	grid->cols = grid->rows = side;
+	grid->cw = (grid->rect[2] - grid->rect[0]) / side;
+	grid->ch = (grid->rect[3] - grid->rect[1]) / side;
+	if (grid->cw <= 0.0) {
+		grid->cw = 1.0;
+	}
+	if (grid->ch <= 0.0) {
+		grid->ch = 1.0;
+	}
+
+	ncells = side * side;
+	grid->offsets = (int *) calloc(ncells + 1, sizeof(int));
+	cursor = (int *) malloc(sizeof(int) * ncells);
+	if (grid->offsets == NULL || cursor == NULL) {
+		free(cursor);
+		free_segment_grid(grid);
+		return NULL;
+	}
+
+	for (k = 0; k < grid->nsegs; k++) {
+		grid_cell_range(grid, grid->segs + k, range);
+		for (r = range[2]; r <= range[3]; r++) {
+			for (c = range[0]; c <= range[1]; c++) {
+				grid->offsets[r * side + c + 1]++;
+			}
+		}
+	}
+	for (i = 0; i < ncells; i++) {
+		grid->offsets[i + 1] += grid->offsets[i];
+		cursor[i] = grid->offsets[i];
+	}
+
+	grid->cells = (int *) malloc(sizeof(int) * (grid->offsets[ncells] + 1));
+	if (grid->cells == NULL) {
+		free(cursor);
+		free_segment_grid(grid);
+		return NULL;
+	}
+	for (k = 0; k < grid->nsegs; k++) {
+		grid_cell_range(grid, grid->segs + k, range);
+		for (r = range[2]; r <= range[3]; r++) {
+			for (c = range[0]; c <= range[1]; c++) {
+				grid->cells[cursor[r * side + c]++] = k;
+			}
+		}
+	}
+	free(cursor);
+	return grid;
+}
+
+/* Casts horizontal ray to the right of the point. Every crossing is
+ * counted in the cell where it happens, so segments shared by several
+ * cells are not counted twice. */
+static int
+grid_winding(SegmentGrid *grid, double px, double py, int evenodd) {
+
+	Segment *s;
+	int row, col, c, k, winding = 0;
+	double x;
+
+	if (!grid->nsegs || px > grid->rect[2] || px < grid->rect[0] ||
+			py > grid->rect[3] || py < grid->rect[1]) {
+		return 0;
+	}
+	row = grid_index(py, grid->rect[1], grid->ch, grid->rows);
+	col = grid_index(px, grid->rect[0], grid->cw, grid->cols);
+	for (c = col; c < grid->cols; c++) {
+		for (k = grid->offsets[row * grid->cols + c];
+				k < grid->offsets[row * grid->cols + c + 1]; k++) {
+			s = grid->segs + grid->cells[k];
+			if ((s->y0 > py) == (s->y1 > py)) {
+				continue;
+			}
+			x = s->x0 + (py - s->y0) * (s->x1 - s->x0) / (s->y1 - s->y0);
+			x = fmax(fmin(x, fmax(s->x0, s->x1)), fmin(s->x0, s->x1));
+			if (x <= px ||
+					grid_index(x, grid->rect[0], grid->cw, grid->cols) != c) {
+				continue;
+			}
+			if (evenodd) {
+				winding ^= 1;
+			} else {
+				winding += s->y1 > s->y0 ? 1 : -1;
+			}
+		}
+	}
+	return winding != 0;
+}
+
+static int
+grid_near(SegmentGrid *grid, double px, double py, double tolerance) {
+
+	Segment *s;
+	int r, c, k, r0, r1, c0, c1;
+	double dx, dy, len, t, ex, ey, tol2 = tolerance * tolerance;
+
+	if (!grid->nsegs || tolerance < 0.0 ||
+			px > grid->rect[2] + tolerance || px < grid->rect[0] - tolerance ||
+			py > grid->rect[3] + tolerance || py < grid->rect[1] - tolerance) {
+		return 0;
+	}
+	c0 = grid_index(px - tolerance, grid->rect[0], grid->cw, grid->cols);
+	c1 = grid_index(px + tolerance, grid->rect[0], grid->cw, grid->cols);
+	r0 = grid_index(py - tolerance, grid->rect[1], grid->ch, grid->rows);
+	r1 = grid_index(py + tolerance, grid->rect[1], grid->ch, grid->rows);
+	for (r = r0; r <= r1; r++) {
+		for (c = c0; c <= c1; c++) {
+			for (k = grid->offsets[r * grid->cols + c];
+					k < grid->offsets[r * grid->cols + c + 1]; k++) {
+				s = grid->segs + grid->cells[k];
+				if (!s->outline) {
+					continue;
+				}
+				dx = s->x1 - s->x0;
+				dy = s->y1 - s->y0;
+				len = dx * dx + dy * dy;
+				t = ((px - s->x0) * dx + (py - s->y0) * dy) / len;
+				t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+				ex = s->x0 + t * dx - px;
+				ey = s->y0 + t * dy - py;
+				if (ex * ex + ey * ey <= tol2) {
+					return 1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+static SegmentGrid *
+get_segment_grid(PyObject *obj) {
+	if (!PyCObject_Check(obj)) {
+		PyErr_SetString(PyExc_TypeError, "segment grid expected");
+		return NULL;
+	}
+	return (SegmentGrid *) PyCObject_AsVoidPtr(obj);
+}
+
+/* create_segment_grid(polylines, closed=None)
+ * Polylines are lists of [x, y] points, for example flattened paths.
+ * closed is None (all polylines are closed) or sequence of
+ * closed flags for every polyline.
+ */
+static PyObject *
+cairo_CreateSegmentGrid (PyObject *self, PyObject *args) {
+
+	PyObject *seq, *flags = Py_None, *fast;
+	Polyline *lines;
+	SegmentGrid *grid;
+	char *closed;
+	int size = 0, i;
+
+	if (!PyArg_ParseTuple(args, "O|O", &seq, &flags)) {
+		return NULL;
+	}
+	lines = parse_polylines(seq, &size, 0);
+	if (lines == NULL) {
+		return NULL;
+	}
+	closed = (char *) malloc(size + 1);
+	if (closed == NULL) {
+		free_polylines(lines, size);
+		return PyErr_NoMemory();
+	}
+	memset(closed, 1, size + 1);
+	if (flags != Py_None) {
+		fast = PySequence_Fast(flags, "sequence of closed flags expected");
+		if (fast != NULL && PySequence_Fast_GET_SIZE(fast) != size) {
+			Py_DECREF(fast);
+			fast = NULL;
+			PyErr_SetString(PyExc_ValueError,
+					"closed flags number differs from polylines number");
+		}
+		if (fast == NULL) {
+			free(closed);
+			free_polylines(lines, size);
+			return NULL;
+		}
+		for (i = 0; i < size; i++) {
+			closed[i] = PyObject_IsTrue(PySequence_Fast_GET_ITEM(fast, i)) > 0;
+		}
+		Py_DECREF(fast);
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	grid = build_segment_grid(lines, size, closed);
+	Py_END_ALLOW_THREADS
+
+	free(closed);
+	free_polylines(lines, size);
+	if (grid == NULL) {
+		return PyErr_NoMemory();
+	}
+	return PyCObject_FromVoidPtr((void *)grid, free_segment_grid);
+}
+
+/* check_points(grid, points, fill_rule, tolerance)
+ * Tests all points at once. fill_rule is 0 for outline only test,
+ * 1 for nonzero winding and 2 for even-odd rule. Point hits if it is
+ * inside of filled area or not far than tolerance from outline.
+ * Returns list of booleans.
+ */
+static PyObject *
+cairo_CheckPoints (PyObject *self, PyObject *args) {
+
+	PyObject *grid_obj, *seq, *wrapper, *ret;
+	SegmentGrid *grid;
+	Polyline *points;
+	int size = 0, fill_rule, i, *hits;
+	double tolerance, *pts;
+
+	if (!PyArg_ParseTuple(args, "OOid", &grid_obj, &seq,
+			&fill_rule, &tolerance)) {
+		return NULL;
+	}
+	grid = get_segment_grid(grid_obj);
+	if (grid == NULL) {
+		return NULL;
+	}
+	wrapper = Py_BuildValue("[O]", seq);
+	points = parse_polylines(wrapper, &size, 0);
+	Py_DECREF(wrapper);
+	if (points == NULL) {
+		return NULL;
+	}
+	hits = (int *) malloc(sizeof(int) * (points[0].n + 1));
+	if (hits == NULL) {
+		free_polylines(points, size);
+		return PyErr_NoMemory();
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	pts = points[0].pts;
+	for (i = 0; i < points[0].n; i++) {
+		hits[i] = fill_rule &&
+				grid_winding(grid, pts[2 * i], pts[2 * i + 1], fill_rule == 2);
+		if (!hits[i]) {
+			hits[i] = grid_near(grid, pts[2 * i], pts[2 * i + 1], tolerance);
+		}
+	}
+	Py_END_ALLOW_THREADS
+
+	ret = PyList_New(points[0].n);
+	for (i = 0; i < points[0].n; i++) {
+		PyList_SET_ITEM(ret, i, PyBool_FromLong(hits[i]));
+	}
+	free(hits);
+	free_polylines(points, size);
+	return ret;
+}
+
+/* Flattening of sk2 paths. Each cubic segment is split into n uniform
+ * steps, so distance between the curve and its polyline is bounded by
+ * tolerance: for step h the error does not exceed h^2 / 8 * max|B''|,
+ * where max|B''| <= 6 * max(|p0 - 2p1 + p2|, |p1 - 2p2 + p3|).
+ * Curve points are evaluated by forward differencing into preallocated
+ * point buffer.
+ */
+
+#define FLAT_MAX_STEPS 1024
+
+typedef struct {
+	int curve;
+	int steps;
+	double pts[6];
+} PathNode;
+
+typedef struct {
+	double start[2];
+	int closed;
+	int first;
+	int num;
+	int size;
+} PathData;
+
+static int
+parse_point(PyObject *seq, double *xy) {
+
+	PyObject *item;
+	int i;
+
+	if (!PySequence_Check(seq) || PySequence_Size(seq) < 2) {
+		return 0;
+	}
+	for (i = 0; i < 2; i++) {
+		item = PySequence_GetItem(seq, i);
+		if (item == NULL) {
+			return 0;
+		}
+		xy[i] = PyFloat_AsDouble(item);
+		Py_DECREF(item);
+	}
+	return !PyErr_Occurred();
+}
+
+static int
+parse_node(PyObject *seq, PathNode *node) {
+
+	PyObject *item;
+	int i, ok = 1;
+
+	if (!PySequence_Check(seq)) {
+		return 0;
+	}
+	node->curve = PySequence_Size(seq) > 2;
+	if (!node->curve) {
+		return parse_point(seq, node->pts);
+	}
+	for (i = 0; i < 3 && ok; i++) {
+		item = PySequence_GetItem(seq, i);
+		ok = item != NULL && parse_point(item, node->pts + 2 * i);
+		Py_XDECREF(item);
+	}
+	return ok;
+}
+
+static int
+get_flat_steps(double *p0, double *pts, double tolerance) {
+
+	double d1, d2, steps;
+
+	d1 = hypot(p0[0] - 2.0 * pts[0] + pts[2], p0[1] - 2.0 * pts[1] + pts[3]);
+	d2 = hypot(pts[0] - 2.0 * pts[2] + pts[4],
+			pts[1] - 2.0 * pts[3] + pts[5]);
+	steps = ceil(sqrt(0.75 * fmax(d1, d2) / tolerance));
+	if (!(steps >= 1.0)) {
+		return 1;
+	}
+	return steps > FLAT_MAX_STEPS ? FLAT_MAX_STEPS : (int) steps;
+}
+
+static double *
+flat_curve(double *p0, PathNode *node, double *out) {
+
+	double a[2], b[2], f[2], df[2], ddf[2], dddf[2], *pts = node->pts;
+	double h = 1.0 / node->steps, h2 = h * h, h3 = h2 * h;
+	int i, j;
+
+	for (i = 0; i < 2; i++) {
+		a[i] = pts[4 + i] - p0[i] + 3.0 * (pts[i] - pts[2 + i]);
+		b[i] = 3.0 * (p0[i] - 2.0 * pts[i] + pts[2 + i]);
+		f[i] = p0[i];
+		df[i] = a[i] * h3 + b[i] * h2 + 3.0 * (pts[i] - p0[i]) * h;
+		ddf[i] = 6.0 * a[i] * h3 + 2.0 * b[i] * h2;
+		dddf[i] = 6.0 * a[i] * h3;
+	}
+	for (j = 1; j < node->steps; j++) {
+		for (i = 0; i < 2; i++) {
+			f[i] += df[i];
+			df[i] += ddf[i];
+			ddf[i] += dddf[i];
+			*out++ = f[i];
+		}
+	}
+	/* end point is copied as is to avoid error accumulation */
+	*out++ = pts[4];
+	*out++ = pts[5];
+	return out;
+}
+
+static double *
+flat_path_data(PathData *path, PathNode *nodes, double *out) {
+
+	double *last = path->start;
+	PathNode *node;
+	int k;
+
+	for (k = 0; k < path->num; k++) {
+		node = nodes + path->first + k;
+		if (node->curve) {
+			out = flat_curve(last, node, out);
+			last = node->pts + 4;
+		} else {
+			*out++ = node->pts[0];
+			*out++ = node->pts[1];
+			last = node->pts;
+		}
+	}
+	if (path->closed && path->num && (last[0] != path->start[0] ||
+			last[1] != path->start[1])) {
+		*out++ = path->start[0];
+		*out++ = path->start[1];
+	}
+	return out;
+}
+
+static void
+transform_points(double *pts, int num, double *trafo) {
+
+	double x, y;
+	int i;
+
+	for (i = 0; i < num; i++) {
+		x = pts[2 * i];
+		y = pts[2 * i + 1];
+		pts[2 * i] = trafo[0] * x + trafo[2] * y + trafo[4];
+		pts[2 * i + 1] = trafo[1] * x + trafo[3] * y + trafo[5];
+	}
+}
+
+/* Parses list of sk2 paths into path and node arrays.
+ * Returns 0 with exception set on error.
+ */
+static int
+parse_sk2_paths(PyObject *seq, PathData **paths_out, PathNode **nodes_out,
+		int *size_out) {
+
+	PyObject *fast, *path, *points, *item;
+	PathData *paths = NULL;
+	PathNode *nodes = NULL;
+	int size, num = 0, i, j, ok = 1;
+
+	fast = PySequence_Fast(seq, "path list expected");
+	if (fast == NULL) {
+		return 0;
+	}
+	size = (int) PySequence_Fast_GET_SIZE(fast);
+
+	for (i = 0; i < size; i++) {
+		item = PySequence_Fast_GET_ITEM(fast, i);
+		points = PySequence_Check(item) ? PySequence_GetItem(item, 1) : NULL;
+		if (points == NULL || !PySequence_Check(points)) {
+			Py_XDECREF(points);
+			ok = 0;
+			break;
+		}
+		num += (int) PySequence_Size(points);
+		Py_DECREF(points);
+	}
+	if (ok) {
+		paths = (PathData *) malloc(sizeof(PathData) * (size + 1));
+		nodes = (PathNode *) malloc(sizeof(PathNode) * (num + 1));
+		if (paths == NULL || nodes == NULL) {
+			free(paths);
+			free(nodes);
+			Py_DECREF(fast);
+			PyErr_NoMemory();
+			return 0;
+		}
+	}
+
+	num = 0;
+	for (i = 0; ok && i < size; i++) {
+		path = PySequence_Fast_GET_ITEM(fast, i);
+		item = PySequence_GetItem(path, 0);
+		ok = item != NULL && parse_point(item, paths[i].start);
+		Py_XDECREF(item);
+		item = PySequence_GetItem(path, 2);
+		paths[i].closed = item != NULL && PyObject_IsTrue(item) > 0;
+		Py_XDECREF(item);
+		item = PySequence_GetItem(path, 1);
+		points = item ? PySequence_Fast(item, "path points expected") : NULL;
+		Py_XDECREF(item);
+		if (!ok || points == NULL) {
+			ok = 0;
+			Py_XDECREF(points);
+			break;
+		}
+		paths[i].first = num;
+		paths[i].num = (int) PySequence_Fast_GET_SIZE(points);
+		paths[i].size = 0;
+		for (j = 0; ok && j < paths[i].num; j++) {
+			ok = parse_node(PySequence_Fast_GET_ITEM(points, j), nodes + num);
+			nodes[num].steps = 1;
+			num++;
+		}
+		Py_DECREF(points);
+	}
+	Py_DECREF(fast);
+
+	if (!ok) {
+		free(paths);
+		free(nodes);
+		if (!PyErr_Occurred() || !PyErr_ExceptionMatches(PyExc_MemoryError)) {
+			PyErr_Clear();
+			PyErr_SetString(PyExc_TypeError, "list of sk2 paths expected");
+		}
+		return 0;
+	}
+	*paths_out = paths;
+	*nodes_out = nodes;
+	*size_out = size;
+	return 1;
+}
+
+/* flat_paths(paths, tolerance, m11, m21, m12, m22, dx, dy)
+ * Returns list of flattened sk2 paths. Trafo is applied to control
+ * points before flattening (affine transform keeps beziers), so
+ * tolerance is max distance between curve and its polyline
+ * in output units whatever path scaling is.
+ */
+static PyObject *
+cairo_FlatPaths (PyObject *self, PyObject *args) {
+
+	PyObject *seq, *ret, *pd_path, *pd_points;
+	PathData *paths = NULL;
+	PathNode *nodes = NULL, *node;
+	double tolerance, trafo[6], *buff = NULL, *out, *last;
+	int size = 0, total = 0, i, j, k;
+
+	if (!PyArg_ParseTuple(args, "Oddddddd", &seq, &tolerance,
+			&trafo[0], &trafo[1], &trafo[2], &trafo[3], &trafo[4], &trafo[5])) {
+		return NULL;
+	}
+	if (!(tolerance > 0.0)) {
+		PyErr_SetString(PyExc_ValueError, "tolerance should be positive");
+		return NULL;
+	}
+	if (!parse_sk2_paths(seq, &paths, &nodes, &size)) {
+		return NULL;
+	}
+
+	for (i = 0; i < size; i++) {
+		transform_points(paths[i].start, 1, trafo);
+		last = paths[i].start;
+		paths[i].size = 1;
+		for (j = 0; j < paths[i].num; j++) {
+			node = nodes + paths[i].first + j;
+			transform_points(node->pts, node->curve ? 3 : 1, trafo);
+			if (node->curve) {
+				node->steps = get_flat_steps(last, node->pts, tolerance);
+				last = node->pts + 4;
+			} else {
+				last = node->pts;
+			}
+			paths[i].size += node->steps;
+		}
+		total += paths[i].size;
+	}
+
+	buff = (double *) malloc(sizeof(double) * 2 * (total + size + 1));
+	if (buff == NULL) {
+		free(paths);
+		free(nodes);
+		return PyErr_NoMemory();
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	out = buff;
+	for (i = 0; i < size; i++) {
+		last = out;
+		out = flat_path_data(paths + i, nodes, out);
+		/* closing point may be skipped */
+		paths[i].size = (int) (out - last) / 2;
+	}
+	Py_END_ALLOW_THREADS
+
+	ret = PyList_New(size);
+	k = 0;
+	for (i = 0; i < size; i++) {
+		pd_points = PyList_New(paths[i].size);
+		for (j = 0; j < paths[i].size; j++, k++) {
+			PyList_SET_ITEM(pd_points, j, Py_BuildValue("[dd]",
+					buff[2 * k], buff[2 * k + 1]));
+		}
+		pd_path = Py_BuildValue("[[dd]Ni]", paths[i].start[0],
+				paths[i].start[1], pd_points, paths[i].closed);
+		PyList_SET_ITEM(ret, i, pd_path);
+	}
+	free(paths);
+	free(nodes);
+	free(buff);
+	return ret;
+}
+
+/* Stroke outlining. This is a port of libgeom.contour module:
+ * every path segment is offset by bezier segments which are checked
+ * for parallelism and subdivided if needed, neighbour segments are
+ * joined by intersection or join segment, open paths get caps.
+ * Outline segments are point lists: [start, end] for lines and
+ * [start, ctrl1, ctrl2, point, ... , ctrl1, ctrl2, end] for curves.
+ */
+
+#define SK2_JOIN_MITER 0
+#define SK2_JOIN_ROUND 1
+#define SK2_JOIN_BEVEL 2
+#define SK2_CAP_BUTT 1
+#define SK2_CAP_ROUND 2
+#define SK2_CAP_SQUARE 3
+
+#define CIRCLE_CONSTANT (4.0 / 3.0 * (sqrt(2.0) - 1.0))
+#define PARALLEL_RECURSION_LIMIT 6
+#define APPROX_THRESHOLD 1.0
+#define APPROX_PARTIAL 10
+
+typedef struct {
+	double *pts;
+	int n;
+	int cap;
+} OutlineSeg;
+
+typedef struct {
+	OutlineSeg *items;
+	int n;
+	int cap;
+} OutlineSegs;
+
+typedef struct {
+	int lines;
+	double cp[2];
+	int curve1;
+	double end1[6];
+	int curve2;
+	double start2[2];
+	double rest2[6];
+} SegCross;
+
+typedef struct {
+	OutlineSegs fw;
+	OutlineSegs bw;
+	int closed;
+} Outline;
+
+static int
+seg_push(OutlineSeg *seg, double x, double y) {
+	double *tmp;
+	if (seg->n == seg->cap) {
+		seg->cap = seg->cap ? seg->cap * 2 : 8;
+		tmp = (double *) realloc(seg->pts, sizeof(double) * 2 * seg->cap);
+		if (tmp == NULL) {
+			return 0;
+		}
+		seg->pts = tmp;
+	}
+	seg->pts[2 * seg->n] = x;
+	seg->pts[2 * seg->n + 1] = y;
+	seg->n++;
+	return 1;
+}
+
+static int
+seg_push_pts(OutlineSeg *seg, double *pts, int num) {
+	int i;
+	for (i = 0; i < num; i++) {
+		if (!seg_push(seg, pts[2 * i], pts[2 * i + 1])) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static double *
+seg_point(OutlineSeg *seg, int index) {
+	return seg->pts + 2 * (index < 0 ? seg->n + index : index);
+}
+
+static void
+set_point(double *dst, double *src) {
+	dst[0] = src[0];
+	dst[1] = src[1];
+}
+
+static int
+segs_insert(OutlineSegs *segs, int index, OutlineSeg *seg) {
+	OutlineSeg *tmp;
+	if (segs->n == segs->cap) {
+		segs->cap = segs->cap ? segs->cap * 2 : 8;
+		tmp = (OutlineSeg *) realloc(segs->items,
+				sizeof(OutlineSeg) * segs->cap);
+		if (tmp == NULL) {
+			return 0;
+		}
+		segs->items = tmp;
+	}
+	memmove(segs->items + index + 1, segs->items + index,
+			sizeof(OutlineSeg) * (segs->n - index));
+	segs->items[index] = *seg;
+	segs->n++;
+	return 1;
+}
+
+static void
+segs_free(OutlineSegs *segs) {
+	int i;
+	for (i = 0; i < segs->n; i++) {
+		free(segs->items[i].pts);
+	}
+	free(segs->items);
+	segs->items = NULL;
+	segs->n = segs->cap = 0;
+}
+
+static double
+vec_length(double x, double y) {
+	return sqrt(x * x + y * y);
+}
+
+static void
+normalize_vec(double *v, double *out) {
+	double k = vec_length(v[0], v[1]);
+	if (k) {
+		out[0] = v[0] / k;
+		out[1] = v[1] / k;
+	} else {
+		out[0] = out[1] = 0.0;
+	}
+}
+
+/* De Casteljau subdivision, fills 7 points as contour.subdivide_seg() */
+static void
+subdivide_bezier(double *p, double t, double *out) {
+	double t2 = 1.0 - t;
+	int i;
+	for (i = 0; i < 2; i++) {
+		out[i] = p[i];
+		out[2 + i] = p[i] * t2 + p[2 + i] * t;
+		out[8 + i] = p[2 + i] * t2 + p[4 + i] * t;
+		out[10 + i] = p[4 + i] * t2 + p[6 + i] * t;
+		out[4 + i] = out[2 + i] * t2 + out[8 + i] * t;
+		out[8 + i] = out[8 + i] * t2 + out[10 + i] * t;
+		out[6 + i] = out[4 + i] * t2 + out[8 + i] * t;
+		out[12 + i] = p[6 + i];
+	}
+}
+
+static double
+circle_param(double h) {
+	double t0 = 0.5, dt = 0.25, pt0, p01, p12, p23, p012, p123;
+	while (dt >= 0.0001) {
+		p01 = CIRCLE_CONSTANT * t0;
+		p12 = CIRCLE_CONSTANT * (1 - t0) + t0;
+		p23 = (1 - t0) + t0;
+		p012 = p01 * (1 - t0) + p12 * t0;
+		p123 = p12 * (1 - t0) + p23 * t0;
+		pt0 = p012 * (1 - t0) + p123 * t0;
+		if (pt0 > h) {
+			t0 = t0 - dt;
+		} else if (pt0 < h) {
+			t0 = t0 + dt;
+		} else {
+			break;
+		}
+		dt = dt / 2;
+	}
+	return t0;
+}
+
+static int
+check_parallel(double *source, double *parallel, double radius) {
+	double ts[3] = {0.25, 0.5, 0.75}, s[14], t[14], d[2], n[2], ox, oy;
+	int i;
+	for (i = 0; i < 3; i++) {
+		subdivide_bezier(source, ts[i], s);
+		subdivide_bezier(parallel, ts[i], t);
+		d[0] = s[8] - s[6];
+		d[1] = s[9] - s[7];
+		normalize_vec(d, n);
+		ox = s[6] + n[1] * radius;
+		oy = s[7] - n[0] * radius;
+		if (vec_length(ox - t[6], oy - t[7]) >= 0.01 * radius) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int
+build_parallel(double *p, double radius, int limit, OutlineSeg *out) {
+
+	double c1[2], c2[2], t1[2], t2[2], p0[2], p3[2], sd[14];
+	double center[2], cc[2], d[2], seg[8], now[14], offset[2];
+	double det, ndet, oc1[2], oc2[2], proposed[8];
+	OutlineSeg first = {NULL, 0, 0}, second = {NULL, 0, 0};
+	int i, ok;
+
+	c1[0] = p[2] - p[0];
+	c1[1] = p[3] - p[1];
+	if (c1[0] == 0.0 && c1[1] == 0.0) {
+		return 1;
+	}
+	normalize_vec(c1, t1);
+	p0[0] = p[0] + t1[1] * radius;
+	p0[1] = p[1] - t1[0] * radius;
+
+	for (i = 2; i >= 0; i--) {
+		c2[0] = p[6] - p[2 * i];
+		c2[1] = p[7] - p[2 * i + 1];
+		if (c2[0] != 0.0 || c2[1] != 0.0) {
+			break;
+		}
+	}
+	normalize_vec(c2, t2);
+	p3[0] = p[6] + t2[1] * radius;
+	p3[1] = p[7] - t2[0] * radius;
+	c2[0] = p[6] - p[4];
+	c2[1] = p[7] - p[5];
+
+	subdivide_bezier(p, 0.5, sd);
+	d[0] = sd[8] - sd[6];
+	d[1] = sd[9] - sd[7];
+	normalize_vec(d, cc);
+	center[0] = sd[6] + cc[1] * radius;
+	center[1] = sd[7] - cc[0] * radius;
+
+	seg[0] = p0[0];
+	seg[1] = p0[1];
+	seg[2] = p0[0] + c1[0];
+	seg[3] = p0[1] + c1[1];
+	seg[4] = p3[0] - c2[0];
+	seg[5] = p3[1] - c2[1];
+	seg[6] = p3[0];
+	seg[7] = p3[1];
+	subdivide_bezier(seg, 0.5, now);
+	offset[0] = (center[0] - now[6]) * (8.0 / 3);
+	offset[1] = (center[1] - now[7]) * (8.0 / 3);
+
+	det = c1[0] * c2[1] - c1[1] * c2[0];
+	ndet = det ? det / vec_length(c1[0], c1[1]) /
+			vec_length(c2[0], c2[1]) : 0.0;
+	if (fabs(ndet) >= 0.1) {
+		for (i = 0; i < 2; i++) {
+			oc1[i] = c1[i] * ((offset[0] * c2[1] - offset[1] * c2[0]) / det);
+			oc2[i] = c2[i] * ((c1[0] * offset[1] - c1[1] * offset[0]) / det);
+		}
+	} else {
+		oc1[0] = oc1[1] = oc2[0] = oc2[1] = 0.0;
+	}
+
+	proposed[0] = p0[0];
+	proposed[1] = p0[1];
+	proposed[2] = p0[0] + c1[0] + oc1[0];
+	proposed[3] = p0[1] + c1[1] + oc1[1];
+	proposed[4] = p3[0] - c2[0] + oc2[0];
+	proposed[5] = p3[1] - c2[1] + oc2[1];
+	proposed[6] = p3[0];
+	proposed[7] = p3[1];
+
+	if (limit <= 0 || check_parallel(p, proposed, radius)) {
+		return seg_push_pts(out, proposed, 4);
+	}
+	/* not parallel enough - subdivide */
+	ok = build_parallel(sd, radius, limit - 1, &first) &&
+			build_parallel(sd + 6, radius, limit - 1, &second);
+	if (ok) {
+		ok = seg_push_pts(out, first.pts, first.n);
+		if (ok && second.n > 1) {
+			ok = seg_push_pts(out, second.pts + 2, second.n - 1);
+		}
+	}
+	free(first.pts);
+	free(second.pts);
+	return ok;
+}
+
+static int
+line_to_curve(OutlineSeg *seg, double *p0, double *p1) {
+	return seg_push(seg, 1.0 / 3.0 * (p1[0] - p0[0]) + p0[0],
+			1.0 / 3.0 * (p1[1] - p0[1]) + p0[1]) &&
+			seg_push(seg, 2.0 / 3.0 * (p1[0] - p0[0]) + p0[0],
+			2.0 / 3.0 * (p1[1] - p0[1]) + p0[1]) &&
+			seg_push(seg, p1[0], p1[1]);
+}
+
+static int
+get_join_segment(double *start, double *end, double radius,
+		int jointype, double miter_limit, OutlineSeg *seg) {
+
+	double d[2], o[2], n[2], h, h2, len, edge[2], center[2], quad[8], sub[14];
+	double f = CIRCLE_CONSTANT, t0;
+
+	d[0] = (end[0] - start[0]) * 0.5;
+	d[1] = (end[1] - start[1]) * 0.5;
+	if (jointype == SK2_JOIN_BEVEL) {
+		return seg_push_pts(seg, start, 1) && seg_push_pts(seg, end, 1);
+	}
+	if (d[0] == 0.0 && d[1] == 0.0) {
+		return 1;
+	}
+	len = vec_length(d[0], d[1]);
+	if (radius < len) {
+		return seg_push_pts(seg, start, 1) && seg_push_pts(seg, end, 1);
+	}
+	n[0] = d[1];
+	n[1] = -d[0];
+	normalize_vec(n, o);
+
+	if (jointype == SK2_JOIN_MITER) {
+		h = sqrt(radius * radius - len * len);
+		h2 = len * len / h;
+		if (h2 + h > miter_limit * radius) {
+			return seg_push_pts(seg, start, 1) && seg_push_pts(seg, end, 1);
+		}
+		edge[0] = start[0] + d[0] + o[0] * h2;
+		edge[1] = start[1] + d[1] + o[1] * h2;
+		return seg_push_pts(seg, start, 1) &&
+				line_to_curve(seg, start, edge) &&
+				line_to_curve(seg, edge, end);
+	}
+
+	/* round join */
+	o[0] *= radius;
+	o[1] *= radius;
+	h = sqrt(radius * radius - len * len) / radius;
+	center[0] = start[0] + d[0] - o[0] * h;
+	center[1] = start[1] + d[1] - o[1] * h;
+	normalize_vec(d, n);
+	d[0] = n[0] * radius;
+	d[1] = n[1] * radius;
+	t0 = circle_param(h);
+
+	quad[0] = center[0] - d[0];
+	quad[1] = center[1] - d[1];
+	quad[2] = quad[0] + o[0] * f;
+	quad[3] = quad[1] + o[1] * f;
+	quad[4] = center[0] - d[0] * f + o[0];
+	quad[5] = center[1] - d[1] * f + o[1];
+	quad[6] = center[0] + o[0];
+	quad[7] = center[1] + o[1];
+	subdivide_bezier(quad, t0, sub);
+	if (!seg_push_pts(seg, start, 1) || !seg_push_pts(seg, sub + 8, 3)) {
+		return 0;
+	}
+
+	quad[0] = center[0] + o[0];
+	quad[1] = center[1] + o[1];
+	quad[2] = quad[0] + d[0] * f;
+	quad[3] = quad[1] + d[1] * f;
+	quad[4] = center[0] + d[0] + o[0] * f;
+	quad[5] = center[1] + d[1] + o[1] * f;
+	quad[6] = center[0] + d[0];
+	quad[7] = center[1] + d[1];
+	subdivide_bezier(quad, 1 - t0, sub);
+	return seg_push_pts(seg, sub + 2, 2) && seg_push_pts(seg, end, 1);
+}
+
+static int
+get_cap_segment(double *start, double *end, int captype, OutlineSeg *seg) {
+
+	double f = CIRCLE_CONSTANT, d[2], o[2], p1[2], p2[2], pts[20];
+	int i;
+
+	d[0] = (end[0] - start[0]) * 0.5;
+	d[1] = (end[1] - start[1]) * 0.5;
+	o[0] = d[1];
+	o[1] = -d[0];
+
+	if (captype == SK2_CAP_ROUND) {
+		p1[0] = start[0] + o[0];
+		p1[1] = start[1] + o[1];
+		for (i = 0; i < 2; i++) {
+			p2[i] = o[i] * f;
+			pts[i] = start[i];
+			pts[2 + i] = start[i] + p2[i];
+			pts[4 + i] = p1[i] + d[i] * (1 - f);
+			pts[6 + i] = p1[i] + d[i];
+			pts[8 + i] = p1[i] + d[i] * (1 + f);
+			pts[10 + i] = end[i] + p2[i];
+			pts[12 + i] = end[i];
+		}
+		return seg_push_pts(seg, pts, 7);
+	} else if (captype == SK2_CAP_SQUARE) {
+		for (i = 0; i < 2; i++) {
+			p1[i] = start[i] + o[i];
+			p2[i] = end[i] + o[i];
+			pts[i] = pts[2 + i] = start[i];
+			pts[4 + i] = pts[6 + i] = pts[8 + i] = p1[i];
+			pts[10 + i] = pts[12 + i] = pts[14 + i] = p2[i];
+			pts[16 + i] = pts[18 + i] = end[i];
+		}
+		return seg_push_pts(seg, pts, 10);
+	}
+	return seg_push_pts(seg, start, 1) && seg_push_pts(seg, end, 1);
+}
+
+/* Approximates bezier segment as shaping.subdivide_curve() does */
+static int
+approx_curve(OutlineSeg *out, double *p0, double *p1, double *p2, double *p3,
+		double r0, double r1) {
+
+	double p10[2], p11[2], p12[2], p20[2], p21[2], p30[2], t;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		p10[i] = p0[i] + 0.5 * (p1[i] - p0[i]);
+		p11[i] = p1[i] + 0.5 * (p2[i] - p1[i]);
+		p12[i] = p2[i] + 0.5 * (p3[i] - p2[i]);
+		p20[i] = p10[i] + 0.5 * (p11[i] - p10[i]);
+		p21[i] = p11[i] + 0.5 * (p12[i] - p11[i]);
+		p30[i] = p20[i] + 0.5 * (p21[i] - p20[i]);
+	}
+	t = r0 + 0.5 * (r1 - r0);
+	if (hypot(p0[0] - p30[0], p0[1] - p30[1]) > APPROX_THRESHOLD &&
+			!approx_curve(out, p0, p10, p20, p30, r0, t)) {
+		return 0;
+	}
+	if (!seg_push(out, p30[0], p30[1]) || !seg_push(out, t, 0.0)) {
+		return 0;
+	}
+	if (hypot(p30[0] - p3[0], p30[1] - p3[1]) > APPROX_THRESHOLD &&
+			!approx_curve(out, p30, p21, p12, p3, t, r1)) {
+		return 0;
+	}
+	return 1;
+}
+
+/* Approximation items are stored as (x, y, t, 0) quads */
+static int
+approx_segment(double *start, int curve, double *pts, OutlineSeg *out) {
+	double *end = curve ? pts + 4 : pts;
+	if (!seg_push(out, start[0], start[1]) || !seg_push(out, 0.0, 0.0)) {
+		return 0;
+	}
+	if (curve && !approx_curve(out, start, pts, pts + 2, pts + 4, 0.0, 1.0)) {
+		return 0;
+	}
+	return seg_push(out, end[0], end[1]) && seg_push(out, 1.0, 0.0);
+}
+
+static void
+approx_rect(double *pts, int from, int to, double *rect) {
+	int i;
+	rect[0] = rect[2] = pts[4 * from];
+	rect[1] = rect[3] = pts[4 * from + 1];
+	for (i = from + 1; i < to; i++) {
+		rect[0] = fmin(rect[0], pts[4 * i]);
+		rect[1] = fmin(rect[1], pts[4 * i + 1]);
+		rect[2] = fmax(rect[2], pts[4 * i]);
+		rect[3] = fmax(rect[3], pts[4 * i + 1]);
+	}
+}
+
+static double
+approx_index(double *cp, double *a, double *b) {
+	double k;
+	if (b[0] - a[0] == 0) {
+		k = b[1] - a[1] ? (cp[1] - a[1]) / (b[1] - a[1]) : 0.0;
+	} else {
+		k = (cp[0] - a[0]) / (b[0] - a[0]);
+	}
+	return a[2] + k * (b[2] - a[2]);
+}
+
+/* First crossing of two approximated segments in order of
+ * shaping.intersect_approx_paths() loops over 10 segment partials. */
+static int
+first_cross(OutlineSeg *ap1, OutlineSeg *ap2, double *at1, double *at2) {
+
+	int n1 = ap1->n / 2, n2 = ap2->n / 2, a, b, p, q, end1, end2;
+	double rect1[4], rect2[4], *pts1 = ap1->pts, *pts2 = ap2->pts;
+	double *p0, *p1, *p2, *p3, xy[2];
+
+	for (a = 0; a < n1; a += APPROX_PARTIAL) {
+		end1 = a + APPROX_PARTIAL + 1 < n1 ? a + APPROX_PARTIAL + 1 : n1;
+		approx_rect(pts1, a, end1, rect1);
+		for (b = 0; b < n2; b += APPROX_PARTIAL) {
+			end2 = b + APPROX_PARTIAL + 1 < n2 ? b + APPROX_PARTIAL + 1 : n2;
+			approx_rect(pts2, b, end2, rect2);
+			if (!rects_overlap(rect1, rect2)) {
+				continue;
+			}
+			for (p = a + 1; p < end1; p++) {
+				p0 = pts1 + 4 * (p - 1);
+				p1 = pts1 + 4 * p;
+				for (q = b + 1; q < end2; q++) {
+					p2 = pts2 + 4 * (q - 1);
+					p3 = pts2 + 4 * q;
+					if (equal_points(p0, p2)) {
+						xy[0] = p0[0];
+						xy[1] = p0[1];
+					} else if (equal_points(p0, p3) || equal_points(p1, p2) ||
+							equal_points(p1, p3)) {
+						continue;
+					} else if (!intersect_lines(p0, p1, p2, p3, xy)) {
+						continue;
+					}
+					*at1 = approx_index(xy, p0, p1);
+					*at2 = approx_index(xy, p2, p3);
+					return 1;
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* Splits segment node as PathObject.split_seg() does */
+static void
+split_node(double *base, int curve, double *pts, double t,
+		double *first, double *second) {
+
+	double t2 = 1.0 - t, r[2], q1[2], q2[2], q3[2], q4[2], q5[2];
+	int i;
+
+	if (!curve) {
+		first[0] = base[0] * t2 + pts[0] * t;
+		first[1] = base[1] * t2 + pts[1] * t;
+		set_point(second, pts);
+		return;
+	}
+	for (i = 0; i < 2; i++) {
+		r[i] = pts[i] * t2 + pts[2 + i] * t;
+		q1[i] = base[i] * t2 + pts[i] * t;
+		q2[i] = q1[i] * t2 + r[i] * t;
+		q5[i] = pts[2 + i] * t2 + pts[4 + i] * t;
+		q4[i] = r[i] * t2 + q5[i] * t;
+		q3[i] = q2[i] * t2 + q4[i] * t;
+	}
+	set_point(first, q1);
+	set_point(first + 2, q2);
+	set_point(first + 4, q3);
+	set_point(second, q4);
+	set_point(second + 2, q5);
+	set_point(second + 4, pts + 4);
+}
+
+/* Port of contour.intersect_segs(): lines are intersected directly,
+ * curves through approximation as shaping.intersect_segments() does.
+ */
+static int
+intersect_outline_segs(OutlineSeg *seg1, OutlineSeg *seg2, SegCross *cross,
+		int *error) {
+
+	OutlineSeg ap1 = {NULL, 0, 0}, ap2 = {NULL, 0, 0};
+	double *start1, *start2, *pts1, *pts2, at1, at2, tmp[6];
+	int found;
+
+	cross->curve1 = seg1->n != 2;
+	cross->curve2 = seg2->n != 2;
+	cross->lines = !cross->curve1 && !cross->curve2;
+	if (cross->lines) {
+		return intersect_lines(seg1->pts, seg_point(seg1, -1), seg2->pts,
+				seg_point(seg2, -1), cross->cp);
+	}
+
+	start1 = seg_point(seg1, cross->curve1 ? -4 : 0);
+	pts1 = seg_point(seg1, cross->curve1 ? -3 : -1);
+	start2 = seg2->pts;
+	pts2 = seg_point(seg2, cross->curve2 ? 1 : -1);
+	if (!approx_segment(start1, cross->curve1, pts1, &ap1) ||
+			!approx_segment(start2, cross->curve2, pts2, &ap2)) {
+		free(ap1.pts);
+		free(ap2.pts);
+		*error = 1;
+		return 0;
+	}
+	found = first_cross(&ap1, &ap2, &at1, &at2);
+	free(ap1.pts);
+	free(ap2.pts);
+	if (!found || at1 <= 0.0 || at1 > 1.0 || at2 <= 0.0 || at2 >= 1.0) {
+		return 0;
+	}
+
+	if (at1 == 1.0) {
+		memcpy(cross->end1, pts1, sizeof(double) * (cross->curve1 ? 6 : 2));
+	} else {
+		split_node(start1, cross->curve1, pts1, at1, cross->end1, tmp);
+	}
+	set_point(cross->start2, cross->end1 + (cross->curve1 ? 4 : 0));
+	split_node(start2, cross->curve2, pts2, at2, tmp, cross->rest2);
+	return 1;
+}
+
+/* Port of contour.join_segs() */
+static int
+join_outline_segs(OutlineSegs *segs, double radius, int linejoin,
+		double miter_limit, int close) {
+
+	OutlineSeg joint, *seg1, *seg2;
+	SegCross cross;
+	double *end, *start;
+	int i = close ? -1 : 0, error = 0;
+
+	while (i < segs->n - 1) {
+		seg1 = segs->items + (i < 0 ? segs->n + i : i);
+		seg2 = segs->items + i + 1;
+		end = seg_point(seg1, -1);
+		start = seg2->pts;
+		if (end[0] == start[0] && end[1] == start[1]) {
+			i++;
+			continue;
+		}
+		joint.pts = NULL;
+		joint.n = joint.cap = 0;
+		if (!get_join_segment(end, start, radius, linejoin,
+				miter_limit, &joint)) {
+			free(joint.pts);
+			return 0;
+		}
+		if (intersect_outline_segs(seg1, seg2, &cross, &error)) {
+			free(joint.pts);
+			if (cross.lines) {
+				set_point(end, cross.cp);
+				set_point(start, cross.cp);
+				i++;
+				continue;
+			}
+			if (cross.curve1) {
+				memcpy(seg_point(seg1, -3), cross.end1, sizeof(double) * 6);
+			} else {
+				set_point(end, cross.end1);
+			}
+			set_point(start, cross.start2);
+			if (cross.curve2) {
+				memcpy(seg2->pts + 2, cross.rest2, sizeof(double) * 6);
+			}
+		} else if (error) {
+			free(joint.pts);
+			return 0;
+		} else if (linejoin == SK2_JOIN_MITER && joint.n == 7 &&
+				seg1->n == 2 && seg2->n == 2) {
+			set_point(end, seg_point(&joint, 3));
+			set_point(start, seg_point(&joint, 3));
+			free(joint.pts);
+		} else if (joint.n) {
+			if (!segs_insert(segs, i + 1, &joint)) {
+				free(joint.pts);
+				return 0;
+			}
+			i++;
+		} else {
+			free(joint.pts);
+		}
+		i++;
+	}
+	return 1;
+}
+
+static int
+push_outline_seg(OutlineSegs *segs, OutlineSeg *seg) {
+	if (!seg->n) {
+		/* degenerated curve */
+		free(seg->pts);
+		return 1;
+	}
+	if (!segs_insert(segs, segs->n, seg)) {
+		free(seg->pts);
+		return 0;
+	}
+	return 1;
+}
+
+/* Port of contour.create_stroke_outline() */
+static int
+create_stroke_outline(PathData *path, PathNode *nodes, double radius,
+		int linejoin, int captype, double miter_limit, Outline *outline) {
+
+	OutlineSeg seg, tmp;
+	PathNode *node;
+	double last[2], p[8], c[2], t[2], *point;
+	int i, ok = 1;
+
+	set_point(last, path->start);
+	for (i = 0; ok && i < path->num; i++) {
+		node = nodes + path->first + i;
+		point = node->curve ? node->pts + 4 : node->pts;
+		seg.pts = NULL;
+		seg.n = seg.cap = 0;
+		if (!node->curve) {
+			c[0] = point[0] - last[0];
+			c[1] = point[1] - last[1];
+			normalize_vec(c, t);
+			t[0] *= radius;
+			t[1] *= radius;
+			ok = seg_push(&seg, last[0] + t[1], last[1] - t[0]) &&
+					seg_push(&seg, point[0] + t[1], point[1] - t[0]) &&
+					push_outline_seg(&outline->fw, &seg);
+			seg.pts = NULL;
+			seg.n = seg.cap = 0;
+			ok = ok && seg_push(&seg, point[0] - t[1], point[1] + t[0]) &&
+					seg_push(&seg, last[0] - t[1], last[1] + t[0]) &&
+					push_outline_seg(&outline->bw, &seg);
+		} else {
+			/* null size control points are moved along the chord */
+			set_point(p, last);
+			set_point(p + 2, node->pts);
+			set_point(p + 4, node->pts + 2);
+			set_point(p + 6, point);
+			if (!vec_length(last[0] - p[2], last[1] - p[3])) {
+				p[2] = (point[0] - last[0]) * 0.0001 + last[0];
+				p[3] = (point[1] - last[1]) * 0.0001 + last[1];
+			}
+			if (!vec_length(point[0] - p[4], point[1] - p[5])) {
+				p[4] = (point[0] - last[0]) * 0.9999 + last[0];
+				p[5] = (point[1] - last[1]) * 0.9999 + last[1];
+			}
+			ok = build_parallel(p, radius, PARALLEL_RECURSION_LIMIT, &seg) &&
+					push_outline_seg(&outline->fw, &seg);
+			seg.pts = NULL;
+			seg.n = seg.cap = 0;
+			set_point(c, p + 2);
+			set_point(p + 2, p + 4);
+			set_point(p + 4, c);
+			set_point(c, p);
+			set_point(p, p + 6);
+			set_point(p + 6, c);
+			ok = ok && build_parallel(p, radius, PARALLEL_RECURSION_LIMIT,
+					&seg) && push_outline_seg(&outline->bw, &seg);
+		}
+		if (!ok) {
+			free(seg.pts);
+		}
+		set_point(last, point);
+	}
+	if (!ok) {
+		return 0;
+	}
+
+	/* backward segments are collected in reversed order */
+	for (i = 0; i < outline->bw.n / 2; i++) {
+		tmp = outline->bw.items[i];
+		outline->bw.items[i] = outline->bw.items[outline->bw.n - 1 - i];
+		outline->bw.items[outline->bw.n - 1 - i] = tmp;
+	}
+
+	outline->closed = path->closed;
+	if (!outline->fw.n || !outline->bw.n) {
+		return 1;
+	}
+	if (!join_outline_segs(&outline->fw, radius, linejoin, miter_limit,
+			path->closed) ||
+			!join_outline_segs(&outline->bw, radius, linejoin, miter_limit,
+			path->closed)) {
+		return 0;
+	}
+
+	/* caps for unclosed paths */
+	if (!path->closed) {
+		seg.pts = NULL;
+		seg.n = seg.cap = 0;
+		ok = get_cap_segment(seg_point(outline->bw.items + outline->bw.n - 1,
+				-1), outline->fw.items[0].pts, captype, &seg) &&
+				segs_insert(&outline->fw, 0, &seg);
+		if (!ok) {
+			free(seg.pts);
+			return 0;
+		}
+		seg.pts = NULL;
+		seg.n = seg.cap = 0;
+		ok = get_cap_segment(seg_point(outline->fw.items + outline->fw.n - 1,
+				-1), outline->bw.items[0].pts, captype, &seg) &&
+				segs_insert(&outline->bw, 0, &seg);
+		if (!ok) {
+			free(seg.pts);
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* Port of contour.make_path(), builds closed sk2 path */
+static PyObject *
+make_outline_path(OutlineSegs **parts, int num) {
+
+	PyObject *points, *path;
+	OutlineSeg *seg;
+	double *first = NULL, *last = NULL, *tail = NULL, *pts;
+	int i, j, k;
+
+	points = PyList_New(0);
+	for (i = 0; i < num; i++) {
+		for (j = 0; j < parts[i]->n; j++) {
+			seg = parts[i]->items + j;
+			pts = seg->pts;
+			if (first == NULL) {
+				first = last = pts;
+			}
+			if (pts[0] != last[0] || pts[1] != last[1]) {
+				list_append_new(points, Py_BuildValue("[dd]", pts[0], pts[1]));
+				tail = pts;
+			}
+			if (seg->n == 2) {
+				list_append_new(points, Py_BuildValue("[dd]",
+						pts[2], pts[3]));
+				last = tail = pts + 2;
+			}
+			for (k = 0; seg->n - k >= 4; k += 3) {
+				list_append_new(points, Py_BuildValue("[[dd][dd][dd]i]",
+						pts[2 * k + 2], pts[2 * k + 3], pts[2 * k + 4],
+						pts[2 * k + 5], pts[2 * k + 6], pts[2 * k + 7], 0));
+				last = tail = pts + 2 * k + 6;
+			}
+		}
+	}
+	if (tail == NULL || tail[0] != first[0] || tail[1] != first[1]) {
+		list_append_new(points, Py_BuildValue("[dd]", first[0], first[1]));
+	}
+	path = Py_BuildValue("[[dd]Ni]", first[0], first[1], points, 1);
+	return path;
+}
+
+/* stroke_paths(paths, radius, linejoin, captype, miter_limit)
+ * Outlines every sk2 path as contour.create_stroke_outline() does.
+ * Returns list of outline lists: two closed paths for each closed
+ * source path and a single path for opened one.
+ */
+static PyObject *
+cairo_StrokePaths (PyObject *self, PyObject *args) {
+
+	PyObject *seq, *ret, *item;
+	PathData *paths = NULL;
+	PathNode *nodes = NULL;
+	Outline *outlines;
+	OutlineSegs *parts[2];
+	double radius, miter_limit;
+	int size = 0, linejoin, captype, i, ok = 1;
+
+	if (!PyArg_ParseTuple(args, "Odiid", &seq, &radius, &linejoin,
+			&captype, &miter_limit)) {
+		return NULL;
+	}
+	if (linejoin < SK2_JOIN_MITER || linejoin > SK2_JOIN_BEVEL) {
+		PyErr_Format(PyExc_ValueError, "Unknown join type %d", linejoin);
+		return NULL;
+	}
+	if (captype < SK2_CAP_BUTT || captype > SK2_CAP_SQUARE) {
+		PyErr_Format(PyExc_ValueError, "Unknown captype %d", captype);
+		return NULL;
+	}
+	if (!parse_sk2_paths(seq, &paths, &nodes, &size)) {
+		return NULL;
+	}
+	outlines = (Outline *) calloc(size + 1, sizeof(Outline));
+	if (outlines == NULL) {
+		free(paths);
+		free(nodes);
+		return PyErr_NoMemory();
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	for (i = 0; ok && i < size; i++) {
+		ok = create_stroke_outline(paths + i, nodes, radius, linejoin,
+				captype, miter_limit, outlines + i);
+	}
+	Py_END_ALLOW_THREADS
+
+	ret = ok ? PyList_New(size) : NULL;
+	for (i = 0; i < size; i++) {
+		if (ret != NULL) {
+			item = PyList_New(0);
+			if (outlines[i].fw.n && outlines[i].closed) {
+				parts[0] = &outlines[i].fw;
+				list_append_new(item, make_outline_path(parts, 1));
+				parts[0] = &outlines[i].bw;
+				list_append_new(item, make_outline_path(parts, 1));
+			} else if (outlines[i].fw.n) {
+				parts[0] = &outlines[i].fw;
+				parts[1] = &outlines[i].bw;
+				list_append_new(item, make_outline_path(parts, 2));
+			}
+			PyList_SET_ITEM(ret, i, item);
+		}
+		segs_free(&outlines[i].fw);
+		segs_free(&outlines[i].bw);
+	}
+	free(outlines);
+	free(paths);
+	free(nodes);
+	if (!ok) {
+		return PyErr_NoMemory();
+	}
+	return ret;
+}
+
 static
 PyMethodDef cairo_methods[] = {
 	{"get_path_from_cpath", cairo_GetPDPathFromPath, METH_VARARGS},
+	{"get_packed_path_from_cpath", cairo_GetPackedPathFromPath, METH_VARARGS},
 	{"draw_rect", cairo_DrawRectangle, METH_VARARGS},
 	{"get_trafo", cairo_ConvertMatrixToTrafo, METH_VARARGS},
 	{"apply_trafo", cairo_ApplyTrafoToPath, METH_VARARGS},
+	{"apply_trafo_to_paths", cairo_ApplyTrafoToPaths, METH_VARARGS},
+	{"get_path_bbox", cairo_GetPathBbox, METH_VARARGS},
+	{"get_paths_bbox", cairo_GetPathsBbox, METH_VARARGS},
+	{"create_cpath_from_packed", cairo_CreatePathFromPacked, METH_VARARGS},
+	{"apply_trafo_to_packed", cairo_ApplyTrafoToPacked, METH_VARARGS},
+	{"get_packed_bbox", cairo_GetPackedBbox, METH_VARARGS},
+	{"reverse_packed", cairo_ReversePacked, METH_VARARGS},
 	{"get_pixel", cairo_GetSurfaceFirstPixel, METH_VARARGS},
 	{"draw_rgb_image", cairo_DrawRGBImage, METH_VARARGS},
 	{"draw_rgba_image", cairo_DrawRGBAImage, METH_VARARGS},
+	{"get_png_scanlines", cairo_GetPNGScanlines, METH_VARARGS},
+	{"intersect_polylines", cairo_IntersectPolylines, METH_VARARGS},
+	{"create_segment_grid", cairo_CreateSegmentGrid, METH_VARARGS},
+	{"check_points", cairo_CheckPoints, METH_VARARGS},
+	{"flat_paths", cairo_FlatPaths, METH_VARARGS},
+	{"stroke_paths", cairo_StrokePaths, METH_VARARGS},
 	{NULL, NULL}
 };
 
@@ -21,6 +21,7 @@ from contour import stroke_to_curve
 from cwrap import *
 from flattering import get_flattened_paths, flat_paths, flat_path
 from objs import *
+from packed import PackedPaths
 from points import *
 from shaping import intersect_paths, fuse_paths, trim_paths, excluse_paths
 from text_on_path import set_text_on_path
@@ -18,7 +18,7 @@
 import math
 from copy import deepcopy
 
-from uc2 import sk2const
+from uc2 import libcairo, sk2const
 from points import distance, mult_point, add_points, sub_points, midpoint
 from bezier_ops import bezier_base_point
 from shaping import fuse_paths, intersect_lines, intersect_segments, dash_path
@@ -478,6 +478,8 @@ def make_path(segments, close=1):
 
 
 # --- MODULE INTERFACE
+# Outlines are built by libcairo.stroke_paths(), which is native port of
+# create_stroke_outline() and make_path() functions above.
 
 def stroke_to_curve(paths, stroke_style):
     if not stroke_style:
@@ -494,18 +496,11 @@ def stroke_to_curve(paths, stroke_style):
             dashes += dash_path(path, width, dash_list)
         paths = dashes
 
-    new_paths = []
-    for path in paths:
-        outlines = []
-        fw, bw = create_stroke_outline(path, width / 2.0,
-                                       joint, caps, miter_limit)
-
-        if path[-1] == sk2const.CURVE_CLOSED:
-            outlines.append(make_path(fw))
-            outlines.append(make_path(bw))
-        else:
-            outlines.append(make_path(fw + bw))
-        new_paths.append(outlines)
+    new_paths = libcairo.stroke_paths(paths, width / 2.0,
+                                      joint, caps, miter_limit)
+    new_paths = [item for item in new_paths if item]
+    if not new_paths:
+        return []
     if len(new_paths) == 1:
         return new_paths[0]
     else:
@@ -17,8 +17,12 @@
 
 from uc2 import libcairo
 
+from packed import PackedPaths
+
 
 def create_cpath(cache_paths):
+    if isinstance(cache_paths, PackedPaths):
+        return cache_paths.create_cpath()
     return libcairo.create_cpath(cache_paths)
 
 
@@ -30,10 +34,18 @@ def get_cpath_bbox(cache_cpath):
     return libcairo.get_cpath_bbox(cache_cpath)
 
 
+def get_cpaths_bbox(cpaths):
+    return libcairo.get_cpaths_bbox(cpaths)
+
+
 def apply_trafo(cache_cpath, trafo, copy=False):
     return libcairo.apply_trafo(cache_cpath, trafo, copy)
 
 
+def apply_trafo_to_cpaths(cpaths, trafo, copy=False):
+    return libcairo.apply_trafo_to_cpaths(cpaths, trafo, copy)
+
+
 def multiply_trafo(trafo1, trafo2):
     return libcairo.multiply_trafo(trafo1, trafo2)
 
@@ -46,8 +58,12 @@ def get_transformed_path(obj):
     if obj.cache_cpath is None:
         obj.update()
     return None if obj.cache_cpath is None \
-        else libcairo.get_path_from_cpath(obj.cache_cpath)
+        else libcairo.get_packed_path_from_cpath(obj.cache_cpath)
 
 
 def get_path_from_cpath(cpath):
     return libcairo.get_path_from_cpath(cpath)
+
+
+def get_packed_path_from_cpath(cpath):
+    return libcairo.get_packed_path_from_cpath(cpath)
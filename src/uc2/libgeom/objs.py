@@ -280,7 +280,9 @@ def get_text_glyphs(text, width, text_style, markup):
     return libpango.get_text_paths(text, width, text_style, markup)
 
 
-def get_paths_from_glyph(glyph):
-    ret = [item for item in libcairo.get_path_from_cpath(glyph)
-           if item and item[1]]
+def get_paths_from_glyph(glyph, readonly=False):
+    paths = libcairo.get_packed_path_from_cpath(glyph)
+    if not readonly:
+        paths = paths.to_paths()
+    ret = [item for item in paths if item[1]]
     return ret if ret else None
@@ -0,0 +1,258 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2018 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+from array import array
+from copy import deepcopy
+
+from uc2 import libcairo, sk2const
+
+"""
+Packed paths representation.
+
+OPCODES:
+array('B') with one opcode per path command
+PATH_MOVE - starts new path, one point
+PATH_LINE - line point, one point
+PATH_CURVE - curve point, three points; node marker is stored
+             in high nibble of the opcode
+PATH_CLOSE - marks current path as closed, no points
+
+COORDINATES:
+array('d') of x,y pairs in order of opcodes
+
+Packed paths are accepted by create_cpath(), apply_trafo_to_paths(),
+get_paths_bbox() and reverse_paths() which process them natively
+without unpacking into nested lists.
+
+Paths got by indexing or iteration are read-only lists, so in-place
+edits fail instead of being silently lost. Copies of them and
+to_paths() result are regular editable lists.
+"""
+
+PATH_MOVE = 0
+PATH_LINE = 1
+PATH_CURVE = 2
+PATH_CLOSE = 3
+OP_MASK = 0x0f
+
+POINTS_NUM = {PATH_MOVE: 1, PATH_LINE: 1, PATH_CURVE: 3, PATH_CLOSE: 0}
+
+
+class ReadOnlyList(list):
+    """List which cannot be modified in place. Copies are regular lists.
+    """
+
+    def _readonly(self, *args):
+        raise TypeError('packed paths view is read-only, '
+                        'use to_paths() to get editable paths')
+
+    __setitem__ = __delitem__ = __setslice__ = __delslice__ = _readonly
+    __iadd__ = __imul__ = _readonly
+    append = extend = insert = pop = remove = reverse = sort = _readonly
+
+    def __copy__(self):
+        return list(self)
+
+    def __deepcopy__(self, memo):
+        return deepcopy(list(self), memo)
+
+    def __reduce__(self):
+        return list, (list(self),)
+
+
+def _freeze_point(point):
+    if len(point) == 2:
+        return ReadOnlyList(point)
+    return ReadOnlyList([ReadOnlyList(point[0]), ReadOnlyList(point[1]),
+                         ReadOnlyList(point[2]), point[3]])
+
+
+def _freeze_path(path):
+    return ReadOnlyList([ReadOnlyList(path[0]),
+                         ReadOnlyList([_freeze_point(point)
+                                       for point in path[1]]),
+                         path[2]])
+
+
+class PackedPaths(object):
+    """Compact representation of sk2 paths: opcode array plus contiguous
+    float64 coordinates. Behaves as read-only sequence of sk2 paths
+    which are unpacked on demand.
+    """
+    __slots__ = ('ops', 'coords', '_index')
+
+    def __init__(self, ops=None, coords=None):
+        self.ops = array('B') if ops is None else ops
+        self.coords = array('d') if coords is None else coords
+        self._index = None
+
+    @classmethod
+    def from_strings(cls, ops, coords):
+        """Creates packed paths from raw opcode and coordinate strings
+        (native function output).
+        """
+        ops_array = array('B')
+        ops_array.fromstring(ops)
+        coords_array = array('d')
+        coords_array.fromstring(coords)
+        return cls(ops_array, coords_array)
+
+    @classmethod
+    def from_paths(cls, paths):
+        """Packs regular sk2 paths.
+        Raises ValueError for malformed points (e.g. empty control
+        points), which would shift all following coordinates.
+        """
+        ops = array('B')
+        coords = array('d')
+        for path in paths:
+            if len(path[0]) != 2:
+                raise ValueError('Invalid path start point %r' % (path[0],))
+            ops.append(PATH_MOVE)
+            coords.extend(path[0])
+            for point in path[1]:
+                if len(point) == 2 and not isinstance(point[0], list):
+                    ops.append(PATH_LINE)
+                    coords.extend(point)
+                    continue
+                values = point[0] + point[1] + point[2] \
+                    if len(point) in (3, 4) else []
+                if len(values) != 6:
+                    raise ValueError('Invalid curve point %r' % (point,))
+                marker = point[3] if len(point) > 3 else sk2const.NODE_CUSP
+                ops.append(PATH_CURVE | (marker << 4))
+                coords.extend(values)
+            if path[2] == sk2const.CURVE_CLOSED:
+                ops.append(PATH_CLOSE)
+        return cls(ops, coords)
+
+    def _get_index(self):
+        if self._index is None:
+            index = []
+            coord = 0
+            for pos, op in enumerate(self.ops):
+                op &= OP_MASK
+                if op == PATH_MOVE:
+                    index.append((pos, coord))
+                coord += 2 * POINTS_NUM[op]
+            self._index = index
+        return self._index
+
+    def _unpack_path(self, pos, coord):
+        ops = self.ops
+        coords = self.coords
+        start = [coords[coord], coords[coord + 1]]
+        coord += 2
+        points = []
+        closed = sk2const.CURVE_OPENED
+        pos += 1
+        size = len(ops)
+        while pos < size:
+            op = ops[pos]
+            code = op & OP_MASK
+            if code == PATH_MOVE:
+                break
+            elif code == PATH_LINE:
+                points.append([coords[coord], coords[coord + 1]])
+                coord += 2
+            elif code == PATH_CURVE:
+                points.append([[coords[coord], coords[coord + 1]],
+                               [coords[coord + 2], coords[coord + 3]],
+                               [coords[coord + 4], coords[coord + 5]],
+                               op >> 4])
+                coord += 6
+            elif code == PATH_CLOSE:
+                closed = sk2const.CURVE_CLOSED
+            pos += 1
+        return [start, points, closed]
+
+    def __len__(self):
+        return len(self._get_index())
+
+    def __getitem__(self, item):
+        index = self._get_index()
+        if isinstance(item, slice):
+            return [_freeze_path(self._unpack_path(*index[i]))
+                    for i in range(*item.indices(len(index)))]
+        return _freeze_path(self._unpack_path(*index[item]))
+
+    def __iter__(self):
+        for pos, coord in self._get_index():
+            yield _freeze_path(self._unpack_path(pos, coord))
+
+    def __nonzero__(self):
+        return bool(self.ops)
+
+    def __eq__(self, other):
+        if isinstance(other, PackedPaths):
+            return self.ops == other.ops and self.coords == other.coords
+        return self.to_paths() == other
+
+    def __ne__(self, other):
+        return not self.__eq__(other)
+
+    def __add__(self, other):
+        return self.to_paths() + list(other)
+
+    def __radd__(self, other):
+        return list(other) + self.to_paths()
+
+    def __str__(self):
+        # the same representation as regular paths have,
+        # so sk2 documents are saved unchanged
+        return str(self.to_paths())
+
+    __repr__ = __str__
+
+    def __copy__(self):
+        return self.copy()
+
+    def __deepcopy__(self, memo):
+        return self.copy()
+
+    def copy(self):
+        return PackedPaths(self.ops[:], self.coords[:])
+
+    def to_paths(self):
+        """Returns regular sk2 paths (nested lists).
+        """
+        return [self._unpack_path(pos, coord)
+                for pos, coord in self._get_index()]
+
+    def apply_trafo(self, trafo):
+        """Transforms coordinates in place.
+        """
+        libcairo.apply_trafo_to_packed(self.coords, trafo)
+
+    def transformed(self, trafo):
+        paths = self.copy()
+        paths.apply_trafo(trafo)
+        return paths
+
+    def reversed(self):
+        return PackedPaths.from_strings(
+            *libcairo.reverse_packed(self.ops, self.coords))
+
+    def get_bbox(self):
+        return libcairo.get_packed_bbox(self.ops, self.coords)
+
+    def create_cpath(self, cmatrix=None):
+        return libcairo.create_cpath_from_packed(self.ops, self.coords,
+                                                 cmatrix)
+
+    def get_nodes_num(self):
+        return sum(1 for op in self.ops if op & OP_MASK != PATH_CLOSE)
@@ -40,6 +40,9 @@ JOINS = {
 
 PRECISION = 8
 ZOOM = 100.0
+# hit test outline half width and flattening tolerance
+HIT_TOLERANCE = 1.0
+FLAT_TOLERANCE = 0.1 / ZOOM
 
 
 def is_bezier(point):
@@ -63,50 +66,6 @@ def equal_points(p0, p1):
            round(p0[1], PRECISION) == round(p1[1], PRECISION)
 
 
-class ObjHitSurface:
-    surface = None
-    ctx = None
-    canvas = None
-    cpaths = None
-    fill_rule = cairo.FILL_RULE_EVEN_ODD
-
-    def __init__(self, obj):
-        self.obj = obj
-        self.surface = cairo.ImageSurface(cairo.FORMAT_RGB24, 1, 1)
-        self.ctx = cairo.Context(self.surface)
-
-    def destroy(self):
-        for item in self.__dict__.keys():
-            self.__dict__[item] = None
-
-    def clear(self):
-        self.ctx.set_source_rgb(1, 1, 1)
-        self.ctx.paint()
-        self.ctx.set_source_rgb(0, 0, 0)
-
-    def set_fill_rule(self, rule=cairo.FILL_RULE_WINDING):
-        self.fill_rule = rule
-
-    def set_trafo(self, point):
-        trafo = [ZOOM, 0.0, 0.0, ZOOM, -point[0] * ZOOM, -point[1] * ZOOM]
-        self.ctx.set_matrix(libcairo.get_matrix_from_trafo(trafo))
-
-    def check_point(self, point):
-        self.clear()
-        self.set_trafo(point)
-        if self.cpaths is None:
-            self.cpaths = self.obj.get_cpaths()
-        self.ctx.set_fill_rule(self.fill_rule)
-        self.ctx.new_path()
-        self.ctx.append_path(self.cpaths)
-        self.ctx.fill()
-        self.ctx.set_line_width(2.0)
-        self.ctx.new_path()
-        self.ctx.append_path(self.cpaths)
-        self.ctx.stroke()
-        return not libcairo.check_surface_whiteness(self.surface)
-
-
 class StrokeHitSurface:
     surface = None
     ctx = None
@@ -157,7 +116,8 @@ class StrokeHitSurface:
 class CurveObject:
     obj_id = None
     path_objs = None
-    hit_test = None
+    grid = None
+    fill_rule = cairo.FILL_RULE_EVEN_ODD
     stroke_test = None
     stroke_style = None
     bbox = None
@@ -173,8 +133,6 @@ class CurveObject:
             self.path_objs.append(path_obj)
 
     def destroy(self):
-        if self.hit_test:
-            self.hit_test.destroy()
         if self.stroke_test:
             self.stroke_test.destroy()
         for item in self.__dict__.keys():
@@ -200,10 +158,34 @@ class CurveObject:
             paths.append(item.get_path())
         return create_cpath(paths)
 
+    def get_grid(self):
+        if self.grid is None:
+            cpath = libcairo.get_flattened_cpath(self.get_cpaths(),
+                                                 FLAT_TOLERANCE)
+            polylines = []
+            closed = []
+            for path in libcairo.get_packed_path_from_cpath(cpath):
+                polylines.append([path[0], ] + path[1])
+                closed.append(path[2])
+            self.grid = libcairo.create_segment_grid(polylines, closed)
+        return self.grid
+
+    def are_points_inside(self, points):
+        return libcairo.check_points_inside(self.get_grid(), points,
+                                            self.fill_rule, HIT_TOLERANCE)
+
+    def are_points_on_stroke(self, points):
+        # distance to outline matches round caps and joins only
+        stroke = self.stroke_style
+        if stroke[3] or stroke[4] != sk2const.CAP_ROUND or \
+                stroke[5] != sk2const.JOIN_ROUND:
+            return [self.is_point_on_stroke(item) for item in points]
+        tolerance = (self.stroke_style[1] - .04) / 2.0
+        return libcairo.check_points_on_outline(self.get_grid(), points,
+                                                tolerance)
+
     def is_point_inside(self, point):
-        if self.hit_test is None:
-            self.hit_test = ObjHitSurface(self)
-        return self.hit_test.check_point(point)
+        return self.are_points_inside([point, ])[0]
 
     def is_point_on_stroke(self, point):
         if self.stroke_test is None:
@@ -574,39 +556,82 @@ def get_approx_paths(paths):
     return approx_paths
 
 
+def intersect_polylines_py(polylines1, polylines2, skip_same=False):
+    """
+    Reference implementation of libcairo.intersect_polylines().
+    Returns (i, j, p, q, cp) for crossing segments of polylines
+    (lists of (point, t) items) with overlapped bboxes.
+    """
+    result = []
+    rects2 = [coord_rect(item) for item in polylines2]
+    for i in range(len(polylines1)):
+        approx_path1 = polylines1[i]
+        rect1 = coord_rect(approx_path1)
+        for j in range(len(polylines2)):
+            if skip_same and i == j:
+                continue
+            approx_path2 = polylines2[j]
+            if not is_bbox_overlap(rect1, rects2[j]):
+                continue
+            for p in range(1, len(approx_path1)):
+                (p0, t0), (p1, t1) = approx_path1[p - 1:p + 1]
+                for q in range(1, len(approx_path2)):
+                    (p2, t2), (p3, t3) = approx_path2[q - 1:q + 1]
+                    if equal(p0, p2):
+                        cp = p0
+                    elif equal(p0, p3) or \
+                            equal(p1, p2) or \
+                            equal(p1, p3):
+                        cp = None
+                    else:
+                        cp = intersect_lines(p0, p1, p2, p3)
+                    if cp is not None:
+                        result.append((i, j, p, q, cp))
+    return result
+
+
+INTERSECT_POLYLINES = libcairo.intersect_polylines
+
+
+def get_cross_points(partials1, partials2, skip_same=False):
+    """
+    Finds crossing points of approximated path partials.
+    Returns list of (path1, index1, path2, index2) tuples in the order
+    of nested loops over partials and their segments.
+    """
+    polylines1 = [item[1] for item in partials1]
+    polylines2 = [item[1] for item in partials2]
+    result = []
+    for i, j, p, q, cp in INTERSECT_POLYLINES(polylines1, polylines2,
+                                              skip_same):
+        (p0, t0), (p1, t1) = polylines1[i][p - 1:p + 1]
+        (p2, t2), (p3, t3) = polylines2[j][q - 1:q + 1]
+        result.append((partials1[i][0], index(cp, p0, t0, p1, t1),
+                       partials2[j][0], index(cp, p2, t2, p3, t3)))
+    return result
+
+
+def intersect_approx_paths(approx_paths):
+    cross_point_id = 0
+    for i in range(len(approx_paths)):
+        for j in range(i + 1, len(approx_paths)):
+            if approx_paths[i][0][0].obj_id == approx_paths[j][0][0].obj_id:
+                continue
+            for path1, index1, path2, index2 in \
+                    get_cross_points(approx_paths[i], approx_paths[j]):
+                path1.cp_indexes.append(index1)
+                path1.cp_dict[index1] = cross_point_id
+                path2.cp_indexes.append(index2)
+                path2.cp_dict[index2] = cross_point_id
+                cross_point_id += 1
+
+
 def intersect_objects(curve_objs):
     paths = []
     for i in range(len(curve_objs)):
         paths += curve_objs[i].paths()
-    approx_paths = get_approx_paths(paths)
+    intersect_approx_paths(get_approx_paths(paths))
 
-    cross_point_id = 0
-    for i in range(len(approx_paths)):
-        for j in range(i + 1, len(approx_paths)):
-            for path1, approx_path1, rect1 in approx_paths[i]:
-                for path2, approx_path2, rect2 in approx_paths[j]:
-                    if not path1.obj_id == path2.obj_id and \
-                            is_bbox_overlap(rect1, rect2):
-                        for p in range(1, len(approx_path1)):
-                            (p0, t0), (p1, t1) = approx_path1[p - 1:p + 1]
-                            for q in range(1, len(approx_path2)):
-                                (p2, t2), (p3, t3) = approx_path2[q - 1:q + 1]
-                                if equal(p0, p2):
-                                    cp = p0
-                                elif equal(p0, p3) or \
-                                        equal(p1, p2) or \
-                                        equal(p1, p3):
-                                    cp = None
-                                else:
-                                    cp = intersect_lines(p0, p1, p2, p3)
-                                if cp is not None:
-                                    index1 = index(cp, p0, t0, p1, t1)
-                                    index2 = index(cp, p2, t2, p3, t3)
-                                    path1.cp_indexes.append(index1)
-                                    path1.cp_dict[index1] = cross_point_id
-                                    path2.cp_indexes.append(index2)
-                                    path2.cp_dict[index2] = cross_point_id
-                                    cross_point_id += 1
     result = []
     for obj in curve_objs:
         for path in obj.paths():
@@ -616,35 +641,7 @@ def intersect_objects(curve_objs):
 
 def intersect_segments(path1, path2):
     paths = [PathObject(path1, 0), PathObject(path2, 1)]
-    approx_paths = get_approx_paths(paths)
-
-    cross_point_id = 0
-    for i in range(len(approx_paths)):
-        for j in range(i + 1, len(approx_paths)):
-            for path1, approx_path1, rect1 in approx_paths[i]:
-                for path2, approx_path2, rect2 in approx_paths[j]:
-                    if not path1.obj_id == path2.obj_id and \
-                            is_bbox_overlap(rect1, rect2):
-                        for p in range(1, len(approx_path1)):
-                            (p0, t0), (p1, t1) = approx_path1[p - 1:p + 1]
-                            for q in range(1, len(approx_path2)):
-                                (p2, t2), (p3, t3) = approx_path2[q - 1:q + 1]
-                                if equal(p0, p2):
-                                    cp = p0
-                                elif equal(p0, p3) or \
-                                        equal(p1, p2) or \
-                                        equal(p1, p3):
-                                    cp = None
-                                else:
-                                    cp = intersect_lines(p0, p1, p2, p3)
-                                if cp is not None:
-                                    index1 = index(cp, p0, t0, p1, t1)
-                                    index2 = index(cp, p2, t2, p3, t3)
-                                    path1.cp_indexes.append(index1)
-                                    path1.cp_dict[index1] = cross_point_id
-                                    path2.cp_indexes.append(index2)
-                                    path2.cp_dict[index2] = cross_point_id
-                                    cross_point_id += 1
+    intersect_approx_paths(get_approx_paths(paths))
 
     result = [[], []]
     if not paths[0].cp_indexes:
@@ -678,36 +675,18 @@ def self_intersect(curve_obj):
 
     cross_point_id = 0
     approx_paths = approx_paths[0]
-
-    for i in range(-1, len(approx_paths) - 1):
-        path1, approx_path1, rect1 = approx_paths[i]
-        for j in range(-1, len(approx_paths) - 1):
-            if i == j:
-                continue
-            path2, approx_path2, rect2 = approx_paths[j]
-            if is_bbox_overlap(rect1, rect2):
-                for p in range(1, len(approx_path1)):
-                    (p0, t0), (p1, t1) = approx_path1[p - 1:p + 1]
-                    for q in range(1, len(approx_path2)):
-                        (p2, t2), (p3, t3) = approx_path2[q - 1:q + 1]
-                        if equal(p0, p2):
-                            cp = p0
-                        elif equal(p0, p3) or \
-                                equal(p1, p2) or \
-                                equal(p1, p3):
-                            cp = None
-                        else:
-                            cp = intersect_lines(p0, p1, p2, p3)
-                        if cp is not None:
-                            index1 = index(cp, p0, t0, p1, t1)
-                            index2 = index(cp, p2, t2, p3, t3)
-                            if index1 not in path1.cp_indexes:
-                                path1.cp_indexes.append(index1)
-                                path1.cp_dict[index1] = cross_point_id
-                            if index2 not in path2.cp_indexes:
-                                path2.cp_indexes.append(index2)
-                                path2.cp_dict[index2] = cross_point_id
-                            cross_point_id += 1
+    # partials are checked starting from the last one
+    approx_paths = approx_paths[-1:] + approx_paths[:-1]
+
+    for path1, index1, path2, index2 in \
+            get_cross_points(approx_paths, approx_paths, True):
+        if index1 not in path1.cp_indexes:
+            path1.cp_indexes.append(index1)
+            path1.cp_dict[index1] = cross_point_id
+        if index2 not in path2.cp_indexes:
+            path2.cp_indexes.append(index2)
+            path2.cp_dict[index2] = cross_point_id
+        cross_point_id += 1
 
     return paths[0].split()
 
@@ -719,26 +698,20 @@ def find_cross_id(path_objs, cross_id):
     return None
 
 
-def contained(curve_obj, path_obj):
-    for item in path_obj.get_points():
-        if not curve_obj.is_point_inside(item):
-            return False
+def get_test_points(path_obj):
+    points = path_obj.get_points()
     if path_obj.get_len() < 10:
         for i in range(path_obj.get_len()):
-            if not curve_obj.is_point_inside(path_obj.get_test_point(i)):
-                return False
-    return True
+            points.append(path_obj.get_test_point(i))
+    return points
+
+
+def contained(curve_obj, path_obj):
+    return all(curve_obj.are_points_inside(get_test_points(path_obj)))
 
 
 def on_stroke(curve_obj, path_obj):
-    for item in path_obj.get_points():
-        if curve_obj.is_point_on_stroke(item):
-            return True
-    if path_obj.get_len() < 10:
-        for i in range(path_obj.get_len()):
-            if curve_obj.is_point_on_stroke(path_obj.get_test_point(i)):
-                return True
-    return False
+    return any(curve_obj.are_points_on_stroke(get_test_points(path_obj)))
 
 
 # --- UNIVERSAL INTERSECTION ROUTINE
@@ -18,6 +18,7 @@
 import math
 
 import cwrap
+from packed import PackedPaths
 
 NORMAL_TRAFO = [1.0, 0.0, 0.0, 1.0, 0.0, 0.0]
 
@@ -64,6 +65,8 @@ def apply_trafo_to_path(path, trafo):
 
 
 def apply_trafo_to_paths(paths, trafo):
+    if isinstance(paths, PackedPaths):
+        return paths.transformed(trafo)
     return [apply_trafo_to_path(path, trafo) for path in paths]
 
 
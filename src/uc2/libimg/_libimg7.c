@@ -19,10 +19,41 @@
 #include <Python.h>
 #include <MagickWand/MagickWand.h>
 
+/* MagickWand environment is process-wide. It is started once by
+ * init_magick() and kept alive until terminate_magick() so resource and
+ * thread pools are not rebuilt for every processed image. Each started
+ * environment gets its own serial number, so callers which keep wands
+ * around can detect that the environment was restarted under them.
+ */
+static int magick_session = 0;
+static int magick_serial = 0;
+
+/* Wand objects remember the environment they were created in.
+ * MagickWandTerminus() drops the wand registry, so a wand which outlived
+ * its environment is left to the process instead of being destroyed.
+ */
+static void
+destroy_wand(void *wand, void *serial) {
+
+	if (magick_session && (long)serial == magick_serial)
+		DestroyMagickWand((MagickWand *)wand);
+}
+
+static PyObject *
+wand_object(MagickWand *wand) {
+
+	return PyCObject_FromVoidPtrAndDesc((void *)wand,
+			(void *)(long)magick_serial, destroy_wand);
+}
+
 static PyObject *
 im_InitMagick(PyObject *self, PyObject *args) {
 
-	MagickWandGenesis();
+	if (!magick_session) {
+		MagickWandGenesis();
+		magick_session = 1;
+		magick_serial++;
+	}
 
 	Py_INCREF(Py_None);
 	return Py_None;
@@ -31,12 +62,85 @@ im_InitMagick(PyObject *self, PyObject *args) {
 static PyObject *
 im_TerminateMagick(PyObject *self, PyObject *args) {
 
-	MagickWandTerminus();
+	if (magick_session) {
+		MagickWandTerminus();
+		magick_session = 0;
+	}
 
 	Py_INCREF(Py_None);
 	return Py_None;
 }
 
+static PyObject *
+im_IsMagickActive(PyObject *self, PyObject *args) {
+
+	return Py_BuildValue("i", magick_session ? magick_serial : 0);
+}
+
+static ResourceType
+get_resource_type(char *name) {
+
+	if (strcmp(name, "memory") == 0) {
+		return MemoryResource;
+	} else if (strcmp(name, "map") == 0) {
+		return MapResource;
+	} else if (strcmp(name, "thread") == 0) {
+		return ThreadResource;
+	} else if (strcmp(name, "area") == 0) {
+		return AreaResource;
+	} else if (strcmp(name, "disk") == 0) {
+		return DiskResource;
+	}
+	return UndefinedResource;
+}
+
+static PyObject *
+im_SetResourceLimit(PyObject *self, PyObject *args) {
+
+	char *name = NULL;
+	unsigned long long limit;
+	ResourceType resource;
+	MagickBooleanType status;
+
+	if (!PyArg_ParseTuple(args, "sK", &name, &limit)){
+		return Py_BuildValue("i", 0);
+	}
+
+	resource = get_resource_type(name);
+	if (resource == UndefinedResource){
+		return Py_BuildValue("i", 0);
+	}
+
+	status = MagickSetResourceLimit(resource, (MagickSizeType)limit);
+
+	if (status == MagickFalse){
+		return Py_BuildValue("i", 0);
+	}
+
+	return Py_BuildValue("i", 1);
+}
+
+static PyObject *
+im_GetResourceLimit(PyObject *self, PyObject *args) {
+
+	char *name = NULL;
+	ResourceType resource;
+
+	if (!PyArg_ParseTuple(args, "s", &name)){
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	resource = get_resource_type(name);
+	if (resource == UndefinedResource){
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return Py_BuildValue("K",
+			(unsigned long long)MagickGetResourceLimit(resource));
+}
+
 static PyObject *
 im_NewImage(PyObject *self, PyObject *args) {
 
@@ -44,8 +148,25 @@ im_NewImage(PyObject *self, PyObject *args) {
 
 	magick_wand = NewMagickWand();
 
-	return Py_BuildValue("O", PyCObject_FromVoidPtr((void *)magick_wand,
-			(void *)DestroyMagickWand));
+	return wand_object(magick_wand);
+}
+
+static PyObject *
+im_ClearImage(PyObject *self, PyObject *args) {
+
+	void *magick_pointer;
+	MagickWand *magick_wand;
+
+	if (!PyArg_ParseTuple(args, "O", &magick_pointer)){
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	magick_wand = (MagickWand *) PyCObject_AsVoidPtr(magick_pointer);
+	ClearMagickWand(magick_wand);
+
+	Py_INCREF(Py_None);
+	return Py_None;
 }
 
 static PyObject *
@@ -109,9 +230,7 @@ im_MergeLayers(PyObject *self, PyObject *args) {
 	magick_wand = (MagickWand *) PyCObject_AsVoidPtr(magick_pointer);
 	MagickResetIterator(magick_wand);
 
-	return Py_BuildValue("O",
-        PyCObject_FromVoidPtr((void *)MagickMergeImageLayers(magick_wand, MergeLayer),
-        (void *)DestroyMagickWand));
+	return wand_object(MagickMergeImageLayers(magick_wand, MergeLayer));
 }
 
 static PyObject *
@@ -157,6 +276,40 @@ im_GetImageBlob(PyObject *self, PyObject *args) {
 	return ret;
 }
 
+/* Returns named image profile (e.g. "icc") as a string
+ * or None if image has no such profile.
+ */
+static PyObject *
+im_GetImageProfile(PyObject *self, PyObject *args) {
+
+	void *magick_pointer;
+	MagickWand *magick_wand;
+	char *name = NULL;
+	unsigned char *profile;
+	size_t length = 0;
+	PyObject *ret;
+
+	if (!PyArg_ParseTuple(args, "Os", &magick_pointer, &name)){
+		return NULL;
+	}
+
+	magick_wand = (MagickWand *) PyCObject_AsVoidPtr(magick_pointer);
+	profile = MagickGetImageProfile(magick_wand, name, &length);
+	if (profile == NULL) {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+	if (length) {
+		ret = Py_BuildValue("s#", profile, length);
+	} else {
+		Py_INCREF(Py_None);
+		ret = Py_None;
+	}
+	MagickRelinquishMemory(profile);
+
+	return ret;
+}
+
 static PyObject *
 im_GetNumberImages(PyObject *self, PyObject *args) {
 
@@ -414,8 +567,7 @@ im_CloneImage(PyObject *self, PyObject *args) {
 	magick_wand = (MagickWand *) PyCObject_AsVoidPtr(magick_pointer);
 	wand_clone = CloneMagickWand(magick_wand);
 
-	return Py_BuildValue("O", PyCObject_FromVoidPtr((void *)wand_clone,
-			(void *)DestroyMagickWand));
+	return wand_object(wand_clone);
 }
 
 static PyObject *
@@ -513,6 +665,91 @@ im_RemoveAlpaChannel(PyObject *self, PyObject *args) {
 	return Py_None;
 }
 
+/* Raw pixel export. Target mode is a PIL mode name:
+ * "RGB" (exported as padded RGBX to be mapped by PIL without copying),
+ * "RGBA", "CMYK", "L" and "A" (alpha channel only).
+ * Returns (width, height, bytearray) or None.
+ */
+static PyObject *
+im_ExportPixels(PyObject *self, PyObject *args) {
+
+	void *magick_pointer;
+	MagickWand *magick_wand;
+	char *mode = NULL;
+	char *map;
+	ColorspaceType cs, target_cs = UndefinedColorspace;
+	size_t width, height, channels;
+	PyObject *pixels;
+	MagickBooleanType status = MagickTrue;
+
+	if (!PyArg_ParseTuple(args, "Os", &magick_pointer, &mode)){
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	if (strcmp(mode, "RGB") == 0) {
+		map = "RGBP";
+		target_cs = sRGBColorspace;
+	}
+	else if (strcmp(mode, "RGBA") == 0) {
+		map = "RGBA";
+		target_cs = sRGBColorspace;
+	}
+	else if (strcmp(mode, "CMYK") == 0) {
+		map = "CMYK";
+		target_cs = CMYKColorspace;
+	}
+	else if (strcmp(mode, "L") == 0) {
+		map = "I";
+	}
+	else if (strcmp(mode, "A") == 0) {
+		map = "A";
+	}
+	else {
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	magick_wand = (MagickWand *) PyCObject_AsVoidPtr(magick_pointer);
+	width = MagickGetImageWidth(magick_wand);
+	height = MagickGetImageHeight(magick_wand);
+	channels = strlen(map);
+
+	if (!width || !height || width > PY_SSIZE_T_MAX / height / channels){
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	pixels = PyByteArray_FromStringAndSize(NULL,
+			(Py_ssize_t)(width * height * channels));
+	if (pixels == NULL){
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	cs = MagickGetImageColorspace(magick_wand);
+	if (target_cs == sRGBColorspace && cs != sRGBColorspace &&
+			cs != RGBColorspace && cs != GRAYColorspace) {
+		status = MagickTransformImageColorspace(magick_wand, target_cs);
+	}
+	else if (target_cs == CMYKColorspace && cs != CMYKColorspace) {
+		status = MagickTransformImageColorspace(magick_wand, target_cs);
+	}
+	if (status != MagickFalse) {
+		status = MagickExportImagePixels(magick_wand, 0, 0, width, height,
+				map, CharPixel, PyByteArray_AS_STRING(pixels));
+	}
+	Py_END_ALLOW_THREADS
+
+	if (status == MagickFalse){
+		Py_DECREF(pixels);
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	return Py_BuildValue("(iiN)", (int)width, (int)height, pixels);
+}
+
 static PyObject *
 im_GetVersion(PyObject *self, PyObject *args) {
 
@@ -529,12 +766,17 @@ static
 PyMethodDef im_methods[] = {
 		{"init_magick", im_InitMagick, METH_VARARGS},
 		{"terminate_magick", im_TerminateMagick, METH_VARARGS},
+		{"is_magick_active", im_IsMagickActive, METH_VARARGS},
+		{"set_resource_limit", im_SetResourceLimit, METH_VARARGS},
+		{"get_resource_limit", im_GetResourceLimit, METH_VARARGS},
 		{"new_image", im_NewImage, METH_VARARGS},
+		{"clear_image", im_ClearImage, METH_VARARGS},
 		{"load_image", im_LoadImage, METH_VARARGS},
 		{"load_image_blob", im_LoadImageBlob, METH_VARARGS},
 		{"merge_layers", im_MergeLayers, METH_VARARGS},
 		{"write_image", im_WriteImage, METH_VARARGS},
 		{"get_image_blob", im_GetImageBlob, METH_VARARGS},
+		{"get_image_profile", im_GetImageProfile, METH_VARARGS},
 		{"get_number_images", im_GetNumberImages, METH_VARARGS},
 		{"reset_iterator", im_ResetIterator, METH_VARARGS},
 		{"next_image", im_NextImage, METH_VARARGS},
@@ -544,6 +786,7 @@ PyMethodDef im_methods[] = {
 		{"set_image_format", im_SetImageFormat, METH_VARARGS},
 		{"set_image_type", im_SetImageType, METH_VARARGS},
 		{"remove_alpha_channel", im_RemoveAlpaChannel, METH_VARARGS},
+		{"export_pixels", im_ExportPixels, METH_VARARGS},
 		{"get_version", im_GetVersion, METH_VARARGS},
 
 	{NULL, NULL}
@@ -31,14 +31,24 @@ from . import magickwand
 
 TIFF_FMT = 'TIFF'
 PNG_FMT = 'PNG'
+JPEG_FMT = 'JPEG'
+PASSTHROUGH_FORMATS = (PNG_FMT, JPEG_FMT)
 
 LOG = logging.getLogger(__name__)
 
 
 class ImageHandler(object):
+    """
+    Keeps pixmap images. Bitmaps set from strings (or loaded from
+    PNG/JPEG files without required conversion) are stored in original
+    encoding and decoded on demand only, so savers can embed them as is.
+    """
     pixmap = None
-    bitmap = None
-    alpha = None
+    _bitmap = None
+    _alpha = None
+    bitmap_str = None
+    alpha_str = None
+    bitmap_info = None
 
     cdata = None
     ps_cdata = None
@@ -47,14 +57,60 @@ class ImageHandler(object):
     def __init__(self, pixmap):
         self.pixmap = pixmap
 
+    @property
+    def bitmap(self):
+        if self._bitmap is None and self.bitmap_str:
+            LOG.debug('Decoding bitmap on demand')
+            self._bitmap = self._str2image(self.bitmap_str)
+        return self._bitmap
+
+    @bitmap.setter
+    def bitmap(self, image):
+        self._bitmap = image
+        self.bitmap_str = None
+        self.bitmap_info = None
+
+    @property
+    def alpha(self):
+        if self._alpha is None and self.alpha_str:
+            self._alpha = self._str2image(self.alpha_str)
+        return self._alpha
+
+    @alpha.setter
+    def alpha(self, image):
+        self._alpha = image
+        self.alpha_str = None
+
+    def _get_info(self):
+        if self.bitmap_info is None and self.bitmap_str:
+            image = Image.open(StringIO(self.bitmap_str))
+            self.bitmap_info = (image.format, image.mode, image.size)
+        return self.bitmap_info
+
     def get_size(self):
+        if self._bitmap is None and self.bitmap_str:
+            return self._get_info()[2]
         return self.bitmap.size if self.bitmap else (0, 0)
 
     def get_mode(self):
+        if self._bitmap is None and self.bitmap_str:
+            return self._get_info()[1]
         return self.bitmap.mode if self.bitmap else None
 
     def has_alpha(self):
-        return self.alpha is not None
+        return self._alpha is not None or bool(self.alpha_str)
+
+    def is_decoded(self):
+        return self._bitmap is not None or not self.bitmap_str
+
+    def get_encoded_bitmap(self):
+        """
+        Returns (format, bytes) of original bitmap encoding
+        or (None, None) if bitmap was changed or created in memory.
+        """
+        if not self.bitmap_str:
+            return None, None
+        return self._get_info()[0], self.bitmap_str
 
     def clear_cache(self):
         self.cdata = None
@@ -78,22 +134,36 @@ class ImageHandler(object):
         image.load()
         return image
 
+    def get_bitmap_str(self):
+        return self.bitmap_str or self._image2str(self.bitmap)
+
+    def get_alpha_str(self):
+        return self.alpha_str or self._image2str(self.alpha)
+
     def get_bitmap_b64str(self):
-        bitmap_str = self._image2str(self.bitmap)
+        bitmap_str = self.get_bitmap_str()
         return b64encode(bitmap_str) if bitmap_str else None
 
     def get_alpha_b64str(self):
-        alpha_str = self._image2str(self.alpha)
+        alpha_str = self.get_alpha_str()
         return b64encode(alpha_str) if alpha_str else None
 
     def set_images(self, bitmap=None, alpha=None):
-        self.bitmap = bitmap if bitmap else self.bitmap
-        self.alpha = alpha if alpha else self.alpha
+        if bitmap:
+            self.bitmap = bitmap
+        if alpha:
+            self.alpha = alpha
         self.clear_cache()
 
     def set_images_from_str(self, bitmap_str=None, alpha_str=None):
-        self.set_images(self._str2image(bitmap_str),
-                        self._str2image(alpha_str))
+        if bitmap_str:
+            self._bitmap = None
+            self.bitmap_str = bitmap_str
+            self.bitmap_info = None
+        if alpha_str:
+            self._alpha = None
+            self.alpha_str = alpha_str
+        self.clear_cache()
 
     def set_images_from_b64str(self, bitmap_str=None, alpha_str=None):
         bitmap_str = b64decode(bitmap_str) if bitmap_str else None
@@ -104,7 +174,33 @@ class ImageHandler(object):
     def update_cache(self, cms):
         pass
 
-    def load_from_images(self, cms, image, alpha=None):
+    def _is_passthrough(self, image):
+        return image.format in PASSTHROUGH_FORMATS and \
+               image.mode in uc2const.SUPPORTED_CS and \
+               'icc_profile' not in image.info and \
+               'transparency' not in image.info
+
+    def _set_style(self, mode):
+        cfg = self.pixmap.config
+        style = deepcopy(cfg.default_image_style)
+        if mode in [uc2const.IMAGE_RGB, uc2const.IMAGE_LAB]:
+            style[3] = deepcopy(cfg.default_rgb_image_style)
+        self.pixmap.style = style
+
+    def load_from_images(self, cms, image, alpha=None, raw_content=None):
+        """
+        Loads bitmap and alpha from PIL images. Pass-through images
+        are kept encoded, so update_cache() is skipped for them:
+        the surface cache is rebuilt lazily by the first
+        get_surface() call which decodes bitmap on demand.
+        """
+        if raw_content and alpha is None and self._is_passthrough(image):
+            LOG.debug('Keep %s image encoded, mode %s',
+                      image.format, image.mode)
+            self._set_style(image.mode)
+            self.set_images_from_str(raw_content)
+            return
+
         image.load()
         LOG.debug('Image mode %s', image.mode)
         if alpha:
@@ -132,15 +228,11 @@ class ImageHandler(object):
 
         if profile:
             try:
-                image = cms.adjust_image(image, profile)
+                image = cms.adjust_image(image, profile, inplace=True)
             except Exception as e:
                 LOG.warning('Error adjusting image: %s', e)
 
-        cfg = self.pixmap.config
-        style = deepcopy(cfg.default_image_style)
-        if image.mode in [uc2const.IMAGE_RGB, uc2const.IMAGE_LAB]:
-            style[3] = deepcopy(cfg.default_rgb_image_style)
-        self.pixmap.style = style
+        self._set_style(image.mode)
 
         if alpha:
             if alpha.mode == 'P':
@@ -152,14 +244,14 @@ class ImageHandler(object):
 
     def _load_by_pil(self, cms, fileptr):
         fileptr.seek(0)
-        self.load_from_images(cms, Image.open(fileptr))
+        content = fileptr.read()
+        self.load_from_images(cms, Image.open(StringIO(content)),
+                              raw_content=content)
 
     def _load_by_magickwand(self, cms, fileptr):
         fileptr.seek(0)
         content = fileptr.read()
-        image_stream, alpha_stream = magickwand.process_image(content)
-        image = Image.open(image_stream)
-        alpha = Image.open(alpha_stream) if alpha_stream else None
+        image, alpha = magickwand.process_image(content)
         self.load_from_images(cms, image, alpha)
 
     def load_from_fileptr(self, cms, fileptr):
@@ -313,8 +405,11 @@ class EditableImageHandler(DrawableImageHandler):
     def copy(self, pixmap=None):
         pixmap = pixmap or self.pixmap
         hdl = EditableImageHandler(pixmap)
-        hdl.set_images(self.bitmap.copy() if self.bitmap else None,
-                       self.alpha.copy() if self.alpha else None)
+        hdl.set_images_from_str(self.bitmap_str, self.alpha_str)
+        if self.bitmap_str is None:
+            hdl.set_images(self.bitmap.copy() if self.bitmap else None)
+        if self.alpha_str is None:
+            hdl.set_images(None, self.alpha.copy() if self.alpha else None)
         return hdl
 
     def remove_alpha(self):
@@ -15,8 +15,14 @@
 #  You should have received a copy of the GNU Affero General Public License
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
-from cStringIO import StringIO
+import atexit
 import logging
+import threading
+from cStringIO import StringIO
+
+from PIL import Image
+
+import uc2
 
 UNDEFINED_TYPE = 'UndefinedType'
 BILEVEL_TYPE = 'BilevelType'
@@ -35,6 +41,15 @@ ALPHA_TYPES = [LA_TYPE, PA_TYPE, RGBA_TYPE, CMYKA_TYPE]
 CMYK_TYPES = [CMYK_TYPE, CMYKA_TYPE]
 DUOTONES = [BILEVEL_TYPE, L_TYPE, LA_TYPE]
 
+EXPORT_MODES = {
+    BILEVEL_TYPE: 'L',
+    L_TYPE: 'L',
+    LA_TYPE: 'L',
+    CMYK_TYPE: 'CMYK',
+    CMYKA_TYPE: 'CMYK',
+}
+RAW_MODES = {'RGB': 'RGBX', 'L': 'L', 'CMYK': 'CMYK', 'A': 'L'}
+
 LOG = logging.getLogger(__name__)
 
 
@@ -44,37 +59,150 @@ def get_magickwand_version():
     return ' '.join(ver[0].split(' ')[1:-1]), ver[1]
 
 
+class MagickSession(object):
+    """
+    Process-wide MagickWand environment. ImageMagick is initialized
+    on first use and kept alive until stop() (or interpreter exit),
+    processed wands are cleared and reused instead of being recreated.
+    Resource limits are taken from config (in MiB, 0 means
+    ImageMagick default).
+
+    The session follows the C-level environment state, so direct
+    init_magick()/terminate_magick() calls do not leave stale wands
+    in the pool.
+    """
+    lock = None
+    wands = None
+    issued = None
+    serial = 0
+    registered = False
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.wands = []
+        self.issued = {}
+
+    def _sync(self):
+        # must be called under lock
+        import _libimg
+        serial = _libimg.is_magick_active()
+        if serial != self.serial:
+            # pooled wands belong to terminated environment
+            self.wands = []
+            self.serial = serial
+        return serial
+
+    @property
+    def active(self):
+        with self.lock:
+            return bool(self._sync())
+
+    def start(self):
+        import _libimg
+        with self.lock:
+            if self._sync():
+                return
+            _libimg.init_magick()
+            self._sync()
+            if not self.registered:
+                atexit.register(self.stop)
+                self.registered = True
+        self.apply_limits()
+        LOG.debug('MagickWand session started')
+
+    def stop(self):
+        import _libimg
+        with self.lock:
+            if not self._sync():
+                return
+            # wands must be destroyed before environment termination
+            self.wands = []
+            _libimg.terminate_magick()
+            self._sync()
+        LOG.debug('MagickWand session terminated')
+
+    def apply_limits(self, memory=None, mmap=None, threads=None):
+        import _libimg
+        config = getattr(uc2, 'config', None)
+        if memory is None:
+            memory = getattr(config, 'magick_memory_limit', 0)
+        if mmap is None:
+            mmap = getattr(config, 'magick_map_limit', 0)
+        if threads is None:
+            threads = getattr(config, 'magick_threads', 0)
+        if memory:
+            _libimg.set_resource_limit('memory', memory * 1024 * 1024)
+        if mmap:
+            _libimg.set_resource_limit('map', mmap * 1024 * 1024)
+        if threads:
+            _libimg.set_resource_limit('thread', threads)
+
+    def get_wand(self):
+        import _libimg
+        self.start()
+        with self.lock:
+            wand = self.wands.pop() if self.wands else _libimg.new_image()
+            self.issued[id(wand)] = self.serial
+        return wand
+
+    def release_wand(self, wand):
+        import _libimg
+        with self.lock:
+            serial = self.issued.pop(id(wand), None)
+            if not serial or serial != self._sync():
+                return
+            _libimg.clear_image(wand)
+            self.wands.append(wand)
+
+
+SESSION = MagickSession()
+
+
 def check_image_file(filepath):
     import _libimg
-    _libimg.init_magick()
-    wand = _libimg.new_image()
+    wand = SESSION.get_wand()
     ret = _libimg.load_image(wand, filepath)
-    _libimg.terminate_magick()
+    SESSION.release_wand(wand)
     LOG.debug('MagickWand check: %s', ret == 1)
     return ret == 1
 
 
-def process_image(raw_content):
+def export_image(wand, mode):
+    """
+    Exports current wand image pixels directly into PIL image
+    without intermediate encoding. Returns None if export fails.
+    """
     import _libimg
-    LOG.debug('MagickWand processing started')
-    alpha = None
-    _libimg.init_magick()
-    wand = _libimg.new_image()
-    _libimg.load_image_blob(wand, raw_content)
-    if _libimg.get_number_images(wand) > 1:
-        LOG.debug('Wand merging.')
-        wand = _libimg.merge_layers(wand)
+    ret = _libimg.export_pixels(wand, mode)
+    if not ret:
+        return None
+    width, height, pixels = ret
+    image_mode = 'L' if mode == 'A' else mode
+    return Image.frombuffer(image_mode, (width, height), pixels,
+                            'raw', RAW_MODES[mode], 0, 1)
+
+
+def get_export_profile(wand, colorspace):
+    """
+    Returns embedded ICC profile applicable to exported pixels.
+    The profile describes source colorspace only, so it is dropped
+    when the wand was transformed into another colorspace on export.
+    """
+    import _libimg
+    if _libimg.get_colorspace(wand) != colorspace:
+        return None
+    return _libimg.get_image_profile(wand, 'icc') or None
 
-    image_type = _libimg.get_image_type(wand)
-    LOG.debug('Wand image type: %s', image_type)
 
+def _encode_image(wand, image_type):
+    import _libimg
+    alpha = None
     if image_type in ALPHA_TYPES:
         alpha_wand = _libimg.clone_image(wand)
         _libimg.remove_alpha_channel(wand)
         _libimg.set_image_format(alpha_wand, 'png')
         _libimg.set_image_type(alpha_wand, RGBA_TYPE)
-        alpha = StringIO(_libimg.get_image_blob(alpha_wand))
-        alpha.seek(0)
+        alpha = Image.open(StringIO(_libimg.get_image_blob(alpha_wand)))
 
     if image_type in CMYK_TYPES:
         _libimg.set_image_format(wand, 'tiff')
@@ -82,21 +210,53 @@ def process_image(raw_content):
     else:
         _libimg.set_image_format(wand, 'png')
 
-    base = StringIO(_libimg.get_image_blob(wand))
-    base.seek(0)
-    _libimg.terminate_magick()
+    base = Image.open(StringIO(_libimg.get_image_blob(wand)))
+    return base, alpha
+
+
+def process_image(raw_content):
+    import _libimg
+    LOG.debug('MagickWand processing started')
+    wand = source = SESSION.get_wand()
+    _libimg.load_image_blob(wand, raw_content)
+    if _libimg.get_number_images(wand) > 1:
+        LOG.debug('Wand merging.')
+        wand = _libimg.merge_layers(wand)
+
+    image_type = _libimg.get_image_type(wand)
+    colorspace = _libimg.get_colorspace(wand)
+    LOG.debug('Wand image type: %s', image_type)
+
+    base = export_image(wand, EXPORT_MODES.get(image_type, 'RGB'))
+    alpha = None
+    if base and image_type in ALPHA_TYPES:
+        alpha = export_image(wand, 'A')
+    if base is None or (image_type in ALPHA_TYPES and alpha is None):
+        LOG.debug('Raw export failed, encoding image')
+        base, alpha = _encode_image(wand, image_type)
+    elif image_type == BILEVEL_TYPE:
+        base = base.convert('1')
+
+    # raw pixels carry no embedded profile unlike encoded blob,
+    # while encoded blob keeps stale profile after transformation
+    profile = get_export_profile(wand, colorspace)
+    if profile:
+        base.info['icc_profile'] = profile
+    elif 'icc_profile' in base.info:
+        del base.info['icc_profile']
+
+    SESSION.release_wand(source)
     return base, alpha
 
 
 def process_pattern(raw_content):
     import _libimg
     LOG.debug('MagickWand duotone processing started')
-    _libimg.init_magick()
-    wand = _libimg.new_image()
+    wand = SESSION.get_wand()
     _libimg.load_image_blob(wand, raw_content)
     image_type = _libimg.get_image_type(wand)
     _libimg.set_image_format(wand, 'tiff')
     base = StringIO(_libimg.get_image_blob(wand))
     base.seek(0)
-    _libimg.terminate_magick()
+    SESSION.release_wand(wand)
     return base, image_type in DUOTONES
@@ -17,6 +17,8 @@
  */
 
 #include <Python.h>
+#include <stdlib.h>
+#include <string.h>
 #include <pango/pango.h>
 #include <pango/pangocairo.h>
 #include <cairo.h>
@@ -58,9 +60,11 @@ pango_GetFontMap(PyObject *self, PyObject *args) {
 
 		pango_font_family_list_faces(families[i], &faces, &n_faces);
 
-
-		pango_font_face_list_sizes(faces[0], &sizes, &n_sizes);
-		if (!sizes) {
+		sizes = NULL;
+		if (n_faces) {
+			pango_font_face_list_sizes(faces[0], &sizes, &n_sizes);
+		}
+		if (n_faces && !sizes) {
 			faces_tuple = PyTuple_New(n_faces);
 			for (j = 0; j < n_faces; j++) {
 				PyTuple_SetItem(faces_tuple, j,
@@ -83,6 +87,115 @@ pango_GetFontMap(PyObject *self, PyObject *args) {
 	return ret;
 }
 
+/* Font families of default font map by name. The table is built
+ * on font families listing and reused by faces lookups, so resolving
+ * faces for every family does not list the font map again and again.
+ */
+static GHashTable *family_table = NULL;
+static PangoFontMap *family_table_fm = NULL;
+
+static GHashTable *
+update_family_table(PangoFontMap *fm) {
+
+	PangoFontFamily **families;
+	int n_families, i;
+
+	if (family_table) {
+		g_hash_table_destroy(family_table);
+	}
+	family_table = g_hash_table_new_full(g_str_hash, g_str_equal,
+			g_free, g_object_unref);
+	family_table_fm = fm;
+
+	pango_font_map_list_families(fm, &families, &n_families);
+	for (i = 0; i < n_families; i++) {
+		g_hash_table_insert(family_table,
+				g_strdup(pango_font_family_get_name(families[i])),
+				g_object_ref(families[i]));
+	}
+	g_free(families);
+
+	return family_table;
+}
+
+static GHashTable *
+get_family_table(void) {
+
+	PangoFontMap *fm;
+
+	fm = pango_cairo_font_map_get_default();
+	if (family_table && family_table_fm == fm) {
+		return family_table;
+	}
+	return update_family_table(fm);
+}
+
+/* Returns tuple of font family names without faces enumeration */
+static PyObject *
+pango_GetFontFamilies(PyObject *self, PyObject *args) {
+
+	GHashTable *table;
+	GHashTableIter iter;
+	gpointer name;
+	Py_ssize_t i = 0;
+	PyObject *ret;
+
+	table = update_family_table(pango_cairo_font_map_get_default());
+
+	ret = PyTuple_New(g_hash_table_size(table));
+	if (ret == NULL) {
+		return NULL;
+	}
+	g_hash_table_iter_init(&iter, table);
+	while (g_hash_table_iter_next(&iter, &name, NULL)) {
+		PyTuple_SetItem(ret, i++, Py_BuildValue("s", (char *) name));
+	}
+
+	return ret;
+}
+
+/* Returns tuple of face names for font family
+ * or None for unknown family and bitmap-only (sized) fonts
+ */
+static PyObject *
+pango_GetFontFaces(PyObject *self, PyObject *args) {
+
+	char *family_name;
+	PangoFontFamily *family;
+	PangoFontFace **faces;
+	int n_faces, j;
+	int *sizes = NULL, n_sizes;
+	PyObject *ret = NULL;
+
+	if (!PyArg_ParseTuple(args, "s", &family_name)) {
+		return NULL;
+	}
+
+	family = g_hash_table_lookup(get_family_table(), family_name);
+	if (family) {
+		pango_font_family_list_faces(family, &faces, &n_faces);
+		if (n_faces) {
+			pango_font_face_list_sizes(faces[0], &sizes, &n_sizes);
+		}
+		if (n_faces && !sizes) {
+			ret = PyTuple_New(n_faces);
+			for (j = 0; ret && j < n_faces; j++) {
+				PyTuple_SetItem(ret, j,
+						Py_BuildValue("s",
+								pango_font_face_get_face_name(faces[j])));
+			}
+		}
+		g_free(sizes);
+		g_free(faces);
+	}
+
+	if (ret == NULL && !PyErr_Occurred()) {
+		Py_INCREF(Py_None);
+		ret = Py_None;
+	}
+	return ret;
+}
+
 static PyObject *
 pango_CreateContext(PyObject *self, PyObject *args) {
 
@@ -236,7 +349,9 @@ pango_SetLayoutMarkup(PyObject *self, PyObject *args) {
 
 	layout = PyCObject_AsVoidPtr(LayoutObj);
 
+	Py_BEGIN_ALLOW_THREADS
 	pango_layout_set_markup(layout, markup, -1);
+	Py_END_ALLOW_THREADS
 
 	Py_INCREF(Py_None);
 	return Py_None;
@@ -256,7 +371,10 @@ pango_GetLayoutPixelSize(PyObject *self, PyObject *args) {
 
 	layout = PyCObject_AsVoidPtr(LayoutObj);
 
+	/* layout is shaped lazily on first size request */
+	Py_BEGIN_ALLOW_THREADS
 	pango_layout_get_pixel_size(layout, &width, &height);
+	Py_END_ALLOW_THREADS
 
 	pixel_size = PyTuple_New(2);
 	PyTuple_SetItem(pixel_size, 0, PyInt_FromLong(width));
@@ -280,7 +398,9 @@ pango_LayoutPath(PyObject *self, PyObject *args) {
 	ctx = context->ctx;
 	layout = PyCObject_AsVoidPtr(LayoutObj);
 
+	Py_BEGIN_ALLOW_THREADS
 	pango_cairo_layout_path(ctx, layout);
+	Py_END_ALLOW_THREADS
 
 	Py_INCREF(Py_None);
 	return Py_None;
@@ -553,10 +673,183 @@ pango_GetLayoutClusterPos(PyObject *self, PyObject *args) {
 	return ret;
 }
 
+/* Single pass text-to-path for already prepared layout.
+ * Iterates layout runs and emits outline of each glyph cluster
+ * using run font, so shaping is done once for whole layout.
+ * Outlines are collected without GIL; Python objects are created after.
+ * Returns list of cluster records in visual order:
+ * (x, y, width, height, base_line, byte_index, run_end, rtl, cpath)
+ * Coordinates use the same system as get_layout_cluster_positions().
+ * On memory error all collected paths are released and NULL is returned.
+ */
+typedef struct {
+	double x, y, width, height, baseline;
+	int byte_index, run_end, rtl;
+	cairo_path_t *path;
+} GlyphRecord;
+
+static GlyphRecord *
+collect_layout_glyphs(cairo_t *ctx, PangoLayout *layout, int *count) {
+
+	int i, j, k, n, start, w, h, size, rtl, run_end, failed = 0;
+	double x, dx, dy, baseline, top, height, width;
+	cairo_path_t *path;
+	PangoLayoutIter *iter;
+	PangoLayoutRun *run;
+	PangoGlyphString sub;
+	PangoRectangle run_rect;
+	GlyphRecord *records, *tmp, *record;
+
+	size = 64;
+	*count = 0;
+	records = malloc(size * sizeof(GlyphRecord));
+	if (records == NULL) {
+		return NULL;
+	}
+
+	pango_layout_get_size(layout, &w, &h);
+	dx = 0.0;
+	if (pango_layout_get_alignment(layout) == PANGO_ALIGN_CENTER) {
+		dx = -0.5 * ((double) w) / PANGO_SCALE;
+	} else if (pango_layout_get_alignment(layout) == PANGO_ALIGN_RIGHT) {
+		dx = -1.0 * ((double) w) / PANGO_SCALE;
+	}
+
+	iter = pango_layout_get_iter(layout);
+	dy = ((double) pango_layout_iter_get_baseline(iter)) / PANGO_SCALE;
+
+	cairo_save(ctx);
+	cairo_identity_matrix(ctx);
+
+	do {
+		run = pango_layout_iter_get_run_readonly(iter);
+		if (!run) {
+			continue;
+		}
+
+		pango_layout_iter_get_run_extents(iter, NULL, &run_rect);
+		baseline = ((double) pango_layout_iter_get_baseline(iter)) / PANGO_SCALE;
+		top = ((double) run_rect.y) / PANGO_SCALE;
+		height = ((double) run_rect.height) / PANGO_SCALE;
+		x = ((double) run_rect.x) / PANGO_SCALE;
+		rtl = run->item->analysis.level % 2;
+		run_end = run->item->offset + run->item->length;
+
+		for (i = 0; i < run->glyphs->num_glyphs; i = j) {
+			start = run->glyphs->log_clusters[i];
+			width = 0.0;
+			for (j = i; j < run->glyphs->num_glyphs &&
+					run->glyphs->log_clusters[j] == start; j++) {
+				width += ((double) run->glyphs->glyphs[j].geometry.width)
+						/ PANGO_SCALE;
+			}
+
+			sub = *run->glyphs;
+			sub.num_glyphs = j - i;
+			sub.glyphs = run->glyphs->glyphs + i;
+			sub.log_clusters = run->glyphs->log_clusters + i;
+
+			cairo_new_path(ctx);
+			cairo_move_to(ctx, x, baseline);
+			pango_cairo_glyph_string_path(ctx, run->item->analysis.font, &sub);
+			path = cairo_copy_path(ctx);
+
+			/* pango coordinates -> layout data coordinates */
+			for (n = 0; n < path->num_data; n += path->data[n].header.length) {
+				for (k = n + 1; k < n + path->data[n].header.length; k++) {
+					path->data[k].point.x += dx;
+					path->data[k].point.y = dy - path->data[k].point.y;
+				}
+			}
+
+			if (*count == size) {
+				size *= 2;
+				tmp = realloc(records, size * sizeof(GlyphRecord));
+				if (tmp == NULL) {
+					cairo_path_destroy(path);
+					failed = 1;
+					break;
+				}
+				records = tmp;
+			}
+			record = &records[(*count)++];
+			record->x = x + dx;
+			record->y = dy - top;
+			record->width = width;
+			record->height = height;
+			record->baseline = dy - baseline;
+			record->byte_index = run->item->offset + start;
+			record->run_end = run_end;
+			record->rtl = rtl;
+			record->path = path;
+			x += width;
+		}
+	} while (!failed && pango_layout_iter_next_run(iter));
+
+	pango_layout_iter_free(iter);
+	cairo_new_path(ctx);
+	cairo_restore(ctx);
+
+	if (failed) {
+		for (i = 0; i < *count; i++) {
+			cairo_path_destroy(records[i].path);
+		}
+		free(records);
+		*count = 0;
+		return NULL;
+	}
+
+	return records;
+}
+
+static PyObject *
+pango_GetLayoutGlyphs(PyObject *self, PyObject *args) {
+
+	int i, count;
+	PycairoContext *context;
+	void *LayoutObj;
+	GlyphRecord *records, *record;
+	PyObject *ret, *item;
+
+	if (!PyArg_ParseTuple(args, "OO", &context, &LayoutObj)) {
+		return NULL;
+	}
+
+	Py_BEGIN_ALLOW_THREADS
+	records = collect_layout_glyphs(context->ctx,
+			PyCObject_AsVoidPtr(LayoutObj), &count);
+	Py_END_ALLOW_THREADS
+
+	if (records == NULL) {
+		return PyErr_NoMemory();
+	}
+
+	ret = PyList_New(count);
+	for (i = 0; i < count; i++) {
+		record = &records[i];
+		/* PycairoPath_FromPath takes ownership of cairo path */
+		item = Py_BuildValue("(dddddiiiN)",
+				record->x, record->y, record->width, record->height,
+				record->baseline, record->byte_index, record->run_end,
+				record->rtl, PycairoPath_FromPath(record->path));
+		if (ret != NULL && item != NULL) {
+			PyList_SET_ITEM(ret, i, item);
+		} else {
+			Py_XDECREF(item);
+			Py_CLEAR(ret);
+		}
+	}
+	free(records);
+
+	return ret;
+}
+
 static
 PyMethodDef pango_methods[] = {
 	{"get_version", pango_GetVersion, METH_VARARGS},
 	{"get_fontmap", pango_GetFontMap, METH_VARARGS},
+	{"get_font_families", pango_GetFontFamilies, METH_VARARGS},
+	{"get_font_faces", pango_GetFontFaces, METH_VARARGS},
 	{"create_pcctx", pango_CreateContext, METH_VARARGS},
 	{"create_layout", pango_CreateLayout, METH_VARARGS},
 	{"create_font_description", pango_CreateFontDescription, METH_VARARGS},
@@ -570,6 +863,7 @@ PyMethodDef pango_methods[] = {
 	{"get_layout_line_positions", pango_GetLayoutLinePos, METH_VARARGS},
 	{"get_layout_char_positions", pango_GetLayoutCharPos, METH_VARARGS},
 	{"get_layout_cluster_positions", pango_GetLayoutClusterPos, METH_VARARGS},
+	{"get_layout_glyphs", pango_GetLayoutGlyphs, METH_VARARGS},
 	{NULL, NULL}
 };
 
@@ -18,9 +18,10 @@
 import _libpango
 import cairo
 import os
-from copy import deepcopy
+import threading
 
 from markup import apply_markup, apply_glyph_markup
+from uc2.utils.lrucache import LRUCache
 
 PANGO_UNITS = 1024
 
@@ -30,6 +31,8 @@ DIRECT_MATRIX = cairo.Matrix()
 
 PANGO_MATRIX = cairo.Matrix(1.0, 0.0, 0.0, -1.0, 0.0, 0.0)
 PANGO_LAYOUT = _libpango.create_layout(CTX)
+MAIN_THREAD = threading.current_thread()
+THREAD_DATA = threading.local()
 NONPRINTING_CHARS = ' \n\t '.decode('utf-8')
 
 
@@ -39,34 +42,62 @@ def get_version():
 
 # --- Glyph caching
 
-GLYPH_CACHE = {}
+class GlyphCache(LRUCache):
+    """Glyph outlines cache. Outline is stored once as cairo path
+    at layout origin; keys are (font description, glyph markup,
+    layout width, alignment).
+    """
+    pass
 
 
-def get_glyph_cache(font_name, char):
-    char = str(char)
-    if font_name in GLYPH_CACHE and char in GLYPH_CACHE[font_name]:
-        return deepcopy(GLYPH_CACHE[font_name][char])
+GLYPH_CACHE = GlyphCache()
 
 
-def set_glyph_cache(font_name, char, glyph):
-    GLYPH_CACHE[font_name] = GLYPH_CACHE.get(font_name, {})
-    GLYPH_CACHE[font_name][str(char)] = deepcopy(glyph)
+def get_glyph_cache_stats():
+    return GLYPH_CACHE.get_stats()
+
+
+def clear_glyph_cache():
+    GLYPH_CACHE.clear()
 
 
 # --- Pango context functionality
 
-def create_layout(ctx=CTX):
-    return _libpango.create_layout(ctx)
+def get_context():
+    """Returns cairo context and Pango layout of current thread.
+    Main thread uses module level CTX and PANGO_LAYOUT, other threads
+    get their own ones, so independent texts can be shaped concurrently.
+    """
+    if threading.current_thread() is MAIN_THREAD:
+        return CTX, PANGO_LAYOUT
+    if not hasattr(THREAD_DATA, 'layout'):
+        THREAD_DATA.surface = cairo.ImageSurface(cairo.FORMAT_RGB24, 1, 1)
+        THREAD_DATA.ctx = cairo.Context(THREAD_DATA.surface)
+        THREAD_DATA.layout = _libpango.create_layout(THREAD_DATA.ctx)
+    return THREAD_DATA.ctx, THREAD_DATA.layout
 
 
-def get_font_description(text_style, check_nt=False):
+def get_layout(layout=None):
+    return get_context()[1] if layout is None else layout
+
+
+def create_layout(ctx=None):
+    return _libpango.create_layout(ctx or get_context()[0])
+
+
+def get_font_description_string(text_style, check_nt=False):
     font_size = text_style[2] * 10.0 \
         if check_nt and os.name == 'nt' else text_style[2]
-    fnt_descr = text_style[0] + ', ' + text_style[1] + ' ' + str(font_size)
+    return text_style[0] + ', ' + text_style[1] + ' ' + str(font_size)
+
+
+def get_font_description(text_style, check_nt=False):
+    fnt_descr = get_font_description_string(text_style, check_nt)
     return _libpango.create_font_description(fnt_descr)
 
 
-def set_layout(text, width, text_style, markup, layout=PANGO_LAYOUT):
+def set_layout(text, width, text_style, markup, layout=None):
+    layout = get_layout(layout)
     if not width == -1:
         width *= PANGO_UNITS
     _libpango.set_layout_width(layout, width)
@@ -78,7 +109,8 @@ def set_layout(text, width, text_style, markup, layout=PANGO_LAYOUT):
 
 
 def set_glyph_layout(text, width, text_style, markup, text_range=None,
-                     check_nt=False, layout=PANGO_LAYOUT):
+                     check_nt=False, layout=None):
+    layout = get_layout(layout)
     text_range = text_range or []
     if not width == -1:
         width *= PANGO_UNITS
@@ -91,26 +123,42 @@ def set_glyph_layout(text, width, text_style, markup, text_range=None,
     return vpos
 
 
-def layout_path(ctx=CTX, layout=PANGO_LAYOUT):
-    _libpango.layout_path(ctx, layout)
+def get_glyph_key(text, width, text_style, markup, text_range=None,
+                  check_nt=False):
+    """Returns glyph outline cache key and vertical position shift
+    for glyph markup.
+    """
+    markuped_text, vpos = apply_glyph_markup(text, text_range or [],
+                                             markup, check_nt)
+    fnt_descr = get_font_description_string(text_style, check_nt)
+    return (fnt_descr, markuped_text, width, text_style[3]), vpos
+
+
+def layout_path(ctx=None, layout=None):
+    _libpango.layout_path(ctx or get_context()[0], get_layout(layout))
+
+
+def get_line_positions(layout=None):
+    return _libpango.get_layout_line_positions(get_layout(layout))
 
 
-def get_line_positions(layout=PANGO_LAYOUT):
-    return _libpango.get_layout_line_positions(layout)
+def get_char_positions(size, layout=None):
+    return _libpango.get_layout_char_positions(get_layout(layout), size)
 
 
-def get_char_positions(size, layout=PANGO_LAYOUT):
-    return _libpango.get_layout_char_positions(layout, size)
+def get_cluster_positions(size, layout=None):
+    return _libpango.get_layout_cluster_positions(get_layout(layout), size)
 
 
-def get_cluster_positions(size, layout=PANGO_LAYOUT):
-    return _libpango.get_layout_cluster_positions(layout, size)
+def get_layout_glyphs(ctx=None, layout=None):
+    return _libpango.get_layout_glyphs(ctx or get_context()[0],
+                                       get_layout(layout))
 
 
-def get_layout_size(layout=PANGO_LAYOUT):
-    return _libpango.get_layout_pixel_size(layout)
+def get_layout_size(layout=None):
+    return _libpango.get_layout_pixel_size(get_layout(layout))
 
 
-def get_layout_bbox(layout=PANGO_LAYOUT):
+def get_layout_bbox(layout=None):
     w, h = get_layout_size(layout)
     return [0.0, 0.0, float(w), float(-h)]
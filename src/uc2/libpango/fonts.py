@@ -16,15 +16,48 @@
 #  along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 
+import atexit
 import cgi
-import string
+import json
+import logging
+import os
+import threading
 
 import _libpango
 
-from core import PANGO_LAYOUT
+import uc2
+from core import get_layout
+
+LOG = logging.getLogger(__name__)
 
 FAMILIES_LIST = []
 FAMILIES_DICT = {}
+FAMILIES_LOWER = {}
+FONT_INDEX = {'stamp': None, 'families': [], 'faces': {}}
+# Lazily loaded faces are saved into persistent index on exit
+FONT_INDEX_DIRTY = False
+FONTS_LOCK = threading.RLock()
+
+# Directories where fontconfig keeps its caches; their modification times
+# identify installed fonts state for persistent font map index.
+FC_CACHE_DIRS = ['~/.cache/fontconfig', '~/.fontconfig',
+                 '/var/cache/fontconfig', '/usr/lib/fontconfig/cache',
+                 '/usr/local/var/cache/fontconfig']
+# Font directories are checked too as fontconfig caches could be
+# rebuilt lazily after fonts installation.
+FC_FONT_DIRS = ['~/.fonts', '~/.local/share/fonts', '/usr/share/fonts',
+                '/usr/local/share/fonts']
+
+FONT_SUBSTITUTES = {
+    'arial': ['Liberation Sans', 'Arimo', 'DejaVu Sans'],
+    'helvetica': ['Liberation Sans', 'Arimo', 'DejaVu Sans'],
+    'verdana': ['DejaVu Sans'],
+    'times': ['Liberation Serif', 'Tinos', 'DejaVu Serif'],
+    'times new roman': ['Liberation Serif', 'Tinos', 'DejaVu Serif'],
+    'georgia': ['DejaVu Serif'],
+    'courier': ['Liberation Mono', 'Cousine', 'DejaVu Sans Mono'],
+    'courier new': ['Liberation Mono', 'Cousine', 'DejaVu Sans Mono'],
+}
 
 
 def bbox_size(bbox):
@@ -34,37 +67,213 @@ def bbox_size(bbox):
     return w, h
 
 
-def update_fonts():
+# ---Font map index
+
+def get_fontconfig_stamp():
+    stamp = [_libpango.get_version()]
+    fc_dirs = [os.path.expanduser(item) for item in FC_CACHE_DIRS]
+    if os.environ.get('XDG_CACHE_HOME'):
+        fc_dirs.append(os.path.join(os.environ['XDG_CACHE_HOME'],
+                                    'fontconfig'))
+    for path in fc_dirs:
+        if os.path.isdir(path):
+            stamp.append([path, int(os.stat(path).st_mtime)])
+    font_dirs = [os.path.expanduser(item) for item in FC_FONT_DIRS]
+    if os.environ.get('XDG_DATA_HOME'):
+        font_dirs.append(os.path.join(os.environ['XDG_DATA_HOME'], 'fonts'))
+    for path in font_dirs:
+        if os.path.isdir(path):
+            stamp.append([path, get_dir_mtime(path)])
+    return stamp
+
+
+def get_dir_mtime(path):
+    # fonts are usually installed into subdirectories,
+    # which do not update mtime of parent ones
+    mtime = os.stat(path).st_mtime
+    for root, dirs, _files in os.walk(path):
+        for item in dirs:
+            try:
+                mtime = max(mtime, os.stat(os.path.join(root, item)).st_mtime)
+            except OSError:
+                pass
+    return int(mtime)
+
+
+def get_index_path():
+    appdata = uc2.appdata
+    return getattr(appdata, 'app_font_index', '') if appdata else ''
+
+
+def load_font_index(stamp):
+    path = get_index_path()
+    if not path or not os.path.isfile(path):
+        return False
+    try:
+        with open(path, 'rb') as fileptr:
+            index = json.load(fileptr)
+    except Exception:
+        LOG.warning('Cannot read font map index %s', path)
+        return False
+    if index.get('stamp') != stamp:
+        return False
+    # json provides unicode strings, Pango works with utf-8 ones
+    FONT_INDEX['stamp'] = stamp
+    FONT_INDEX['families'] = [item.encode('utf-8')
+                              for item in index.get('families', [])]
+    FONT_INDEX['faces'] = dict(
+        (key.encode('utf-8'), [item.encode('utf-8') for item in value])
+        for key, value in index.get('faces', {}).items())
+    return True
+
+
+def save_font_index():
+    global FONT_INDEX_DIRTY
+    FONT_INDEX_DIRTY = False
+    path = get_index_path()
+    if not path:
+        return
+    try:
+        tmp_path = '%s.%d.tmp' % (path, os.getpid())
+        with open(tmp_path, 'wb') as fileptr:
+            json.dump(FONT_INDEX, fileptr)
+        os.rename(tmp_path, path)
+    except Exception:
+        LOG.warning('Cannot write font map index %s', path)
+        if os.path.exists(tmp_path):
+            try:
+                os.remove(tmp_path)
+            except OSError:
+                pass
+
+
+def flush_font_index():
+    with FONTS_LOCK:
+        if FONT_INDEX_DIRTY:
+            save_font_index()
+
+
+atexit.register(flush_font_index)
+
+
+def _set_families(families):
     FAMILIES_LIST[:] = []
     FAMILIES_DICT.clear()
-    font_map = _libpango.get_fontmap()
-    for item in font_map:
-        font_name = item[0]
-        font_faces = item[1]
-        if font_faces:
-            FAMILIES_LIST.append(font_name)
-            FAMILIES_DICT[font_name] = list(font_faces)
+    FAMILIES_LOWER.clear()
+    for font_name in families:
+        FAMILIES_LIST.append(font_name)
+        FAMILIES_DICT[font_name] = None
+        FAMILIES_LOWER.setdefault(font_name.lower(), font_name)
     FAMILIES_LIST.sort()
 
 
+def update_fonts(force=False):
+    """Loads font families list from persistent index or from Pango font map.
+    Faces are loaded lazily per family (see get_faces()).
+    """
+    stamp = get_fontconfig_stamp()
+    with FONTS_LOCK:
+        if force or not load_font_index(stamp):
+            FONT_INDEX['stamp'] = stamp
+            FONT_INDEX['families'] = list(_libpango.get_font_families())
+            FONT_INDEX['faces'] = {}
+            save_font_index()
+        _set_families(FONT_INDEX['families'])
+        for font_name, faces in FONT_INDEX['faces'].items():
+            _set_faces(font_name, faces)
+
+
+def _set_faces(font_name, faces):
+    # should be called under FONTS_LOCK
+    if font_name not in FAMILIES_DICT:
+        return
+    if faces:
+        FAMILIES_DICT[font_name] = list(faces)
+    else:
+        # bitmap-only families are not usable for text
+        FAMILIES_LIST.remove(font_name)
+        del FAMILIES_DICT[font_name]
+        if FAMILIES_LOWER.get(font_name.lower()) == font_name:
+            del FAMILIES_LOWER[font_name.lower()]
+
+
+def _load_faces(font_name):
+    global FONT_INDEX_DIRTY
+    with FONTS_LOCK:
+        # family could be loaded (or removed) by another thread
+        if FAMILIES_DICT.get(font_name, []) is not None:
+            return
+        faces = list(_libpango.get_font_faces(font_name) or [])
+        FONT_INDEX['faces'][font_name] = faces
+        FONT_INDEX_DIRTY = True
+        _set_faces(font_name, faces)
+
+
+def _load_all_faces():
+    # whole font map is listed at once instead of per family lookups
+    global FONT_INDEX_DIRTY
+    with FONTS_LOCK:
+        for font_name, faces in _libpango.get_fontmap():
+            if FAMILIES_DICT.get(font_name, []) is not None:
+                continue
+            faces = list(faces or [])
+            FONT_INDEX['faces'][font_name] = faces
+            FONT_INDEX_DIRTY = True
+            _set_faces(font_name, faces)
+        # families missed by Pango font map are not available anymore
+        for font_name in [item for item in FAMILIES_LIST
+                          if FAMILIES_DICT[item] is None]:
+            FONT_INDEX['faces'][font_name] = []
+            _set_faces(font_name, [])
+
+
+def get_faces(font_name):
+    """Returns faces of font family (loads them on first request)
+    or None if family is not available.
+    """
+    if not FAMILIES_LIST:
+        update_fonts()
+    if font_name not in FAMILIES_DICT:
+        return None
+    if FAMILIES_DICT.get(font_name, []) is None:
+        _load_faces(font_name)
+    return FAMILIES_DICT.get(font_name)
+
+
 def get_fonts():
     if not FAMILIES_LIST:
         update_fonts()
+    with FONTS_LOCK:
+        if None in FAMILIES_DICT.values():
+            _load_all_faces()
+        flush_font_index()
     return FAMILIES_LIST, FAMILIES_DICT
 
 
+def _lookup_family(family):
+    if not family:
+        return None
+    if isinstance(family, unicode):
+        family = family.encode('utf-8')
+    if family in FAMILIES_DICT and get_faces(family):
+        return family
+    family = FAMILIES_LOWER.get(family.lower())
+    if family and get_faces(family):
+        return family
+    return None
+
+
 def find_font_family(family=None):
     if not FAMILIES_LIST:
         update_fonts()
-    if not family or family not in FAMILIES_LIST:
-        # TODO: here should be substitution staff
-        if string.capwords(family) in FAMILIES_LIST:
-            family = string.capwords(family)
-        elif string.capwords(family.lower()) in FAMILIES_LIST:
-            family = string.capwords(family.lower())
-        else:
-            family = 'Sans'
-    return family, FAMILIES_DICT[family]
+    font_name = _lookup_family(family)
+    if font_name is None and family:
+        for item in FONT_SUBSTITUTES.get(family.lower(), []):
+            font_name = _lookup_family(item)
+            if font_name:
+                break
+    font_name = font_name or _lookup_family('Sans') or FAMILIES_LIST[0]
+    return font_name, get_faces(font_name)
 
 
 def find_font_and_face(family=None):
@@ -87,8 +296,9 @@ def _set_sample_layout(layout, text, family, fontsize):
 
 
 def get_sample_size(text, family, fontsize):
-    _set_sample_layout(PANGO_LAYOUT, text, family, fontsize)
-    return _libpango.get_layout_pixel_size(PANGO_LAYOUT)
+    layout = get_layout()
+    _set_sample_layout(layout, text, family, fontsize)
+    return _libpango.get_layout_pixel_size(layout)
 
 
 def render_sample(ctx, text, family, fontsize):
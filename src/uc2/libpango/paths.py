@@ -201,6 +201,27 @@ def get_log_layout_data(layout_data, byte_dict, rtl_regs):
     return log_layout_data
 
 
+def get_glyph_cpath(ctx, text, width, text_style, markup, text_range):
+    """Returns glyph outline at layout origin (new cairo path) and
+    vertical position shift. Shaped outlines are taken from glyph cache.
+    """
+    key, vpos = core.get_glyph_key(text, width, text_style, markup,
+                                   text_range, True)
+    cpath = core.GLYPH_CACHE.get(key)
+    if cpath is None:
+        ctx.new_path()
+        ctx.move_to(0, 0)
+        layout = core.create_layout(ctx)
+        core.set_glyph_layout(text, width, text_style, markup,
+                              text_range, True, layout)
+        core.layout_path(ctx, layout)
+        cpath = ctx.copy_path()
+        core.GLYPH_CACHE.put(key, cpath)
+    ctx.new_path()
+    ctx.append_path(cpath)
+    return ctx.copy_path(), vpos
+
+
 def get_glyphs(ctx, layout_data, text, width, text_style, markup):
     glyphs = []
     i = -1
@@ -219,20 +240,15 @@ def get_glyphs(ctx, layout_data, text, width, text_style, markup):
                 glyphs.append(None)
                 continue
 
-        ctx.new_path()
-        ctx.move_to(0, 0)
-        layout = core.create_layout(ctx)
         text_range = [i, i + len(item)]
-        vpos = core.set_glyph_layout(item, width, text_style, markup,
-                                     text_range, True, layout)
+        cpath, vpos = get_glyph_cpath(ctx, item, width, text_style, markup,
+                                      text_range)
         if vpos:
             for index in range(*text_range):
                 x, y, w, h, base_line, byte_index = layout_data[index]
                 dh = (y - base_line) * vpos
                 layout_data[index] = (x, y + dh, w, h,
                                       base_line + dh, byte_index)
-        core.layout_path(ctx, layout)
-        cpath = ctx.copy_path()
         m00 = 1.0
         m11 = -1.0
         if os.name == 'nt':
@@ -264,19 +280,14 @@ def get_rtl_glyphs(ctx, layout_data, log_layout_data, byte_dict, rtl_regs,
             glyphs.append(None)
             continue
 
-        ctx.new_path()
-        ctx.move_to(0, 0)
-        layout = core.create_layout(ctx)
-        vpos = core.set_glyph_layout(txt, width, text_style,
-                                     markup, text_range, True, layout)
+        cpath, vpos = get_glyph_cpath(ctx, txt, width, text_style, markup,
+                                      text_range)
         if vpos:
             for index in range(*text_range):
                 x, y, w, h, base_line, byte_index = log_layout_data[index]
                 dh = (y - base_line) * vpos
                 log_layout_data[index] = (x, y + dh, w, h,
                                           base_line + dh, byte_index)
-        core.layout_path(ctx, layout)
-        cpath = ctx.copy_path()
         m00 = 1.0
         m11 = -1.0
         if os.name == 'nt':
@@ -288,6 +299,101 @@ def get_rtl_glyphs(ctx, layout_data, log_layout_data, byte_dict, rtl_regs,
     return glyphs
 
 
+def utf8_offsets(text):
+    offsets = {}
+    index = 0
+    for char_index, char in enumerate(text):
+        offsets[index] = char_index
+        index += len(char.encode('utf-8'))
+    offsets[index] = len(text)
+    return offsets
+
+
+def has_line_markup(markup, text_range):
+    for mrk in markup:
+        if 'u' in mrk[0] or 's' in mrk[0]:
+            if mrk[1][0] < text_range[1] and text_range[0] < mrk[1][1]:
+                return True
+    return False
+
+
+def get_native_glyphs(ctx, text, width, text_style, markup):
+    """Single pass glyph outlines for ligature mode.
+    Glyphs are shaped once for whole layout (including bidi runs),
+    results are returned in logical order: text sequence, glyphs,
+    layout data and multi-char clusters.
+    """
+    records = core.get_layout_glyphs(ctx)
+    records.sort(key=lambda item: item[5])
+    offsets = utf8_offsets(text)
+    char_positions = None
+
+    text_seq = []
+    glyphs = []
+    layout_data = []
+    clusters = []
+    pos = 0
+    for index, record in enumerate(records):
+        x, y, w, h, base_line, byte_index, run_end, rtl, cpath = record
+        end_byte = run_end
+        if index + 1 < len(records):
+            end_byte = min(end_byte, records[index + 1][5])
+        start, end = offsets[byte_index], offsets[end_byte]
+
+        # chars without glyphs (line breaks)
+        while pos < start:
+            if char_positions is None:
+                char_positions = core.get_char_positions(len(text))
+            pos_byte = len(text[:pos].encode('utf-8'))
+            text_seq.append(text[pos])
+            glyphs.append(None)
+            layout_data.append(tuple(char_positions[pos]) + (pos_byte,))
+            pos += 1
+
+        txt = text[start:end]
+        text_range = [start, end]
+        if end - start > 1:
+            clusters.append((start, end))
+        if markup and has_line_markup(markup, text_range):
+            # underline and strikethrough are drawn by layout only
+            cpath, vpos = get_glyph_cpath(ctx, txt, width, text_style,
+                                          markup, text_range)
+            m00 = 1.0
+            m11 = -1.0
+            if os.name == 'nt':
+                m00 *= 0.1
+                m11 *= 0.1
+            matrix = cairo.Matrix(m00, 0.0, 0.0, m11, x, y)
+            libcairo.apply_cmatrix(cpath, matrix)
+        elif txt in NONPRINTING_CHARS:
+            cpath, vpos = None, 0.0
+        else:
+            vpos = core.get_glyph_key(txt, width, text_style, markup,
+                                      text_range)[1] if markup else 0.0
+        if vpos:
+            dh = (y - base_line) * vpos
+            y += dh
+            base_line += dh
+            if cpath is not None:
+                libcairo.apply_trafo(cpath, [1.0, 0.0, 0.0, 1.0, 0.0, dh])
+        if rtl:
+            x, w = x + w, -w
+        text_seq.append(txt)
+        glyphs.append(cpath)
+        layout_data.append((x, y, w, h, base_line, byte_index))
+        pos = end
+
+    while pos < len(text):
+        if char_positions is None:
+            char_positions = core.get_char_positions(len(text))
+        text_seq.append(text[pos])
+        glyphs.append(None)
+        layout_data.append(tuple(char_positions[pos]) +
+                           (len(text[:pos].encode('utf-8')),))
+        pos += 1
+    return text_seq, glyphs, layout_data, clusters
+
+
 def get_text_paths(orig_text, width, text_style, markup):
     if not orig_text:
         orig_text = NONPRINTING_CHARS[0]
@@ -307,7 +413,14 @@ def get_text_paths(orig_text, width, text_style, markup):
     clusters = []
 
     # Ligature support
-    if text_style[5]:
+    if text_style[5] and os.name != 'nt':
+        data = get_native_glyphs(ctx, orig_text, width, text_style, markup)
+        text, glyphs, layout_data, clusters = data
+        log_layout_data = layout_data
+        if not layout_data:
+            layout_data = core.get_char_positions(len(orig_text))
+
+    elif text_style[5]:
         data = core.get_cluster_positions(len(orig_text))
         layout_data, clusters, clusters_index, bidi_flag, rtl_flag = data
 
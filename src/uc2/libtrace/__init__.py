@@ -15,7 +15,126 @@
 #	You should have received a copy of the GNU Affero General Public License
 #	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+import multiprocessing
+from multiprocessing.pool import ThreadPool
+
 import _libtrace
 
+TURNPOLICY_BLACK = 0
+TURNPOLICY_WHITE = 1
+TURNPOLICY_LEFT = 2
+TURNPOLICY_RIGHT = 3
+TURNPOLICY_MINORITY = 4
+TURNPOLICY_MAJORITY = 5
+TURNPOLICY_RANDOM = 6
+
+DEFAULT_OPTIONS = {
+	'turdsize': 2,
+	'turnpolicy': TURNPOLICY_MINORITY,
+	'alphamax': 1.0,
+	'opticurve': True,
+	'opttolerance': 0.2,
+}
+
 def get_version():
-	return _libtrace.get_libtrace_version().split(' ')[1]
\ No newline at end of file
+	return _libtrace.get_libtrace_version().split(' ')[1]
+
+def trace_buffer(buf, size, low=0, high=128, **kw):
+	"""
+	Traces 8-bit buffer (one byte per pixel, top row first) selecting
+	pixels in [low, high) range. Returns list of closed sk2 paths
+	in pixel coordinates with Y axis directed up.
+	Accepted options: turdsize, turnpolicy, alphamax, opticurve,
+	opttolerance (see potrace documentation).
+	"""
+	opts = dict(DEFAULT_OPTIONS)
+	opts.update(kw)
+	width, height = size
+	return _libtrace.trace_bitmap(buf, width, height, low, high,
+		opts['turdsize'], opts['turnpolicy'], opts['alphamax'],
+		int(opts['opticurve']), opts['opttolerance']) or []
+
+def trace_image(image, threshold=128, **kw):
+	"""
+	Traces dark pixels (below threshold) of PIL image.
+	"""
+	if image.mode != 'L':
+		image = image.convert('L')
+	return trace_buffer(image.tobytes(), image.size, 0, threshold, **kw)
+
+def posterize_image(image, levels):
+	"""
+	Reduces PIL image to 'levels' indexes stored as 8-bit buffer.
+	Grayscale images are posterized, color ones are quantized
+	(raw palette indexes of 'P' image are used, not its luminance).
+	Returns indexed image and list of RGB colors for every index.
+	"""
+	if image.mode in ('1', 'L'):
+		step = 256.0 / levels
+		indexed = image.convert('L').point(
+			lambda v: min(int(v / step), levels - 1))
+		colors = []
+		for index in range(levels):
+			value = int(round(index * 255.0 / (levels - 1)))
+			colors.append((value, value, value))
+		return indexed, colors
+	indexed = image.convert('RGB').quantize(levels)
+	palette = indexed.getpalette()
+	colors = [tuple(palette[i * 3:i * 3 + 3]) for i in range(levels)]
+	return indexed, colors
+
+def get_luminance(color):
+	r, g, b = color[:3]
+	return 0.299 * r + 0.587 * g + 0.114 * b
+
+def trace_levels(image, levels=4, threads=0, skip_background=True, **kw):
+	"""
+	Multi-level (color) tracing. Image is reduced to specified number
+	of levels which are stacked from darkest to lightest one. Every layer
+	covers pixels of its level and of all upper levels, so adjacent layers
+	overlap and no hairline gaps appear between them. Background level
+	(covering most pixels) is placed at the stack bottom and skipped by
+	default. Layers are traced concurrently as potrace runs without GIL,
+	threads=0 means all CPU cores. Returns list of (rgb_color, paths)
+	tuples in stacking order.
+	"""
+	levels = max(2, min(int(levels), 256))
+	indexed, colors = posterize_image(image, levels)
+	size = indexed.size
+
+	histogram = indexed.histogram()[:levels]
+	indexes = [index for index in range(levels) if histogram[index]]
+	indexes.sort(key=lambda index: get_luminance(colors[index]))
+	start = 0
+	if skip_background and len(indexes) > 1:
+		background = histogram.index(max(histogram))
+		indexes.remove(background)
+		indexes.insert(0, background)
+		start = 1
+
+	# pixel values are replaced by stack positions of their levels
+	table = [0] * 256
+	for pos, index in enumerate(indexes):
+		table[index] = pos
+	buf = indexed.tobytes().translate(''.join(map(chr, table)))
+	positions = range(start, len(indexes))
+
+	def trace(pos):
+		return trace_buffer(buf, size, pos, 256, **kw)
+
+	threads = min(threads or multiprocessing.cpu_count(), len(positions))
+	if threads < 2:
+		results = map(trace, positions)
+	else:
+		pool = ThreadPool(threads)
+		try:
+			results = pool.map(trace, positions, 1)
+		finally:
+			pool.close()
+			pool.join()
+	return [(colors[indexes[pos]], paths)
+			for pos, paths in zip(positions, results) if paths]
+
+def paths_to_cpath(paths):
+	from uc2 import libcairo
+	return libcairo.create_cpath(paths)
@@ -17,16 +17,207 @@
  */
 
 #include <Python.h>
+#include <stdlib.h>
+#include <string.h>
 #include <potracelib.h>
 
+#define BM_WORDBITS ((int)(8 * sizeof(potrace_word)))
+#define BM_HIBIT (((potrace_word)1) << (BM_WORDBITS - 1))
+
 static PyObject *
 libtrace_GetVersion (PyObject *self, PyObject *args) {
 	return Py_BuildValue("s", potrace_version());
 }
 
+/* Fills potrace bitmap from 8-bit buffer (one byte per pixel, top row
+ * first). Pixel is set if its value is in [low, high) range, so single
+ * gray level or palette index can be selected for multi-level tracing.
+ * Rows are flipped to get Y axis directed up like in sk2 model.
+ */
+static potrace_bitmap_t *
+new_bitmap(const unsigned char *buf, int width, int height,
+		int low, int high) {
+
+	potrace_bitmap_t *bm;
+	potrace_word *line;
+	const unsigned char *row;
+	int x, y;
+
+	bm = (potrace_bitmap_t *) malloc(sizeof(potrace_bitmap_t));
+	if (bm == NULL) {
+		return NULL;
+	}
+	bm->w = width;
+	bm->h = height;
+	bm->dy = (width + BM_WORDBITS - 1) / BM_WORDBITS;
+	bm->map = (potrace_word *) calloc((size_t)bm->dy * height,
+			sizeof(potrace_word));
+	if (bm->map == NULL) {
+		free(bm);
+		return NULL;
+	}
+
+	for (y = 0; y < height; y++) {
+		row = buf + (size_t)y * width;
+		line = bm->map + (size_t)(height - 1 - y) * bm->dy;
+		for (x = 0; x < width; x++) {
+			if (row[x] >= low && row[x] < high) {
+				line[x / BM_WORDBITS] |= BM_HIBIT >> (x % BM_WORDBITS);
+			}
+		}
+	}
+	return bm;
+}
+
+static void
+free_bitmap(potrace_bitmap_t *bm) {
+	if (bm != NULL) {
+		free(bm->map);
+		free(bm);
+	}
+}
+
+static PyObject *
+get_point(potrace_dpoint_t p) {
+	return Py_BuildValue("[dd]", p.x, p.y);
+}
+
+/* Appends point to the list and releases point reference.
+ * Returns -1 if point is NULL or cannot be appended.
+ */
+static int
+append_point(PyObject *points, PyObject *point) {
+
+	int ret;
+
+	if (point == NULL) {
+		return -1;
+	}
+	ret = PyList_Append(points, point);
+	Py_DECREF(point);
+	return ret;
+}
+
+/* Converts potrace curve into sk2 path: [start, points, CURVE_CLOSED].
+ * Corner segment is represented by two line points.
+ * Returns NULL with exception set on allocation failure.
+ */
+static PyObject *
+get_sk2_path(potrace_curve_t *curve) {
+
+	PyObject *path, *points, *start;
+	int i, ret = 0;
+
+	points = PyList_New(0);
+	if (points == NULL) {
+		return NULL;
+	}
+	for (i = 0; i < curve->n && ret == 0; i++) {
+		if (curve->tag[i] == POTRACE_CORNER) {
+			ret = append_point(points, get_point(curve->c[i][1]));
+			if (ret == 0) {
+				ret = append_point(points, get_point(curve->c[i][2]));
+			}
+		} else {
+			ret = append_point(points, Py_BuildValue("[[dd][dd][dd]i]",
+					curve->c[i][0].x, curve->c[i][0].y,
+					curve->c[i][1].x, curve->c[i][1].y,
+					curve->c[i][2].x, curve->c[i][2].y, 0));
+		}
+	}
+
+	start = ret == 0 ? get_point(curve->c[curve->n - 1][2]) : NULL;
+	if (start == NULL) {
+		Py_DECREF(points);
+		return NULL;
+	}
+	path = Py_BuildValue("[OOi]", start, points, 1);
+	Py_DECREF(start);
+	Py_DECREF(points);
+	return path;
+}
+
+/* trace_bitmap(buffer, width, height, low, high, turdsize, turnpolicy,
+ *              alphamax, opticurve, opttolerance)
+ * Traces pixels of 8-bit buffer having values in [low, high) range.
+ * Returns list of closed sk2 paths in pixel coordinates or None
+ * on tracing error. GIL is released while bitmap is built and traced.
+ */
+static PyObject *
+libtrace_TraceBitmap (PyObject *self, PyObject *args) {
+
+	const unsigned char *buf;
+	int size, width, height, low, high;
+	int turdsize, turnpolicy, opticurve;
+	double alphamax, opttolerance;
+	potrace_param_t *param;
+	potrace_bitmap_t *bm = NULL;
+	potrace_state_t *st = NULL;
+	potrace_path_t *p;
+	PyObject *paths, *path;
+
+	if (!PyArg_ParseTuple(args, "s#iiiiiidid", &buf, &size, &width, &height,
+			&low, &high, &turdsize, &turnpolicy, &alphamax, &opticurve,
+			&opttolerance)) {
+		return NULL;
+	}
+
+	if (width <= 0 || height <= 0 || size / width < height) {
+		PyErr_SetString(PyExc_ValueError, "buffer is smaller than image");
+		return NULL;
+	}
+
+	param = potrace_param_default();
+	if (param == NULL) {
+		return PyErr_NoMemory();
+	}
+	param->turdsize = turdsize;
+	param->turnpolicy = turnpolicy;
+	param->alphamax = alphamax;
+	param->opticurve = opticurve;
+	param->opttolerance = opttolerance;
+
+	Py_BEGIN_ALLOW_THREADS
+	bm = new_bitmap(buf, width, height, low, high);
+	if (bm != NULL) {
+		st = potrace_trace(param, bm);
+	}
+	Py_END_ALLOW_THREADS
+
+	potrace_param_free(param);
+	free_bitmap(bm);
+
+	if (bm == NULL) {
+		return PyErr_NoMemory();
+	}
+	if (st == NULL || st->status != POTRACE_STATUS_OK) {
+		if (st != NULL) {
+			potrace_state_free(st);
+		}
+		Py_INCREF(Py_None);
+		return Py_None;
+	}
+
+	paths = PyList_New(0);
+	for (p = st->plist; p != NULL && paths != NULL; p = p->next) {
+		if (p->curve.n < 1) {
+			continue;
+		}
+		path = get_sk2_path(&p->curve);
+		if (path == NULL || PyList_Append(paths, path) < 0) {
+			Py_CLEAR(paths);
+		}
+		Py_XDECREF(path);
+	}
+	potrace_state_free(st);
+
+	return paths;
+}
+
 static
 PyMethodDef libtrace_methods[] = {
 	{"get_libtrace_version", libtrace_GetVersion, METH_VARARGS},
+	{"trace_bitmap", libtrace_TraceBitmap, METH_VARARGS},
 	{NULL, NULL}
 };
 
@@ -36,6 +36,8 @@ class UCData:
     app_config = ''
     app_config_dir = ''
     app_color_profile_dir = ''
+    app_cms_cache_dir = ''
+    app_font_index = ''
 
     def __init__(self, app, cfgdir='~', check=True):
 
@@ -59,6 +61,13 @@ class UCData:
         if not fsutils.exists(self.app_color_profile_dir):
             fsutils.makedirs(self.app_color_profile_dir)
 
+        # Color transforms cache directory is created on first use
+        # if cms_transform_cache option is enabled
+        self.app_cms_cache_dir = os.path.join(self.app_config_dir, 'cms_cache')
+
+        # Font map index
+        self.app_font_index = os.path.join(self.app_config_dir, 'fonts.idx')
+
         from uc2.cms import libcms
 
         for item in uc2const.COLORSPACES + [uc2const.COLOR_DISPLAY, ]:
@@ -101,6 +110,16 @@ class UCConfig(SerializedConfig):
     cms_proof_for_spot = False
     cms_bpc_flag = False
     cms_bpt_flag = False
+    cms_bitmap_threads = 1  # 0 - use all CPU cores
+    cms_transform_cache = True
+    cms_transform_cache_size = 16  # MiB, 0 - unlimited
+
+    text_shaping_threads = 1  # 0 - use all CPU cores
+    raster_threads = 1  # 0 - use all CPU cores
+
+    magick_memory_limit = 0  # MiB, 0 - ImageMagick default
+    magick_map_limit = 0  # MiB, 0 - ImageMagick default
+    magick_threads = 0  # 0 - ImageMagick default
 
     def __init__(self): pass
 
@@ -0,0 +1,75 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2019 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import json
+import os
+import struct
+
+"""
+Conversion server protocol.
+
+Each message is a fixed header with JSON and payload sizes
+followed by JSON body and optional binary payload:
+
+'!II' json_size, data_size | json body | data
+
+Requests:
+{'cmd': 'ping'}
+{'cmd': 'shutdown'}
+{'cmd': 'convert', 'files': [input, output], 'options': {...}}
+{'cmd': 'convert', 'input_ext': 'svg', 'output_ext': 'pdf',
+ 'options': {...}} + input file content as payload
+
+Response:
+{'status': 0|1, 'messages': [[msg_type, msg], ...]}
++ output file content as payload for streamed convert request
+"""
+
+SOCKET_NAME = 'uc2.sock'
+HEADER = '!II'
+HEADER_SIZE = struct.calcsize(HEADER)
+
+
+def get_socket_path(cfgdir='~'):
+    return os.path.expanduser(os.path.join(cfgdir, '.config', 'uc2',
+                                           SOCKET_NAME))
+
+
+def _recv_exact(sock, size):
+    chunks = []
+    while size:
+        chunk = sock.recv(min(size, 65536))
+        if not chunk:
+            raise IOError('Connection is closed by peer')
+        chunks.append(chunk)
+        size -= len(chunk)
+    return ''.join(chunks)
+
+
+def send_message(sock, body, data=''):
+    body = json.dumps(body)
+    sock.sendall(struct.pack(HEADER, len(body), len(data)) + body)
+    if data:
+        sock.sendall(data)
+
+
+def recv_message(sock):
+    body_size, data_size = struct.unpack(HEADER,
+                                         _recv_exact(sock, HEADER_SIZE))
+    body = json.loads(_recv_exact(sock, body_size))
+    data = _recv_exact(sock, data_size) if data_size else ''
+    return body, data
@@ -0,0 +1,63 @@
+# -*- coding: utf-8 -*-
+#
+#  Copyright (C) 2018 by Ihor E. Novikov
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU Affero General Public License
+#  as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU Affero General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import threading
+from collections import OrderedDict
+
+
+class LRUCache(object):
+    """Bounded thread-safe LRU cache. None values are not stored.
+    Hit/miss/eviction counters survive cache clearing.
+    """
+
+    def __init__(self, size=4096):
+        self.size = size
+        self.items = OrderedDict()
+        self.lock = threading.Lock()
+        self.hits = self.misses = self.evictions = 0
+
+    def get(self, key):
+        with self.lock:
+            value = self.items.pop(key, None)
+            if value is None:
+                self.misses += 1
+                return None
+            self.hits += 1
+            self.items[key] = value
+            return value
+
+    def put(self, key, value):
+        with self.lock:
+            if key in self.items:
+                del self.items[key]
+            elif len(self.items) >= self.size:
+                self.items.popitem(last=False)
+                self.evictions += 1
+            self.items[key] = value
+
+    def clear(self):
+        with self.lock:
+            self.items.clear()
+
+    def reset_stats(self):
+        with self.lock:
+            self.hits = self.misses = self.evictions = 0
+
+    def get_stats(self):
+        with self.lock:
+            return {'size': len(self.items), 'hits': self.hits,
+                    'misses': self.misses, 'evictions': self.evictions}
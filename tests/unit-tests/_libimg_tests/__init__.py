@@ -111,5 +111,87 @@ class TestCoreLibImgFunctions(unittest.TestCase):
 		blob=_libimg.get_image_blob(wand)
 		self.assertEqual(False, blob=='')
 
+	def test09_image_profile(self):
+		path = os.path.join(_pkgdir, 'img_data', 'type_cmyk.tif')
+		wand = _libimg.new_image()
+		self.assertEqual(1, _libimg.load_image(wand, path))
+		profile = _libimg.get_image_profile(wand, 'icc')
+		self.assertNotEqual(None, profile)
+		self.assertEqual('acsp', profile[36:40])
 
+		path = os.path.join(_pkgdir, 'img_data', 'white_100x100.png')
+		wand = _libimg.new_image()
+		self.assertEqual(1, _libimg.load_image(wand, path))
+		self.assertEqual(None, _libimg.get_image_profile(wand, 'icc'))
 
+	def test10_exported_image_profile(self):
+		from uc2.libimg import magickwand
+		path = os.path.join(_pkgdir, 'img_data', 'type_cmyk.tif')
+		wand = _libimg.new_image()
+		_libimg.load_image(wand, path)
+		profile = _libimg.get_image_profile(wand, 'icc')
+		base, alpha = magickwand.process_image(open(path, 'rb').read())
+		self.assertEqual('CMYK', base.mode)
+		self.assertEqual(profile, base.info.get('icc_profile'))
+
+		path = os.path.join(_pkgdir, 'img_data', 'white_100x100.png')
+		base, alpha = magickwand.process_image(open(path, 'rb').read())
+		self.assertFalse('icc_profile' in base.info)
+
+	def test11_session_reuse(self):
+		from uc2.libimg.magickwand import SESSION
+		path = os.path.join(_pkgdir, 'img_data', 'white_100x100.png')
+		wand = SESSION.get_wand()
+		self.assertTrue(SESSION.active)
+		self.assertEqual(1, _libimg.load_image(wand, path))
+		SESSION.release_wand(wand)
+		self.assertTrue(wand is SESSION.get_wand())
+		SESSION.release_wand(wand)
+
+		# environment terminated behind the session
+		_libimg.terminate_magick()
+		self.assertFalse(SESSION.active)
+		self.assertEqual([], SESSION.wands)
+		new_wand = SESSION.get_wand()
+		self.assertTrue(SESSION.active)
+		self.assertFalse(new_wand is wand)
+		self.assertEqual(1, _libimg.load_image(new_wand, path))
+
+		# wand of restarted environment is not pooled
+		_libimg.terminate_magick()
+		_libimg.init_magick()
+		SESSION.release_wand(new_wand)
+		self.assertEqual([], SESSION.wands)
+
+		SESSION.stop()
+		self.assertFalse(SESSION.active)
+		self.assertEqual(0, _libimg.is_magick_active())
+
+	def test12_resource_limits(self):
+		from uc2.libimg.magickwand import SESSION
+		memory = _libimg.get_resource_limit('memory')
+		threads = _libimg.get_resource_limit('thread')
+		try:
+			SESSION.apply_limits(memory=64, mmap=0, threads=1)
+			self.assertEqual(64 * 1024 * 1024,
+							_libimg.get_resource_limit('memory'))
+			self.assertEqual(1, _libimg.get_resource_limit('thread'))
+		finally:
+			_libimg.set_resource_limit('memory', memory)
+			_libimg.set_resource_limit('thread', threads)
+		self.assertEqual(0, _libimg.set_resource_limit('unknown', 1))
+		self.assertEqual(None, _libimg.get_resource_limit('unknown'))
+
+	def test13_transformed_image_profile(self):
+		from uc2.libimg import magickwand
+		path = os.path.join(_pkgdir, 'img_data', 'type_cmyk.tif')
+		wand = _libimg.new_image()
+		_libimg.load_image(wand, path)
+		profile = _libimg.get_image_profile(wand, 'icc')
+		colorspace = _libimg.get_colorspace(wand)
+		self.assertTrue(magickwand.export_image(wand, 'CMYK'))
+		self.assertEqual(profile,
+						magickwand.get_export_profile(wand, colorspace))
+		self.assertTrue(magickwand.export_image(wand, 'RGB'))
+		self.assertEqual(None,
+						magickwand.get_export_profile(wand, colorspace))
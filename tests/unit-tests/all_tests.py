@@ -19,10 +19,22 @@ import unittest
 import cms_testsuite
 import _libimg_testsuite
 import image_testsuite
+import contour_testsuite
+import libgeom_testsuite
+import libpango_testsuite
+import libtrace_testsuite
+import png_testsuite
+import translate_testsuite
 
 suite = unittest.TestSuite()
 suite.addTest(cms_testsuite.get_suite())
 suite.addTest(_libimg_testsuite.get_suite())
 suite.addTest(image_testsuite.get_suite())
+suite.addTest(contour_testsuite.get_suite())
+suite.addTest(libgeom_testsuite.get_suite())
+suite.addTest(libpango_testsuite.get_suite())
+suite.addTest(libtrace_testsuite.get_suite())
+suite.addTest(png_testsuite.get_suite())
+suite.addTest(translate_testsuite.get_suite())
 
 unittest.TextTestRunner(verbosity=2).run(suite)
@@ -453,3 +453,138 @@ class TestCmsFunctions(unittest.TestCase):
 			self.fail()
 
 
+
+	#---Buffer transform related tests
+	def test34_do_transform_buffer(self):
+		rgb = bytearray([0, 0, 0, 0, 255, 255, 255, 0, 100, 190, 150, 0])
+		cmyk = bytearray(len(rgb))
+		self.assertEqual(3, libcms.cms_do_transform_buffer(self.transform,
+														rgb, cmyk))
+		for index in range(3):
+			out = [0, 0, 0, 0]
+			libcms.cms_do_transform(self.transform,
+								list(rgb[index * 4:index * 4 + 4]), out)
+			self.assertEqual(out, list(cmyk[index * 4:index * 4 + 4]))
+
+	def test35_do_transform_buffer_with_short_output_buffer(self):
+		rgb = bytearray(8)
+		cmyk = bytearray(4)
+		try:
+			libcms.cms_do_transform_buffer(self.transform, rgb, cmyk)
+		except libcms.CmsError:
+			return
+		self.fail()
+
+	def test36_do_threaded_bitmap_transform(self):
+		inImage = Image.open(get_filepath('color100x100.png'))
+		outImage = libcms.cms_do_bitmap_transform(self.transform2,
+							inImage, uc2const.TYPE_RGB_8, uc2const.TYPE_CMYK_8)
+		outImage2 = libcms.cms_do_bitmap_transform(self.transform2,
+							inImage, uc2const.TYPE_RGB_8, uc2const.TYPE_CMYK_8, 4)
+		self.assertEqual(outImage.tostring(), outImage2.tostring())
+
+	def test37_devicelink_transform(self):
+		data = libcms.cms_transform_to_devicelink(self.transform)
+		devicelink = libcms.cms_open_profile_from_string(data)
+		transform = libcms.cms_create_devicelink_transform(devicelink,
+						uc2const.TYPE_RGBA_8, uc2const.TYPE_CMYK_8)
+		rgb = [100, 190, 150, 0]
+		cmyk = [0, 0, 0, 0]
+		cmyk2 = [0, 0, 0, 0]
+		libcms.cms_do_transform(self.transform, rgb, cmyk)
+		libcms.cms_do_transform(transform, rgb, cmyk2)
+		for index in range(4):
+			self.assertTrue(abs(cmyk[index] - cmyk2[index]) < 3)
+
+	def test38_do_bitmap_transform_inplace(self):
+		transform = libcms.cms_create_transform(self.inProfile,
+						uc2const.TYPE_RGB_8, self.inProfile, uc2const.TYPE_RGB_8,
+						uc2const.INTENT_PERCEPTUAL, 0)
+		inImage = Image.open(get_filepath('color100x100.png'))
+		outImage = libcms.cms_do_bitmap_transform(transform,
+							inImage, uc2const.TYPE_RGB_8, uc2const.TYPE_RGB_8)
+		ret = libcms.cms_do_bitmap_transform_inplace(transform, inImage)
+		self.assertTrue(ret is inImage)
+		self.assertEqual(outImage.tostring(), inImage.tostring())
+		try:
+			libcms.cms_do_bitmap_transform_inplace(self.transform2, inImage)
+		except libcms.CmsError:
+			return
+		self.fail()
+
+	def test39_cached_transform_consistency(self):
+		import tempfile, shutil
+		from uc2.cms import ColorManager
+		cache_dir = tempfile.mkdtemp()
+		colors = [[uc2const.COLOR_RGB, [0.4, 0.75, 0.6], 1.0, ''],
+				[uc2const.COLOR_RGB, [0.9, 0.1, 0.3], 1.0, '']]
+		try:
+			results = []
+			stats = []
+			# cold cache, then warm cache
+			for index in range(2):
+				cm = ColorManager()
+				cm.transform_cache_dir = cache_dir
+				cm.clear_transforms()
+				results.append([cm.get_cmyk_color(color) for color in colors])
+				stats.append(dict(cm.transform_cache_stats))
+			self.assertTrue(os.listdir(cache_dir))
+			self.assertEqual(results[0], results[1])
+			self.assertEqual(0, stats[0]['hits'])
+			self.assertTrue(stats[0]['misses'] > 0)
+			self.assertEqual({'hits': stats[0]['misses'], 'misses': 0},
+							stats[1])
+		finally:
+			shutil.rmtree(cache_dir)
+
+	def test40_do_float_transform_buffer(self):
+		from array import array
+		transform = libcms.cms_create_float_transform(self.inProfile,
+						uc2const.TYPE_RGB_8, self.outProfile, uc2const.TYPE_CMYK_8)
+		rgb = array('d', [0.0, 0.0, 0.0, 0.0, 1.0, 1.0, 1.0, 0.0,
+						0.392, 0.745, 0.588, 0.0, 0.3921, 0.7451, 0.5881, 0.0])
+		cmyk = array('d', [0.0] * len(rgb))
+		self.assertEqual(4, libcms.cms_do_transform_buffer2(transform,
+														rgb, cmyk))
+		self.assertEqual(0.392, rgb[8])
+		for index in range(4):
+			out = [0, 0, 0, 0]
+			libcms.cms_do_transform(self.transform,
+						[int(round(value * 255))
+						for value in rgb[index * 4:index * 4 + 4]], out)
+			for value, expected in zip(cmyk[index * 4:index * 4 + 4], out):
+				self.assertTrue(abs(value - expected / 255.0) < 3.0 / 255)
+		# close colors are not merged by 8-bit quantization
+		self.assertNotEqual(cmyk[8:12], cmyk[12:16])
+
+	def test41_do_float_transform_buffer_errors(self):
+		from array import array
+		transform = libcms.cms_create_float_transform(self.inProfile,
+						uc2const.TYPE_RGB_8, self.outProfile, uc2const.TYPE_CMYK_8)
+		rgb = array('d', [0.5] * 8)
+		self.assertRaises(libcms.CmsError, libcms.cms_do_transform_buffer2,
+						transform, rgb, array('d', [0.0] * 4))
+		self.assertRaises(libcms.CmsError, libcms.cms_do_transform_buffer2,
+						self.transform, rgb, array('d', [0.0] * 8))
+
+	def test42_transform_cache_pruning(self):
+		import tempfile, shutil
+		from uc2.cms import ColorManager
+		cache_dir = tempfile.mkdtemp()
+		try:
+			for index, name in enumerate(['a.icc', 'b.icc', 'c.icc', 'd.tmp']):
+				path = os.path.join(cache_dir, name)
+				with open(path, 'wb') as fileptr:
+					fileptr.write('0' * 600)
+				os.utime(path, (1000 * (3 - index), 1000 * (3 - index)))
+			cm = ColorManager()
+			cm.transform_cache_dir = cache_dir
+			cm.transform_cache_size = 1500 / 1024.0 / 1024.0
+			cm.prune_transform_cache()
+			self.assertEqual(['a.icc', 'b.icc', 'd.tmp'],
+							sorted(os.listdir(cache_dir)))
+			cm.transform_cache_size = 0
+			cm.prune_transform_cache()
+			self.assertEqual(3, len(os.listdir(cache_dir)))
+		finally:
+			shutil.rmtree(cache_dir)
@@ -0,0 +1,111 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2018 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest, random
+from copy import deepcopy
+
+from uc2 import libcairo, sk2const
+from uc2.libgeom import contour
+
+JOINS = [sk2const.JOIN_MITER, sk2const.JOIN_ROUND, sk2const.JOIN_BEVEL]
+CAPS = [sk2const.CAP_BUTT, sk2const.CAP_ROUND, sk2const.CAP_SQUARE]
+
+def get_reference(path, radius, linejoin, captype, miter_limit):
+	fw, bw = contour.create_stroke_outline(deepcopy(path), radius,
+										linejoin, captype, miter_limit)
+	if path[2] == sk2const.CURVE_CLOSED:
+		return [contour.make_path(fw), contour.make_path(bw)]
+	return [contour.make_path(fw + bw)]
+
+class TestContourFunctions(unittest.TestCase):
+
+	def setUp(self):
+		self.rnd = random.Random(1)
+
+	def tearDown(self):
+		pass
+
+	def get_point(self):
+		return [self.rnd.uniform(0.0, 200.0), self.rnd.uniform(0.0, 200.0)]
+
+	def get_path(self):
+		start = self.get_point()
+		points = []
+		for i in range(self.rnd.randint(1, 6)):
+			if self.rnd.random() < 0.5:
+				points.append(self.get_point())
+			else:
+				points.append([self.get_point(), self.get_point(),
+							self.get_point(), sk2const.NODE_CUSP])
+		closed = self.rnd.choice([sk2const.CURVE_OPENED,
+								sk2const.CURVE_CLOSED])
+		if closed:
+			points.append([] + start)
+		return [start, points, closed]
+
+	def assertPointsEqual(self, expected, result):
+		if isinstance(expected, list):
+			self.assertEqual(len(expected), len(result))
+			for item1, item2 in zip(expected, result):
+				self.assertPointsEqual(item1, item2)
+		else:
+			self.assertAlmostEqual(expected, result, 6)
+
+	def test01_stroke_outline(self):
+		for i in range(100):
+			path = self.get_path()
+			radius = self.rnd.choice([0.5, 2.0, 20.0])
+			for linejoin in JOINS:
+				for captype in CAPS:
+					try:
+						expected = get_reference(path, radius, linejoin,
+											captype, contour.MITER_LIMIT)
+					except (ZeroDivisionError, IndexError):
+						# Python code fails on some degenerated joins
+						continue
+					result = libcairo.stroke_paths([path, ], radius, linejoin,
+											captype, contour.MITER_LIMIT)
+					self.assertPointsEqual(expected, result[0])
+
+	def test02_miter_limit(self):
+		path = [[0.0, 0.0], [[100.0, 0.0], [0.0, 5.0]], sk2const.CURVE_OPENED]
+		for miter_limit in [1.0, 2.0, contour.MITER_LIMIT, 100.0]:
+			expected = get_reference(path, 2.0, sk2const.JOIN_MITER,
+									sk2const.CAP_BUTT, miter_limit)
+			result = libcairo.stroke_paths([path, ], 2.0, sk2const.JOIN_MITER,
+										sk2const.CAP_BUTT, miter_limit)
+			self.assertPointsEqual(expected, result[0])
+
+	def test03_many_paths(self):
+		paths = [self.get_path() for i in range(20)]
+		result = libcairo.stroke_paths(paths, 2.0, sk2const.JOIN_ROUND,
+									sk2const.CAP_ROUND, contour.MITER_LIMIT)
+		self.assertEqual(len(paths), len(result))
+		for path, outline in zip(paths, result):
+			expected = get_reference(path, 2.0, sk2const.JOIN_ROUND,
+									sk2const.CAP_ROUND, contour.MITER_LIMIT)
+			self.assertPointsEqual(expected, outline)
+
+	def test04_invalid_args(self):
+		path = [[0.0, 0.0], [[10.0, 0.0], ], sk2const.CURVE_OPENED]
+		self.assertRaises(ValueError, libcairo.stroke_paths, [path, ], 1.0,
+						5, sk2const.CAP_BUTT, contour.MITER_LIMIT)
+		self.assertRaises(ValueError, libcairo.stroke_paths, [path, ], 1.0,
+						sk2const.JOIN_MITER, 0, contour.MITER_LIMIT)
+		self.assertRaises(TypeError, libcairo.stroke_paths, [[1.0], ], 1.0,
+						sk2const.JOIN_MITER, sk2const.CAP_BUTT,
+						contour.MITER_LIMIT)
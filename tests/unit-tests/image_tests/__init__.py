@@ -16,6 +16,8 @@
 #	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import unittest, os, shutil
+from base64 import b64encode
+from cStringIO import StringIO
 from PIL import Image
 
 
@@ -87,3 +89,80 @@ class TestImageFunctions(unittest.TestCase):
 			except:
 				result = False
 			self.assertNotEquals(True, result)
+
+
+def get_image_str(fmt, mode='RGB', **kw):
+	fileptr = StringIO()
+	Image.new(mode, (4, 3), 'red').save(fileptr, fmt, **kw)
+	return fileptr.getvalue()
+
+
+class TestImageHandler(unittest.TestCase):
+
+	def setUp(self):
+		from uc2.formats.sk2 import sk2_config, sk2_model
+		self.pixmap = sk2_model.Pixmap(sk2_config.SK2_Config())
+
+	def tearDown(self):pass
+
+	def load(self, image_str):
+		# cms is not required for images kept encoded
+		self.pixmap.handler.load_from_fileptr(None, StringIO(image_str))
+
+	def test01_lazy_decoding(self):
+		content = get_image_str('PNG')
+		handler = self.pixmap.handler
+		self.load(content)
+		self.assertFalse(handler.is_decoded())
+		self.assertEqual((4, 3), handler.get_size())
+		self.assertEqual('RGB', handler.get_mode())
+		self.assertEqual(('PNG', content), handler.get_encoded_bitmap())
+		self.assertEqual(content, handler.get_bitmap_str())
+		self.assertEqual(None, handler.cdata)
+
+		self.assertEqual((4, 3), handler.bitmap.size)
+		self.assertTrue(handler.is_decoded())
+		self.assertEqual(('PNG', content), handler.get_encoded_bitmap())
+
+		handler.bitmap = handler.bitmap.copy()
+		self.assertEqual((None, None), handler.get_encoded_bitmap())
+
+	def test02_not_passthrough_images(self):
+		handler = self.pixmap.handler
+		image = Image.open(StringIO(get_image_str('PNG', 'P',
+												transparency=0)))
+		self.assertFalse(handler._is_passthrough(image))
+		image = Image.open(StringIO(get_image_str('TIFF')))
+		self.assertFalse(handler._is_passthrough(image))
+
+	def test03_pdf_passthrough(self):
+		from uc2 import uc2const
+		from uc2.formats.pdf.pdfgen import PDFGenerator
+		content = get_image_str('JPEG')
+		self.load(content)
+		pdfgen = PDFGenerator(StringIO(), None)
+		self.assertTrue(pdfgen.can_embed_encoded(self.pixmap))
+		pdfgen.draw_encoded_image(content)
+		self.assertFalse(self.pixmap.handler.is_decoded())
+
+		pdfgen.set_colorspace(uc2const.COLOR_CMYK)
+		self.assertFalse(pdfgen.can_embed_encoded(self.pixmap))
+		pdfgen.set_colorspace()
+		self.load(get_image_str('PNG'))
+		self.assertFalse(pdfgen.can_embed_encoded(self.pixmap))
+
+	def test04_svg_passthrough(self):
+		from uc2.formats.svg import svg_utils
+		from uc2.formats.svg.svg_translators import SK2_to_SVG_Translator
+		translator = SK2_to_SVG_Translator()
+		translator.trafo = [1.0, 0.0, 0.0, 1.0, 0.0, 0.0]
+		for fmt, mime in (('PNG', 'image/png'), ('JPEG', 'image/jpeg')):
+			content = get_image_str(fmt)
+			self.load(content)
+			parent = svg_utils.create_xmlobj('g')
+			translator.translate_pixmap(parent, self.pixmap)
+			href = 'data:%s;base64,%s' % (mime, b64encode(content))
+			self.assertEqual(href, parent.childs[-1].attrs['xlink:href'])
+			self.assertEqual(str(self.pixmap.get_size()[1]),
+							parent.childs[-1].attrs['height'])
+			self.assertFalse(self.pixmap.handler.is_decoded())
@@ -21,6 +21,7 @@ import image_tests
 def get_suite():
 	suite = unittest.TestSuite()
 	suite.addTest(unittest.makeSuite(image_tests.TestImageFunctions))
+	suite.addTest(unittest.makeSuite(image_tests.TestImageHandler))
 	return suite
 
 
@@ -0,0 +1,416 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2018 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest, math, random
+import cairo
+from copy import deepcopy
+
+from uc2 import libcairo, sk2const
+from uc2.libgeom import bezier_ops, flattering, objs, shaping
+from uc2.libgeom.packed import PackedPaths
+
+# max distance between sk2 circle bezier approximation and true circle
+CIRCLE_ERROR = 0.0003
+
+class CurveStub:
+
+	def __init__(self, paths, trafo):
+		self.paths = paths
+		self.trafo = trafo
+
+
+class TestFlatteningFunctions(unittest.TestCase):
+
+	def setUp(self):
+		pass
+
+	def tearDown(self):
+		pass
+
+	def get_circle_error(self, paths, center, radius):
+		error = 0.0
+		for path in paths:
+			points = [path[0], ] + path[1]
+			for p0, p1 in zip(points[:-1], points[1:]):
+				for point in (p1, [(p0[0] + p1[0]) / 2.0,
+								(p0[1] + p1[1]) / 2.0]):
+					dist = math.hypot(point[0] - center[0],
+									point[1] - center[1])
+					error = max(error, abs(dist - radius))
+		return error
+
+	def test01_scaled_circle(self):
+		paths = objs.get_circle_paths(0.0, 0.0, sk2const.ARC_CHORD)
+		for radius in [0.5, 10.0, 100.0, 1000.0]:
+			trafo = [2.0 * radius, 0.0, 0.0, 2.0 * radius, 10.0, 20.0]
+			center = [radius + 10.0, radius + 20.0]
+			for tolerance in [0.01, 0.1, 1.0]:
+				result = flattering.get_flattened_paths(
+					CurveStub(paths, trafo), tolerance=tolerance)
+				error = self.get_circle_error(result, center, radius)
+				self.assertTrue(error <= tolerance + CIRCLE_ERROR * radius)
+
+	def test02_extra_trafo(self):
+		paths = objs.get_circle_paths(0.0, 0.0, sk2const.ARC_CHORD)
+		curve = CurveStub(paths, [1.0, 0.0, 0.0, 1.0, 0.0, 0.0])
+		result = flattering.get_flattened_paths(
+			curve, [100.0, 0.0, 0.0, 100.0, 0.0, 0.0], 0.1)
+		error = self.get_circle_error(result, [50.0, 50.0], 50.0)
+		self.assertTrue(error <= 0.1 + CIRCLE_ERROR * 50.0)
+		self.assertTrue(len(result[0][1]) > 16)
+
+	def test03_line_points(self):
+		path = [[0.0, 0.0], [[1.0, 0.0], [1.0, 1.0]], sk2const.CURVE_CLOSED]
+		result = flattering.get_flattened_paths(
+			CurveStub([path, ], [2.0, 0.0, 0.0, 3.0, 1.0, 1.0]))
+		self.assertEqual([[[1.0, 1.0], [[3.0, 1.0], [3.0, 4.0], [1.0, 1.0]],
+						sk2const.CURVE_CLOSED]], result)
+
+
+class CpathStub:
+
+	def __init__(self, paths):
+		self.paths = paths
+
+	def get_cpaths(self):
+		return libcairo.create_cpath(self.paths)
+
+
+class TestSegmentGrid(unittest.TestCase):
+
+	def setUp(self):
+		# open "L" path, its implicit closing segment is the diagonal
+		self.path = [[0.0, 0.0], [[100.0, 0.0], [100.0, 100.0]],
+					sk2const.CURVE_OPENED]
+		self.polyline = [self.path[0], ] + self.path[1]
+
+	def tearDown(self):
+		pass
+
+	def test01_open_polyline_outline(self):
+		points = [[50.0, 0.5], [99.5, 50.0], [50.0, 50.0], [50.5, 49.5],
+				[50.0, 10.0]]
+		grid = libcairo.create_segment_grid([self.polyline, ],
+										[sk2const.CURVE_OPENED, ])
+		self.assertEqual([True, True, False, False, False],
+						libcairo.check_points_on_outline(grid, points, 1.0))
+		grid = libcairo.create_segment_grid([self.polyline, ])
+		self.assertEqual([True, True, True, True, False],
+						libcairo.check_points_on_outline(grid, points, 1.0))
+
+	def test02_open_polyline_inside(self):
+		points = [[60.0, 20.0], [20.0, 60.0], [45.0, 46.0]]
+		for closed in (None, [sk2const.CURVE_OPENED, ]):
+			grid = libcairo.create_segment_grid([self.polyline, ], closed)
+			self.assertEqual([True, False, False],
+							libcairo.check_points_inside(grid, points))
+		# outline band follows real segments only
+		grid = libcairo.create_segment_grid([self.polyline, ],
+										[sk2const.CURVE_OPENED, ])
+		self.assertEqual([True, False, False],
+						libcairo.check_points_inside(grid, points, tolerance=1.0))
+		grid = libcairo.create_segment_grid([self.polyline, ])
+		self.assertEqual([True, False, True],
+						libcairo.check_points_inside(grid, points, tolerance=1.0))
+
+	def test03_closed_flags_number(self):
+		self.assertRaises(ValueError, libcairo.create_segment_grid,
+						[self.polyline, ], [1, 0])
+
+	def test04_stroke_hit_surface(self):
+		width = 4.04
+		stroke_style = [0, width, [], [], sk2const.CAP_ROUND,
+					sk2const.JOIN_ROUND, 10.0]
+		obj = CpathStub([self.path, ])
+		cpath = libcairo.get_flattened_cpath(obj.get_cpaths(),
+											shaping.FLAT_TOLERANCE)
+		polylines = []
+		closed = []
+		for path in libcairo.get_path_from_cpath(cpath):
+			polylines.append([path[0], ] + path[1])
+			closed.append(path[2])
+		grid = libcairo.create_segment_grid(polylines, closed)
+		points = [[50.0, 1.0], [50.0, -1.5], [101.0, 50.0], [50.0, 50.0],
+				[30.0, 30.5], [70.0, 69.0], [50.0, 10.0], [-1.0, 0.0],
+				[100.0, 101.0], [20.0, 80.0]]
+		surface = shaping.StrokeHitSurface(obj, stroke_style)
+		expected = [surface.check_point(point) for point in points]
+		result = libcairo.check_points_on_outline(grid, points,
+												(width - .04) / 2.0)
+		self.assertEqual(expected, result)
+		self.assertFalse(result[3])
+
+	def test05_stroke_caps_and_joins(self):
+		width = 4.04
+		# outside of round join, but inside of miter corner
+		points = [[101.5, -1.5], [50.0, 1.0], [50.0, 10.0]]
+		for cap, join in ((sk2const.CAP_ROUND, sk2const.JOIN_MITER),
+						(sk2const.CAP_BUTT, sk2const.JOIN_ROUND),
+						(sk2const.CAP_ROUND, sk2const.JOIN_ROUND)):
+			stroke_style = [0, width, [], [], cap, join, 10.0]
+			obj = shaping.CurveObject([deepcopy(self.path), ], 0,
+									stroke_style)
+			surface = shaping.StrokeHitSurface(obj, stroke_style)
+			expected = [surface.check_point(point) for point in points]
+			self.assertEqual(expected, obj.are_points_on_stroke(points))
+			self.assertEqual(join == sk2const.JOIN_MITER, expected[0])
+
+
+class TestPackedPaths(unittest.TestCase):
+
+	def setUp(self):
+		self.paths = [
+			[[10.0, 20.0], [[50.0, 20.0],
+				[[60.0, -10.0], [90.0, 40.0], [70.0, 60.0],
+				sk2const.NODE_SMOOTH],
+				[20.0, 60.0]], sk2const.CURVE_CLOSED],
+			[[0.0, 0.0], [
+				[[5.0, 30.0], [-20.0, 40.0], [-10.0, 80.0],
+				sk2const.NODE_SYMMETRICAL],
+				[[0.0, 100.0], [30.0, 110.0], [40.0, 90.0],
+				sk2const.NODE_CUSP]], sk2const.CURVE_OPENED],
+		]
+		self.packed = PackedPaths.from_paths(self.paths)
+
+	def tearDown(self):
+		pass
+
+	def get_sampled_bbox(self, paths, steps=1000):
+		xs = []
+		ys = []
+		for path in paths:
+			p0 = path[0]
+			xs.append(p0[0])
+			ys.append(p0[1])
+			for point in path[1]:
+				if len(point) == 2:
+					p0 = point
+					xs.append(p0[0])
+					ys.append(p0[1])
+					continue
+				p1, p2, p3 = point[:3]
+				for i in range(1, steps + 1):
+					t = float(i) / steps
+					s = 1.0 - t
+					a, b, c, d = s * s * s, 3 * s * s * t, 3 * s * t * t, t * t * t
+					xs.append(a * p0[0] + b * p1[0] + c * p2[0] + d * p3[0])
+					ys.append(a * p0[1] + b * p1[1] + c * p2[1] + d * p3[1])
+				p0 = p3
+		return [min(xs), min(ys), max(xs), max(ys)]
+
+	def test01_round_trip(self):
+		self.assertEqual(len(self.paths), len(self.packed))
+		self.assertEqual(self.paths, self.packed.to_paths())
+		self.assertEqual(self.paths, list(self.packed))
+		self.assertEqual(self.paths[1], self.packed[1])
+		self.assertEqual(self.paths[-1:], self.packed[-1:])
+		self.assertTrue(self.packed == self.paths)
+		self.assertEqual(self.packed,
+						PackedPaths.from_paths(self.packed.to_paths()))
+		self.assertEqual(7, self.packed.get_nodes_num())
+
+	def get_reversed_markers(self, path):
+		# reversed segment ending at original curve node takes its marker,
+		# otherwise the marker of the segment itself is kept
+		points = [path[0], ] + path[1]
+		markers = []
+		for j in range(len(points) - 1, 0, -1):
+			if len(points[j]) == 2:
+				markers.append(None)
+			elif len(points[j - 1]) > 2:
+				markers.append(points[j - 1][3])
+			else:
+				markers.append(points[j][3])
+		return markers
+
+	def test02_reversed(self):
+		result = self.packed.reversed().to_paths()
+		expected = []
+		for path in self.paths:
+			start, points, closed = bezier_ops.reverse_path(path)
+			markers = self.get_reversed_markers(path)
+			points = [point if marker is None else point + [marker, ]
+					for point, marker in zip(points, markers)]
+			expected.append([start, points, closed])
+		self.assertEqual(expected, result)
+		self.assertEqual([sk2const.NODE_SYMMETRICAL, sk2const.NODE_SYMMETRICAL],
+						[point[3] for point in result[1][1]])
+
+	def test03_bbox(self):
+		bbox = self.packed.get_bbox()
+		sampled = self.get_sampled_bbox(self.paths)
+		for value, expected in zip(bbox, sampled):
+			self.assertAlmostEqual(expected, value, 2)
+		self.assertEqual([0.0, 0.0, 0.0, 0.0], PackedPaths().get_bbox())
+
+	def test04_str(self):
+		self.assertEqual(str(self.paths), str(self.packed))
+		self.assertEqual(repr(self.paths), repr(self.packed))
+
+	def test05_readonly(self):
+		path = self.packed[0]
+		self.assertRaises(TypeError, path.__setitem__, 2,
+						sk2const.CURVE_OPENED)
+		self.assertRaises(TypeError, path[1].append, [0.0, 0.0])
+		self.assertRaises(TypeError, path[0].__setitem__, 0, 1.0)
+		self.assertRaises(TypeError, path[1][2].__setitem__, 0, 1.0)
+		self.assertRaises(TypeError, path[1][1][0].__setitem__, 0, 1.0)
+		for path in self.packed:
+			self.assertRaises(TypeError, path[1].pop)
+		self.assertEqual(self.paths, self.packed.to_paths())
+
+	def test06_editable_copies(self):
+		paths = self.packed.to_paths()
+		paths[0][1].append([10.0, 20.0])
+		paths[1][2] = sk2const.CURVE_CLOSED
+		self.assertEqual(self.paths, self.packed.to_paths())
+		path = deepcopy(self.packed[0])
+		path[1][0][0] = 0.0
+		self.assertEqual(type(path[1][0]), list)
+		self.assertEqual(self.paths[0], self.packed[0])
+		points = [] + self.packed[0][0]
+		points[0] = 1.0
+		self.assertEqual(self.paths[0][0], self.packed[0][0])
+
+	def test07_malformed_points(self):
+		bad_points = [[[], [1.0, 2.0], [3.0, 4.0], sk2const.NODE_CUSP],
+					[[1.0, 2.0], [], [3.0, 4.0], sk2const.NODE_SMOOTH],
+					[[1.0, 2.0], [3.0, 4.0, 5.0], [3.0, 4.0], 0],
+					[[1.0, 2.0], [3.0, 4.0]]]
+		for point in bad_points:
+			paths = [[[0.0, 0.0], [[1.0, 1.0], point, [5.0, 5.0]],
+					sk2const.CURVE_OPENED]]
+			self.assertRaises(ValueError, PackedPaths.from_paths, paths)
+		self.assertRaises(ValueError, PackedPaths.from_paths,
+						[[[], [[1.0, 1.0]], sk2const.CURVE_OPENED]])
+
+	def test08_cdr_curve_import(self):
+		from uc2.formats.cdr.cdr_translators import CDR_to_SK2_Translator
+		from uc2.formats.sk2 import sk2_config
+
+		class CdrCurveStub:
+			style_id = fill_id = outl_id = None
+			trafo = [] + sk2const.NORMAL_TRAFO
+
+		class DocStub:
+			config = sk2_config.SK2_Config()
+
+		class MethodsStub:
+			def append_object(self, obj, parent):
+				parent.append(obj)
+
+		obj = CdrCurveStub()
+		obj.paths = self.packed
+		layer = []
+		translator = CDR_to_SK2_Translator()
+		translator.pdxf_doc = DocStub()
+		translator.methods = MethodsStub()
+		translator.parent_stack = [layer, ]
+		translator.create_curve(obj)
+
+		curve = layer[0]
+		self.assertEqual(self.paths, curve.paths)
+		curve.paths[0][1].append([10.0, 20.0])
+		curve.paths[0][1][1][3] = sk2const.NODE_CUSP
+		curve.paths[1][2] = sk2const.CURVE_CLOSED
+		curve.paths[1][0][0] = 5.0
+		curve.paths.append([[0.0, 0.0], [[1.0, 1.0]], sk2const.CURVE_OPENED])
+		self.assertEqual(3, len(curve.paths))
+		self.assertEqual([10.0, 20.0], curve.paths[0][1][-1])
+		self.assertEqual(self.paths, self.packed.to_paths())
+
+	def test09_glyph_cpath(self):
+		surface = cairo.ImageSurface(cairo.FORMAT_RGB24, 10, 10)
+		ctx = cairo.Context(surface)
+		ctx.set_font_size(100.0)
+		ctx.text_path('gO')
+		cpath = ctx.copy_path()
+
+		expected = libcairo.get_path_from_cpath(cpath)
+		packed = libcairo.get_packed_path_from_cpath(cpath)
+		self.assertTrue(len(expected) > 1)
+		self.assertEqual(expected, packed.to_paths())
+		expected = [path for path in expected if path[1]]
+		self.assertEqual(expected, objs.get_paths_from_glyph(cpath))
+		self.assertEqual(expected, objs.get_paths_from_glyph(cpath, True))
+
+
+class TestIntersectPolylines(unittest.TestCase):
+
+	def setUp(self):
+		pass
+
+	def tearDown(self):
+		pass
+
+	def make_polylines(self, num, size, seed, width=200.0):
+		rnd = random.Random(seed)
+		polylines = []
+		for i in range(num):
+			x, y = rnd.uniform(0.0, width), rnd.uniform(0.0, 200.0)
+			polyline = []
+			for j in range(size):
+				x += rnd.uniform(-30.0, 30.0)
+				y += rnd.uniform(-30.0, 30.0)
+				polyline.append(([x, y], float(j) / size))
+			polylines.append(polyline)
+		return polylines
+
+	def check_result(self, polylines1, polylines2, skip_same=False):
+		expected = shaping.intersect_polylines_py(polylines1, polylines2,
+												skip_same)
+		result = libcairo.intersect_polylines(polylines1, polylines2,
+											skip_same)
+		self.assertEqual([item[:4] for item in expected],
+						[tuple(item[:4]) for item in result])
+		for item, expected_item in zip(result, expected):
+			self.assertAlmostEqual(expected_item[4][0], item[4][0], 9)
+			self.assertAlmostEqual(expected_item[4][1], item[4][1], 9)
+		return result
+
+	def test01_random_polylines(self):
+		for seed in range(5):
+			polylines1 = self.make_polylines(10, 20, 2 * seed)
+			polylines2 = self.make_polylines(10, 20, 2 * seed + 1)
+			self.assertTrue(self.check_result(polylines1, polylines2))
+
+	def test02_self_intersection(self):
+		for seed in range(5):
+			polylines = self.make_polylines(10, 20, seed)
+			result = self.check_result(polylines, polylines, True)
+			self.assertTrue(result)
+			self.assertFalse([item for item in result if item[0] == item[1]])
+			self.check_result(polylines, polylines)
+
+	def test03_shared_points(self):
+		polyline1 = [([0.0, 0.0], 0.0), ([10.0, 10.0], 0.5),
+					([20.0, 0.0], 1.0)]
+		polyline2 = [([0.0, 0.0], 0.0), ([10.0, -10.0], 0.5),
+					([20.0, 0.0], 1.0)]
+		polyline3 = [([10.0, 0.0], 0.0), ([10.0, 20.0], 1.0)]
+		polylines = [polyline1, polyline2, polyline3]
+		result = self.check_result(polylines, polylines, True)
+		self.assertTrue([item for item in result if item[4] == [0.0, 0.0]])
+		self.check_result([polyline1, ], [polyline1[::-1], ])
+
+	def test04_sparse_polylines(self):
+		# short polylines along wide area leave sweep early
+		for seed in range(3):
+			polylines1 = self.make_polylines(150, 4, 2 * seed, 3000.0)
+			polylines2 = self.make_polylines(150, 4, 2 * seed + 1, 3000.0)
+			self.assertTrue(self.check_result(polylines1, polylines2))
+			self.assertTrue(self.check_result(polylines1, polylines1, True))
@@ -0,0 +1,64 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2019 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest, os, shutil, tempfile
+
+from uc2.libpango import _libpango, fonts
+
+
+class TestFontMapFunctions(unittest.TestCase):
+
+	def setUp(self):
+		self.font_dirs = fonts.FC_FONT_DIRS
+		self.tmp_dir = tempfile.mkdtemp()
+
+	def tearDown(self):
+		fonts.FC_FONT_DIRS = self.font_dirs
+		shutil.rmtree(self.tmp_dir)
+
+	def test01_font_faces(self):
+		families = _libpango.get_font_families()
+		self.assertTrue(families)
+		fontmap = dict(_libpango.get_fontmap())
+		self.assertEqual(sorted(fontmap.keys()), sorted(families))
+		for font_name in families:
+			self.assertEqual(fontmap[font_name],
+							_libpango.get_font_faces(font_name))
+		self.assertEqual(None, _libpango.get_font_faces('No Such Font'))
+
+	def test02_lazy_faces(self):
+		fonts.update_fonts(force=True)
+		self.assertTrue(None in fonts.FAMILIES_DICT.values())
+		families, faces = fonts.get_fonts()
+		self.assertTrue(families)
+		self.assertEqual(sorted(families), sorted(faces.keys()))
+		for font_name in families:
+			self.assertTrue(faces[font_name])
+			self.assertEqual(faces[font_name], fonts.get_faces(font_name))
+
+	def test03_fontconfig_stamp(self):
+		fonts.FC_FONT_DIRS = [self.tmp_dir]
+		stamp = fonts.get_fontconfig_stamp()
+		self.assertEqual(stamp, fonts.get_fontconfig_stamp())
+		# font installed into subdirectory
+		path = os.path.join(self.tmp_dir, 'truetype', 'family')
+		os.makedirs(path)
+		mtime = os.stat(self.tmp_dir).st_mtime
+		os.utime(self.tmp_dir, (mtime, mtime))
+		os.utime(path, (mtime + 100, mtime + 100))
+		self.assertEqual(int(mtime) + 100, fonts.get_dir_mtime(self.tmp_dir))
+		self.assertNotEqual(stamp, fonts.get_fontconfig_stamp())
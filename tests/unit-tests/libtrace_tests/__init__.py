@@ -0,0 +1,87 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2018 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest
+
+from PIL import Image
+
+from uc2 import libtrace
+
+RED = (255, 0, 0)
+BLUE = (0, 0, 255)
+
+def get_x_range(paths):
+	xs = []
+	for path in paths:
+		xs.append(path[0][0])
+		for point in path[1]:
+			if len(point) == 2:
+				xs.append(point[0])
+			else:
+				xs += [item[0] for item in point[:3]]
+	return round(min(xs), 3), round(max(xs), 3)
+
+class TestTraceFunctions(unittest.TestCase):
+
+	def setUp(self):
+		self.image = Image.new('RGB', (40, 20), RED)
+		self.image.paste(BLUE, (20, 0, 40, 20))
+
+	def tearDown(self):
+		pass
+
+	def test01_posterize_color(self):
+		indexed, colors = libtrace.posterize_image(self.image, 2)
+		self.assertEqual('P', indexed.mode)
+		self.assertEqual(set([RED, BLUE]), set(colors))
+		histogram = indexed.histogram()[:2]
+		self.assertEqual([400, 400], histogram)
+		buf = indexed.tobytes()
+		self.assertEqual(RED, colors[ord(buf[0])])
+		self.assertEqual(BLUE, colors[ord(buf[-1])])
+
+	def test02_trace_two_colors(self):
+		layers = libtrace.trace_levels(self.image, 2, skip_background=False)
+		# darker blue layer is stack bottom covering lighter red area too
+		self.assertEqual([BLUE, RED], [color for color, paths in layers])
+		self.assertEqual((0.0, 40.0), get_x_range(layers[0][1]))
+		self.assertEqual((0.0, 20.0), get_x_range(layers[1][1]))
+
+	def test03_skip_background(self):
+		self.image.paste(RED, (20, 0, 30, 20))
+		layers = libtrace.trace_levels(self.image, 2)
+		self.assertEqual(1, len(layers))
+		self.assertEqual(BLUE, layers[0][0])
+
+	def test04_stacked_levels(self):
+		image = Image.new('L', (30, 10), 255)
+		image.paste(0, (0, 0, 10, 10))
+		image.paste(128, (10, 0, 20, 10))
+		layers = libtrace.trace_levels(image, 3, skip_background=False)
+		self.assertEqual([(0, 0, 0), (128, 128, 128), (255, 255, 255)],
+						[color for color, paths in layers])
+		ranges = [get_x_range(paths) for color, paths in layers]
+		self.assertEqual([(0.0, 30.0), (10.0, 30.0), (20.0, 30.0)], ranges)
+
+		# background is not painted, so upper levels do not cover it
+		image.paste(255, (0, 0, 5, 10))
+		image.paste(255, (0, 5, 30, 10))
+		layers = libtrace.trace_levels(image, 3)
+		self.assertEqual([(0, 0, 0), (128, 128, 128)],
+						[color for color, paths in layers])
+		self.assertEqual((5.0, 20.0), get_x_range(layers[0][1]))
+		self.assertEqual((10.0, 20.0), get_x_range(layers[1][1]))
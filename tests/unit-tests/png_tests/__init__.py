@@ -0,0 +1,344 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2018 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest, os, random, shutil, struct, tempfile, zlib
+from cStringIO import StringIO
+
+import cairo
+
+from uc2 import libcairo, sk2const, uc2const
+from uc2.cms import ColorManager
+from uc2.formats import png
+from uc2.formats.png import png_writer
+from uc2.formats.png.png_writer import PNGStreamWriter
+from uc2.formats.sk2 import sk2_model
+from uc2.formats.sk2.crenderer import CairoRenderer
+from uc2.formats.sk2.sk2_presenter import SK2_Presenter
+
+# strip rendering may differ from whole page rendering
+# by antialiasing rounding only
+PIXEL_TOLERANCE = 2
+
+class AppStub:
+
+	config = None
+
+	def __init__(self):
+		self.default_cms = ColorManager()
+
+
+class AppDataStub:
+
+	def __init__(self, config_dir):
+		self.app_config_dir = config_dir
+		self.app = AppStub()
+
+
+def read_chunks(data):
+	chunks = []
+	pos = len(png_writer.PNG_SIGNATURE)
+	while pos < len(data):
+		size = struct.unpack('>I', data[pos:pos + 4])[0]
+		tag = data[pos + 4:pos + 8]
+		chunk = data[pos + 8:pos + 8 + size]
+		crc = struct.unpack('>I', data[pos + 8 + size:pos + 12 + size])[0]
+		chunks.append((tag, chunk, crc))
+		pos += 12 + size
+	return chunks
+
+
+def paeth(a, b, c):
+	p = a + b - c
+	pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+	if pa <= pb and pa <= pc:
+		return a
+	return b if pb <= pc else c
+
+
+def unfilter_scanlines(raw, width, height):
+	"""Returns (filter types, rows) of filtered RGBA scanlines,
+	rows are lists of unfiltered byte values.
+	"""
+	row_size = 4 * width
+	types = []
+	rows = []
+	prev = [0] * row_size
+	for y in range(height):
+		offset = y * (row_size + 1)
+		ftype = ord(raw[offset])
+		line = [ord(item) for item in raw[offset + 1:offset + 1 + row_size]]
+		for x in range(row_size):
+			a = line[x - 4] if x >= 4 else 0
+			b = prev[x]
+			c = prev[x - 4] if x >= 4 else 0
+			if ftype == 1:
+				line[x] = (line[x] + a) & 0xff
+			elif ftype == 2:
+				line[x] = (line[x] + b) & 0xff
+			elif ftype == 3:
+				line[x] = (line[x] + (a + b) // 2) & 0xff
+			elif ftype == 4:
+				line[x] = (line[x] + paeth(a, b, c)) & 0xff
+		types.append(ftype)
+		rows.append(line)
+		prev = line
+	return types, rows
+
+
+def decode_png(data):
+	"""Returns (width, height, rows) of 8-bit RGBA non-interlaced PNG,
+	rows are lists of unfiltered byte values.
+	"""
+	chunks = read_chunks(data)
+	header = chunks[0][1]
+	width, height, depth, color, compression, flt, interlace = \
+		struct.unpack('>IIBBBBB', header)
+	assert (depth, color, interlace) == (8, png_writer.COLOR_RGBA, 0)
+	raw = zlib.decompress(''.join([item[1] for item in chunks
+								if item[0] == 'IDAT']))
+	return width, height, unfilter_scanlines(raw, width, height)[1]
+
+
+class TestPNGWriter(unittest.TestCase):
+
+	def setUp(self):
+		self.idat_size = png_writer.IDAT_SIZE
+
+	def tearDown(self):
+		png_writer.IDAT_SIZE = self.idat_size
+
+	def get_scanlines(self, width, height, seed=1):
+		lines = []
+		for y in range(height):
+			lines.append('\x00' + ''.join([chr((seed * x + 7 * y) & 0xff)
+										for x in range(4 * width)]))
+		return ''.join(lines)
+
+	def write_png(self, width, height, scanlines, step):
+		fileptr = StringIO()
+		writer = PNGStreamWriter(fileptr, width, height)
+		row_size = 1 + 4 * width
+		for pos in range(0, len(scanlines), step * row_size):
+			writer.write_scanlines(scanlines[pos:pos + step * row_size])
+		writer.close()
+		return fileptr.getvalue()
+
+	def test01_chunks(self):
+		data = self.write_png(5, 3, self.get_scanlines(5, 3), 1)
+		self.assertTrue(data.startswith(png_writer.PNG_SIGNATURE))
+		chunks = read_chunks(data)
+		self.assertEqual('IHDR', chunks[0][0])
+		self.assertEqual('IEND', chunks[-1][0])
+		self.assertEqual('', chunks[-1][1])
+		for tag, chunk, crc in chunks:
+			self.assertEqual(zlib.crc32(chunk, zlib.crc32(tag)) & 0xffffffff,
+							crc)
+
+	def test02_strips(self):
+		width, height = 9, 20
+		scanlines = self.get_scanlines(width, height)
+		expected = [[ord(item) for item in
+					scanlines[y * (4 * width + 1) + 1:(y + 1) * (4 * width + 1)]]
+					for y in range(height)]
+		for step in (1, 7, height):
+			result = decode_png(self.write_png(width, height, scanlines, step))
+			self.assertEqual((width, height, expected), result)
+
+	def test03_idat_flushing(self):
+		png_writer.IDAT_SIZE = 64
+		width, height = 32, 200
+		rnd = random.Random(1)
+		scanlines = ''.join(['\x00' + ''.join([chr(rnd.randint(0, 255))
+										for x in range(4 * width)])
+							for y in range(height)])
+		data = self.write_png(width, height, scanlines, 3)
+		idats = [item[1] for item in read_chunks(data) if item[0] == 'IDAT']
+		self.assertTrue(len(idats) > 1)
+		for chunk in idats[:-1]:
+			self.assertTrue(len(chunk) >= png_writer.IDAT_SIZE)
+		self.assertEqual(decode_png(self.write_png(width, height,
+								scanlines, height)), decode_png(data))
+
+	def test04_row_count_errors(self):
+		writer = PNGStreamWriter(StringIO(), 4, 2)
+		self.assertRaises(ValueError, writer.write_scanlines, '\x00' * 16)
+		writer = PNGStreamWriter(StringIO(), 4, 2)
+		writer.write_scanlines('\x00' * 34)
+		self.assertRaises(ValueError, writer.write_scanlines, '\x00' * 17)
+		writer = PNGStreamWriter(StringIO(), 4, 2)
+		writer.write_scanlines('\x00' * 17)
+		self.assertRaises(ValueError, writer.close)
+
+
+class TestPNGScanlines(unittest.TestCase):
+
+	def setUp(self):
+		pass
+
+	def tearDown(self):
+		pass
+
+	def test01_unpremultiplication(self):
+		width, height = 4, 3
+		surface = cairo.ImageSurface(cairo.FORMAT_ARGB32, width, height)
+		ctx = cairo.Context(surface)
+		colors = [(1.0, 0.0, 0.0, 1.0), (0.2, 0.6, 1.0, 0.5),
+				(0.9, 0.3, 0.1, 0.01), (0.0, 0.0, 0.0, 0.0)]
+		for x, color in enumerate(colors):
+			ctx.set_source_rgba(*color)
+			ctx.set_operator(cairo.OPERATOR_SOURCE)
+			ctx.rectangle(x, 0, 1, height)
+			ctx.fill()
+		surface.flush()
+		stride = surface.get_stride()
+		pixels = str(surface.get_data())
+		scanlines = libcairo.get_png_scanlines(surface)
+		self.assertEqual(height * (1 + 4 * width), len(scanlines))
+		types, rows = unfilter_scanlines(scanlines, width, height)
+		self.assertTrue(types[0] in (0, 1))
+		for y in range(height):
+			self.assertTrue(types[y] in range(5))
+			for x in range(width):
+				pixel = struct.unpack('=I', pixels[y * stride + 4 * x:
+												y * stride + 4 * x + 4])[0]
+				alpha = pixel >> 24
+				values = [(pixel >> 16) & 0xff, (pixel >> 8) & 0xff,
+						pixel & 0xff]
+				if alpha:
+					values = [(item * 255 + alpha // 2) // alpha
+							for item in values]
+				else:
+					values = [0, 0, 0]
+				self.assertEqual(values + [alpha, ], rows[y][4 * x:4 * x + 4])
+
+		fileptr = StringIO()
+		surface.write_to_png(fileptr)
+		writer_ptr = StringIO()
+		writer = PNGStreamWriter(writer_ptr, width, height)
+		writer.write_scanlines(scanlines)
+		writer.close()
+		self.assertEqual(decode_png(fileptr.getvalue()),
+						decode_png(writer_ptr.getvalue()))
+
+	def test02_adaptive_filters(self):
+		width, height = 16, 4
+		surface = cairo.ImageSurface(cairo.FORMAT_ARGB32, width, height)
+		ctx = cairo.Context(surface)
+		rnd = random.Random(1)
+		# equal noisy rows are best predicted by previous row
+		for x in range(width):
+			ctx.set_source_rgba(rnd.random(), rnd.random(), rnd.random(), 1.0)
+			ctx.set_operator(cairo.OPERATOR_SOURCE)
+			ctx.rectangle(x, 0, 1, height)
+			ctx.fill()
+		scanlines = libcairo.get_png_scanlines(surface)
+		types, rows = unfilter_scanlines(scanlines, width, height)
+		self.assertTrue(types[0] in (0, 1))
+		self.assertEqual([2] * (height - 1), types[1:])
+		self.assertEqual([rows[0]] * height, rows)
+		for y in range(1, height):
+			offset = y * (1 + 4 * width) + 1
+			self.assertEqual('\x00' * 4 * width,
+							scanlines[offset:offset + 4 * width])
+
+
+class TestPNGSaver(unittest.TestCase):
+
+	def setUp(self):
+		self.tmp_dir = tempfile.mkdtemp()
+		self.doc = SK2_Presenter(AppDataStub(self.tmp_dir))
+		page = self.doc.methods.get_page()
+		page.page_format = ['Custom', (61.0, 45.0), uc2const.LANDSCAPE]
+		layer = self.doc.methods.get_layer(page)
+		config = self.doc.config
+		red = [uc2const.COLOR_RGB, [1.0, 0.0, 0.0], 0.6, '']
+		blue = [uc2const.COLOR_RGB, [0.0, 0.2, 1.0], 1.0, '']
+		fill = [sk2const.FILL_EVENODD, sk2const.FILL_SOLID]
+		rect = sk2_model.Rectangle(config, layer, [-20.0, -15.0, 40.0, 30.0],
+								[0.8, 0.6, -0.6, 0.8, 0.3, 0.7],
+								[fill + [red, ], [], [], []])
+		circle = sk2_model.Circle(config, layer, [-28.3, -2.1, 30.6, 21.3],
+								style=[fill + [blue, ], [], [], []])
+		for obj in (circle, rect):
+			self.doc.methods.append_object(obj, layer)
+			obj.update()
+
+	def tearDown(self):
+		self.doc.close()
+		shutil.rmtree(self.tmp_dir)
+
+	def render_page(self):
+		"""Renders page on single surface as png_saver did before
+		strip rendering.
+		"""
+		page = self.doc.methods.get_page()
+		w, h = page.page_format[1]
+		surface = cairo.ImageSurface(cairo.FORMAT_ARGB32, int(w), int(h))
+		ctx = cairo.Context(surface)
+		ctx.set_matrix(cairo.Matrix(1.0, 0, 0, -1.0, w / 2.0, h / 2.0))
+		rend = CairoRenderer(self.doc.cms)
+		for item in self.doc.methods.get_visible_layers(page):
+			rend.antialias_flag = bool(item.properties[3])
+			rend.render(ctx, item.childs)
+		fileptr = StringIO()
+		surface.write_to_png(fileptr)
+		return decode_png(fileptr.getvalue())
+
+	def save_page(self, **kw):
+		filename = os.path.join(self.tmp_dir, 'page.png')
+		png.png_saver(self.doc, filename, **kw)
+		with open(filename, 'rb') as fileptr:
+			return decode_png(fileptr.read())
+
+	def assertImagesEqual(self, expected, result):
+		self.assertEqual(expected[:2], result[:2])
+		for y, (row1, row2) in enumerate(zip(expected[2], result[2])):
+			diff = max([abs(a - b) for a, b in zip(row1, row2)])
+			self.assertTrue(diff <= PIXEL_TOLERANCE,
+						'row %d differs by %d' % (y, diff))
+
+	def test01_strip_heights(self):
+		expected = self.render_page()
+		self.assertEqual((61, 45), expected[:2])
+		for strip_height in (1, 7, None):
+			kw = {'threads': 1}
+			if strip_height:
+				kw['strip_height'] = strip_height
+			self.assertImagesEqual(expected, self.save_page(**kw))
+
+	def test02_strip_threads(self):
+		expected = self.render_page()
+		self.assertImagesEqual(expected,
+							self.save_page(strip_height=7, threads=3))
+
+	def test03_stroke_margin(self):
+		config = self.doc.config
+		layer = self.doc.methods.get_layer(self.doc.methods.get_page())
+		blue = [uc2const.COLOR_RGB, [0.0, 0.2, 1.0], 1.0, '']
+		# miter tip of sharp join is far outside of path bbox
+		stroke = [sk2const.STROKE_MIDDLE, 2.0, blue, [], sk2const.CAP_BUTT,
+				sk2const.JOIN_MITER, 100.0, 0, 0, []]
+		paths = [[[-20.0, 0.0], [[20.0, 0.5], [-20.0, 1.0]],
+				sk2const.CURVE_OPENED]]
+		curve = sk2_model.Curve(config, layer, paths,
+							style=[[], stroke, [], []])
+		curve.update()
+		rend = CairoRenderer(self.doc.cms)
+		rend.render_bbox = [60.0, -5.0, 70.0, 5.0]
+		self.assertTrue(rend.is_visible(curve))
+		rend.render_bbox = [130.0, -5.0, 140.0, 5.0]
+		self.assertFalse(rend.is_visible(curve))
@@ -16,7 +16,9 @@
 #	along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 import os
+import time
 
+from uc2 import libcairo
 from uc2.libimg import _libimg
 
 _pkgdir = __path__[0]
@@ -44,3 +46,112 @@ def probe_colorspace():
         _libimg.next_image(wand)
         name = path.split('/')[-1]
         print name, '==>', _libimg.get_colorspace(wand)
+
+
+def _make_cpath(nodes):
+    points = []
+    for i in xrange(nodes):
+        if i % 2:
+            points.append([float(i), float(i % 100)])
+        else:
+            points.append([[float(i), 1.0], [float(i), 2.0],
+                           [float(i), 3.0], 0])
+    return libcairo.create_cpath([[[0.0, 0.0], points, 1]])
+
+
+def _apply_trafo_py(cpath, trafo):
+    # pure Python reference: per-node transform of unpacked path
+    m11, m21, m12, m22, dx, dy = trafo
+    paths = []
+    for start, points, closed in libcairo.get_path_from_cpath(cpath):
+        new_points = []
+        for point in points:
+            if len(point) == 2:
+                point = [point, ]
+            new_point = [[m11 * x + m12 * y + dx, m21 * x + m22 * y + dy]
+                         for x, y in point[:3]]
+            new_points.append(new_point[0] if len(new_point) == 1
+                              else new_point + point[3:])
+        x, y = start
+        paths.append([[m11 * x + m12 * y + dx, m21 * x + m22 * y + dy],
+                      new_points, closed])
+    return libcairo.create_cpath(paths)
+
+
+def _timeit(label, func, *args):
+    start = time.time()
+    func(*args)
+    print '%-40s %.4f sec' % (label, time.time() - start)
+
+
+def probe_cpath_trafo(nodes=1000000, paths_num=1000):
+    """Micro-benchmark of cairo path transform kernel.
+    Compares with pure Python reference on the same path.
+    """
+    trafo = [1.5, 0.1, -0.1, 1.5, 10.0, 20.0]
+    cpath = _make_cpath(nodes)
+    _timeit('apply_trafo, %d nodes' % nodes,
+            libcairo.apply_trafo, cpath, trafo)
+    _timeit('python reference, %d nodes' % nodes,
+            _apply_trafo_py, cpath, trafo)
+
+    size = max(1, nodes / paths_num)
+    cpaths = [_make_cpath(size) for i in xrange(paths_num)]
+
+    def per_path(paths):
+        for path in paths:
+            libcairo.apply_trafo(path, trafo)
+
+    _timeit('apply_trafo loop, %dx%d nodes' % (paths_num, size),
+            per_path, cpaths)
+    _timeit('apply_trafo_to_cpaths, %dx%d nodes' % (paths_num, size),
+            libcairo.apply_trafo_to_cpaths, cpaths, trafo)
+
+
+def _make_polylines(num, size, seed=0):
+    import random
+    rnd = random.Random(seed)
+    polylines = []
+    for i in xrange(num):
+        x, y = rnd.uniform(0.0, 1000.0), rnd.uniform(0.0, 1000.0)
+        polyline = []
+        for j in xrange(size):
+            x += rnd.uniform(-10.0, 10.0)
+            y += rnd.uniform(-10.0, 10.0)
+            polyline.append(([x, y], float(j) / size))
+        polylines.append(polyline)
+    return polylines
+
+
+def probe_intersect_polylines(num=50, size=100):
+    from uc2.libgeom import shaping
+    polylines1 = _make_polylines(num, size, 1)
+    polylines2 = _make_polylines(num, size, 2)
+    label = '%dx%d segments' % (num, size)
+    _timeit('intersect_polylines_py, ' + label,
+            shaping.intersect_polylines_py, polylines1, polylines2)
+    _timeit('libcairo.intersect_polylines, ' + label,
+            libcairo.intersect_polylines, polylines1, polylines2)
+
+
+def probe_packed_paths(curves=10000, size=20):
+    """Compares nested list paths with packed paths processing.
+    """
+    from uc2 import libgeom
+    from uc2.libgeom import PackedPaths
+    trafo = [1.5, 0.1, -0.1, 1.5, 10.0, 20.0]
+    paths = [[[[0.0, 0.0], [[float(j), 1.0] if j % 2 else
+                            [[0.0, 1.0], [2.0, 3.0], [float(j), 5.0], 0]
+                            for j in xrange(size)], 1]]
+             for i in xrange(curves)]
+    packed = [PackedPaths.from_paths(item) for item in paths]
+    label = '%dx%d nodes' % (curves, size)
+
+    def process(items):
+        for item in items:
+            libgeom.apply_trafo_to_paths(item, trafo)
+            libgeom.reverse_paths(item)
+            libgeom.get_paths_bbox(item)
+
+    _timeit('list paths, ' + label, process, paths)
+    _timeit('packed paths, ' + label, process, packed)
@@ -0,0 +1,156 @@
+# -*- coding: utf-8 -*-
+#
+#	Copyright (C) 2019 by Ihor E. Novikov
+#
+#	This program is free software: you can redistribute it and/or modify
+#	it under the terms of the GNU Affero General Public License
+#	as published by the Free Software Foundation, either version 3
+#	of the License, or (at your option) any later version.
+#
+#	This program is distributed in the hope that it will be useful,
+#	but WITHOUT ANY WARRANTY; without even the implied warranty of
+#	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#	GNU General Public License for more details.
+#
+#	You should have received a copy of the GNU Affero General Public License
+#	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+import unittest, os, shutil, signal, sys, tempfile
+
+from uc2 import events, msgconst
+from uc2.cmds import server, translate
+
+
+def fake_convert(appdata, files, options):
+	# file content defines job behaviour
+	with open(files[0], 'rb') as fileptr:
+		action = fileptr.read()
+	if action == 'segfault':
+		os.kill(os.getpid(), signal.SIGSEGV)
+	elif action == 'exit':
+		os._exit(3)
+	elif action == 'sysexit':
+		sys.exit(0)
+	elif action == 'error':
+		events.emit(events.MESSAGES, msgconst.ERROR, 'error ' + files[0])
+		raise Exception('error')
+	events.emit(events.MESSAGES, msgconst.OK, 'ok ' + files[0])
+	with open(files[1], 'wb') as fileptr:
+		fileptr.write(action)
+
+
+class TestParallelConvert(unittest.TestCase):
+
+	def setUp(self):
+		self.tmp_dir = tempfile.mkdtemp()
+		self.convert = translate.convert
+		self.report = translate._report
+		self.reports = []
+		self.messages = []
+		translate.convert = fake_convert
+		translate._report = self.collect_report
+		events.connect(events.MESSAGES, self.collect_message)
+
+	def tearDown(self):
+		translate.convert = self.convert
+		translate._report = self.report
+		events.disconnect(events.MESSAGES, self.collect_message)
+		shutil.rmtree(self.tmp_dir)
+
+	def collect_report(self, filepath, out_filepath, success, options):
+		self.reports.append((os.path.basename(filepath), success))
+
+	def collect_message(self, *args):
+		self.messages.append(args)
+
+	def get_jobs(self, actions):
+		jobs = []
+		for index, action in enumerate(actions):
+			filepath = os.path.join(self.tmp_dir, '%d-%s.in' % (index, action))
+			with open(filepath, 'wb') as fileptr:
+				fileptr.write(action)
+			jobs.append((filepath, filepath[:-3] + '.out'))
+		return jobs
+
+	def test01_crashed_jobs(self):
+		actions = ['ok', 'segfault', 'ok', 'exit', 'error', 'sysexit', 'ok']
+		jobs = self.get_jobs(actions)
+		translate._convert_jobs(None, jobs, {'jobs': 3})
+		self.assertEqual(len(actions), len(self.reports))
+		expected = sorted(['%d-%s.in' % (index, action)
+						for index, action in enumerate(actions)])
+		self.assertEqual(expected, sorted([item[0] for item in self.reports]))
+		for name, success in self.reports:
+			self.assertEqual(name.endswith('-ok.in'), success)
+		for filepath, out_filepath in jobs:
+			self.assertEqual(filepath.endswith('-ok.in'),
+							os.path.exists(out_filepath))
+		crashed = [args[1] for args in self.messages
+				if args[0] == msgconst.ERROR and 'crashed' in args[1]]
+		self.assertEqual(2, len(crashed))
+		self.assertTrue([args for args in self.messages
+						if args == (msgconst.ERROR, 'error ' + jobs[4][0])])
+
+	def test02_all_jobs_crashed(self):
+		actions = ['segfault', 'exit', 'segfault', 'exit']
+		translate._convert_jobs(None, self.get_jobs(actions), {'jobs': 2})
+		self.assertEqual(len(actions), len(self.reports))
+		self.assertFalse([item for item in self.reports if item[1]])
+
+
+class DocStub:
+
+	closed = False
+
+	def close(self):
+		self.closed = True
+
+
+class TestConvertCleanup(unittest.TestCase):
+
+	def setUp(self):
+		self.doc = DocStub()
+		self.get_loader = translate.get_loader
+		self.get_saver = translate.get_saver
+		translate.get_loader = self.fake_get_loader
+		translate.get_saver = self.fake_get_saver
+
+	def tearDown(self):
+		translate.get_loader = self.get_loader
+		translate.get_saver = self.get_saver
+
+	def fake_get_loader(self, path, return_id=False):
+		return (lambda appdata, path, **kw: self.doc), 'loader'
+
+	def fake_get_saver(self, path, return_id=False):
+		def saver(doc, path, **kw):
+			if path == 'bad':
+				raise Exception('saving error')
+		return saver, 'saver'
+
+	def test01_doc_closed_on_success(self):
+		translate.convert(None, ('in', 'good'), {})
+		self.assertTrue(self.doc.closed)
+
+	def test02_doc_closed_on_error(self):
+		self.assertRaises(Exception, translate.convert, None, ('in', 'bad'), {})
+		self.assertTrue(self.doc.closed)
+
+
+class TestServerRequests(unittest.TestCase):
+
+	def setUp(self):
+		pass
+
+	def tearDown(self):
+		pass
+
+	def test01_stream_extensions(self):
+		for input_ext, output_ext in [('../x', 'png'), ('svg', '../../x'),
+									('svg/', 'png'), ('svg', None),
+									(['svg'], 'png'), ('unknown', 'png')]:
+			request = {'input_ext': input_ext, 'output_ext': output_ext}
+			self.assertRaises(ValueError, server._convert_stream,
+							None, request, '')
+		self.assertTrue('svg' in server.LOADER_EXTENSIONS)
+		self.assertTrue('png' in server.SAVER_EXTENSIONS)